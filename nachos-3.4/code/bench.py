@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+# bench.py
+#	Run the Nachos benchmark suite: the microbenchmarks in
+#	threads/bench.cc ("nachos -bench <name> <iterations>"), and the
+#	matmult and sort test programs, each in the build that has what it
+#	needs, several times over.  Print (or write) one JSON object with
+#	the host time and simulated ticks of every benchmark: the median,
+#	mean, spread and each repetition.
+#
+#	Each run is a separate Nachos, in a directory of its own (so it
+#	has its own DISK and SOCKET).  Simulated ticks should be the same
+#	on every repetition; host time is what varies.
+#
+#	Given a baseline (the output of an earlier run), benchmarks whose
+#	median host time per iteration grew by more than --threshold are
+#	reported, and the exit status is 1.  For example
+#
+#		make bench
+#		./bench.py --reps 9 --baseline bench.json --only switch,sort
+#
+# Copyright (c) 1992-1993 The Regents of the University of California.
+# All rights reserved.  See copyright.h for copyright notice and limitation
+# of liability and disclaimer of warranty provisions.
+
+import argparse
+import json
+import os
+import platform
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+# name, build directory, extra flags, iterations (None: a user program)
+Suite = [
+    ("switch",    "threads",  [],             20000),
+    ("semaphore", "threads",  [],             20000),
+    ("lock",      "threads",  [],             8000),
+    ("interrupt", "threads",  [],             50000),
+    ("translate", "userprog", [],             200000),
+    ("matmult",   "userprog", [],             None),
+    ("sort",      "userprog", [],             None),
+    ("create",    "filesys",  ["-f"],         200),
+    ("seqio",     "filesys",  ["-f"],         2000),
+    ("randio",    "filesys",  ["-f"],         2000),
+    ("mailbox",   "network",  ["-f", "-m", "0"], 2000),
+]
+
+TicksLine = re.compile(r"Ticks: total (\d+), idle (\d+), system (\d+), "
+                       r"user (\d+)")
+
+
+def run_once(here, name, build, flags, iterations, timeout):
+    """Run one benchmark once; return (iterations, ticks, host_us)."""
+    nachos = os.path.join(here, build, "nachos")
+    if iterations is None:
+        cmd = [nachos] + flags + ["-x", os.path.join(here, "test", name)]
+    else:
+        cmd = [nachos] + flags + ["-bench", name, str(iterations)]
+    top = tempfile.mkdtemp(prefix="nachos-bench-")
+    try:
+        start = time.time()
+        out = subprocess.run(cmd, cwd=top, stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT, timeout=timeout,
+                             universal_newlines=True).stdout
+        wall = int((time.time() - start) * 1e6)
+    finally:
+        shutil.rmtree(top, ignore_errors=True)
+
+    if iterations is None:	# a user program: count its instructions
+        m = TicksLine.search(out)
+        if m is None:
+            raise RuntimeError("%s: no statistics in output:\n%s"
+                               % (name, out[-500:]))
+        return int(m.group(4)), int(m.group(1)), wall
+    for line in out.splitlines():
+        if line.startswith("bench "):
+            fields = dict(f.split("=", 1) for f in line.split()[1:])
+            return (int(fields["iterations"]), int(fields["ticks"]),
+                    int(fields["host_us"]))
+    raise RuntimeError("%s: no result in output:\n%s" % (name, out[-500:]))
+
+
+def summarize(name, build, runs):
+    """Turn the repetitions of one benchmark into its result."""
+    iterations = runs[0][0]
+    ticks = [r[1] for r in runs]
+    host = [r[2] for r in runs]
+    median = statistics.median(host)
+    return {
+        "name": name, "build": build, "iterations": iterations,
+        "reps": len(runs),
+        "ticks": ticks[0], "ticks_vary": min(ticks) != max(ticks),
+        "host_us_median": median,
+        "host_us_mean": round(statistics.mean(host), 1),
+        "host_us_min": min(host), "host_us_max": max(host),
+        "host_us_stdev": round(statistics.stdev(host), 1)
+            if len(host) > 1 else 0.0,
+        "ns_per_iteration": round(1000.0 * median / iterations, 2)
+            if iterations else None,
+        "ticks_per_iteration": round(float(ticks[0]) / iterations, 2)
+            if iterations else None,
+        "host_us": host,
+    }
+
+
+def compare(results, baseline, threshold):
+    """Return the benchmarks that got slower than "baseline"."""
+    old = {r["name"]: r for r in baseline.get("results", [])}
+    slower = []
+    for r in results:
+        b = old.get(r["name"])
+        if b is None or not b.get("ns_per_iteration") \
+                or not r["ns_per_iteration"]:
+            continue
+        ratio = r["ns_per_iteration"] / b["ns_per_iteration"]
+        r["baseline_ratio"] = round(ratio, 3)
+        if ratio > threshold or r["ticks"] != b["ticks"]:
+            slower.append("%s: %.2fx host time, ticks %d -> %d"
+                          % (r["name"], ratio, b["ticks"], r["ticks"]))
+    return slower
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description="Run the Nachos benchmark suite.")
+    parser.add_argument("--reps", type=int, default=5,
+                        help="repetitions of each benchmark")
+    parser.add_argument("--only", default=None,
+                        help="comma-separated benchmarks to run "
+                             "(default: all of %s)"
+                             % ",".join(b[0] for b in Suite))
+    parser.add_argument("--scale", type=float, default=1.0,
+                        help="multiply every iteration count by this")
+    parser.add_argument("--timeout", type=float, default=300,
+                        help="seconds before a run is given up")
+    parser.add_argument("--output", default="-",
+                        help="file for the results (default: stdout)")
+    parser.add_argument("--baseline", default=None,
+                        help="earlier results to compare against")
+    parser.add_argument("--threshold", type=float, default=1.10,
+                        help="slowdown (vs. the baseline) that fails")
+    args = parser.parse_args()
+
+    only = set(args.only.split(",")) if args.only else None
+    results = []
+    failed = []
+    for name, build, flags, iterations in Suite:
+        if only is not None and name not in only:
+            continue
+        if not os.path.exists(os.path.join(here, build, "nachos")):
+            failed.append("%s: %s/nachos has not been built" % (name, build))
+            continue
+        if iterations is not None:
+            iterations = max(1, int(iterations * args.scale))
+        try:
+            runs = [run_once(here, name, build, flags, iterations,
+                             args.timeout) for _ in range(args.reps)]
+        except (RuntimeError, subprocess.TimeoutExpired) as e:
+            failed.append(str(e))
+            continue
+        results.append(summarize(name, build, runs))
+        sys.stderr.write("%-10s %12s ns/iteration %10s ticks/iteration\n"
+                         % (name, results[-1]["ns_per_iteration"],
+                            results[-1]["ticks_per_iteration"]))
+
+    report = {"host": platform.node(), "time": int(time.time()),
+              "reps": args.reps, "scale": args.scale, "results": results,
+              "failed": failed}
+    if args.baseline:
+        with open(args.baseline) as f:
+            report["slower"] = compare(results, json.load(f),
+                                       args.threshold)
+        failed += report["slower"]
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    out.write(json.dumps(report, indent=1) + "\n")
+    for problem in failed:
+        sys.stderr.write("bench: %s\n" % problem)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,211 @@
+// dcache.cc
+//	Routines to manage the directory entry cache.
+//
+//	We assume mutual exclusion is provided by the caller, as for
+//	the rest of the file system.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "dcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty cache.
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache()
+{
+    for (int i = 0; i < DentryHashSize; i++)
+        buckets[i] = NULL;
+    lru = new List;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::~DentryCache
+// 	De-allocate every entry, and the cache.
+//----------------------------------------------------------------------
+
+DentryCache::~DentryCache()
+{
+    while (!lru->IsEmpty())
+        delete (Dentry *)lru->Remove();
+    delete lru;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Chain
+// 	Return a pointer to the link that points to the entry for
+//	"name" in "parent" -- a hash chain head, or the "next" field of
+//	the previous entry on the chain.  If there is no such entry,
+//	the link found is the NULL at the end of the chain.
+//----------------------------------------------------------------------
+
+Dentry **
+DentryCache::Chain(int parent, char *name)
+{
+    Dentry **ptr = &buckets[(HashName(name) + parent) % DentryHashSize];
+
+    while (*ptr != NULL &&
+            ((*ptr)->parent != parent || strcmp((*ptr)->name, name)))
+        ptr = &(*ptr)->next;
+    return ptr;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+// 	Find the file called "name" in the directory whose header is at
+//	sector "parent".  Return TRUE, with the sector of the file's
+//	header and whether it is a directory, if the answer is cached.
+//----------------------------------------------------------------------
+
+bool
+DentryCache::Lookup(int parent, char *name, int *sector, bool *isdir)
+{
+    Dentry *entry = *Chain(parent, name);
+
+    if (entry == NULL)
+        return FALSE;
+    lru->Remove((void *)entry);		// it is now the most recently used
+    lru->Append((void *)entry);
+    *sector = entry->sector;
+    if (isdir != NULL)
+        *isdir = entry->isdir;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Enter
+// 	Remember that "name" in directory "parent" has its header at
+//	"sector".  If the cache is full, forget the least recently used
+//	entry.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Enter(int parent, char *name, int sector, bool isdir)
+{
+    Dentry **ptr = Chain(parent, name);
+    Dentry *entry = *ptr;
+
+    if (strlen(name) > FileNameMaxLen)
+        return;				// can't be in a directory anyway
+    if (entry == NULL) {
+        if (lru->NumInList() >= DentryCacheSize) {
+            Dentry *victim = (Dentry *)lru->Remove();
+            Dentry **vptr = Chain(victim->parent, victim->name);
+            *vptr = victim->next;
+            delete victim;
+            ptr = Chain(parent, name);	// the chain may have changed
+        }
+        entry = new Dentry;
+        entry->parent = parent;
+        strcpy(entry->name, name);
+        entry->next = NULL;
+        *ptr = entry;
+    } else
+        lru->Remove((void *)entry);
+    entry->sector = sector;
+    entry->isdir = isdir;
+    lru->Append((void *)entry);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Invalidate
+// 	Forget about "name" in directory "parent", if we know about it.
+//	Called whenever a name is removed from a directory.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Invalidate(int parent, char *name)
+{
+    Dentry **ptr = Chain(parent, name);
+    Dentry *entry = *ptr;
+
+    if (entry == NULL)
+        return;
+    *ptr = entry->next;
+    lru->Remove((void *)entry);
+    delete entry;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::DirectoryCache
+// 	Initialize an empty cache of directories.
+//----------------------------------------------------------------------
+
+DirectoryCache::DirectoryCache()
+{
+    for (int i = 0; i < DirCacheSize; i++) {
+        sectors[i] = -1;
+        dirs[i] = NULL;
+        lastUse[i] = 0;
+    }
+    uses = 0;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::~DirectoryCache
+// 	De-allocate every cached directory.  They have all been written
+//	back already.
+//----------------------------------------------------------------------
+
+DirectoryCache::~DirectoryCache()
+{
+    for (int i = 0; i < DirCacheSize; i++)
+        delete dirs[i];
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Get
+// 	Return the directory whose header is at "sector".  If it isn't
+//	cached, read it from disk, in place of the least recently used
+//	directory.
+//----------------------------------------------------------------------
+
+Directory *
+DirectoryCache::Get(int sector)
+{
+    OpenFile *file;
+    int i, victim = 0;
+
+    for (i = 0; i < DirCacheSize; i++) {
+        if (sectors[i] == sector) {
+            lastUse[i] = ++uses;
+            return dirs[i];
+        }
+        if (lastUse[i] < lastUse[victim])
+            victim = i;			// free slots were never used
+    }
+
+    DEBUG('f', "Reading directory at sector %d\n", sector);
+    delete dirs[victim];
+    file = new OpenFile(sector);
+    dirs[victim] = new Directory(NumDirEntries);
+    dirs[victim]->FetchFrom(file);
+    delete file;
+    sectors[victim] = sector;
+    lastUse[victim] = ++uses;
+    return dirs[victim];
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Invalidate
+// 	Forget the directory at "sector", if it is cached.  Called
+//	whenever a directory is removed, since its header sector may be
+//	reused.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Invalidate(int sector)
+{
+    for (int i = 0; i < DirCacheSize; i++)
+        if (sectors[i] == sector) {
+            delete dirs[i];
+            dirs[i] = NULL;
+            sectors[i] = -1;
+            lastUse[i] = 0;
+        }
+}
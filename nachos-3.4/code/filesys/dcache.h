@@ -0,0 +1,99 @@
+// dcache.h
+//	Data structures for the directory entry cache.
+//
+//	Looking up a path name means reading every directory along the
+//	path.  The directory entry cache remembers the result of recent
+//	lookups -- for a directory (named by the sector of its header)
+//	and a name in it, the sector of the named file's header -- so
+//	that lookups of hot paths don't have to read directories at all.
+//
+//	Only names that were found are cached.  An entry has to be
+//	invalidated when the name is removed from its directory.
+//
+//	Names that aren't cached still have to be looked up in their
+//	directory, and a directory can only be searched once it has been
+//	read from disk and hashed in full.  So we also keep the most
+//	recently used directories themselves in memory, ready to search
+//	and to change; only a directory that isn't cached is read.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "directory.h"
+#include "list.h"
+
+#define DentryHashSize	61	// number of hash chains in the cache
+#define DentryCacheSize	64	// number of names we remember
+#define DirCacheSize	8	// number of directories we keep
+
+// The following class defines one cached lookup result.
+
+class Dentry {
+  public:
+    int parent;				// Header sector of the directory
+    char name[FileNameMaxLen + 1];	// Name within that directory
+    int sector;				// Header sector of the named file
+    bool isdir;				// Is the named file a directory?
+    Dentry *next;			// Next entry on the same hash chain
+};
+
+// The following class defines the cache itself.  When it is full,
+// the least recently used entry is thrown away.
+
+class DentryCache {
+  public:
+    DentryCache();			// Initialize an empty cache
+    ~DentryCache();			// De-allocate the cache
+
+    bool Lookup(int parent, char *name, int *sector, bool *isdir);
+					// Find "name" in directory "parent";
+					// return FALSE if it isn't cached
+    void Enter(int parent, char *name, int sector, bool isdir);
+					// Remember the result of a lookup
+    void Invalidate(int parent, char *name);
+					// "name" was removed from "parent"
+
+  private:
+    Dentry **Chain(int parent, char *name);
+					// Find the hash chain pointer to the
+					// entry, or to the end of its chain
+
+    Dentry *buckets[DentryHashSize];	// Hash chains
+    List *lru;				// All entries, least recently used
+					// first
+};
+
+// The following class defines the cache of directories.  Every change
+// to a cached directory has to be written back by the caller (cf.
+// Directory::WriteBack), or undone, before the cache is used again.
+//
+// When the cache is full, the least recently used directory is thrown
+// away, so a directory returned by Get stays valid until
+// DirCacheSize-1 other directories have been got.
+
+class DirectoryCache {
+  public:
+    DirectoryCache();			// Initialize an empty cache
+    ~DirectoryCache();			// De-allocate the cached directories
+
+    Directory *Get(int sector);		// The directory whose header is
+					// at "sector"; read from disk only
+					// if it isn't cached
+    void Invalidate(int sector);	// The directory at "sector" has been
+					// removed
+
+  private:
+    int sectors[DirCacheSize];		// Header sector of each cached
+					// directory, or -1 if the slot is free
+    Directory *dirs[DirCacheSize];	// The directories
+    int lastUse[DirCacheSize];		// When each one was last got
+    int uses;				// Number of Gets so far
+};
+
+#endif // DCACHE_H
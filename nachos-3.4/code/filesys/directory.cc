@@ -11,10 +11,12 @@
 //  we use ReadFrom/WriteBack to fetch the contents of the directory
 //  from disk, and to write back any modifications back to disk.
 //
-//  Also, this implementation has the restriction that the size
-//  of the directory cannot expand.  In other words, once all the
-//  entries in the directory are used, no more files can be created.
-//  Fixing this is one of the parts to the assignment.
+//  When every entry is in use, Add doubles the size of the table;
+//  the directory file is extended the next time it is written back.
+//  Lookups go through a hash table on the names, and Add starts its
+//  search for a free entry at a hint, so neither has to look at every
+//  entry -- but FetchFrom still reads the whole directory from disk,
+//  which is why the file system caches directories once read.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -24,8 +26,22 @@
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
-#include "filesys.h"
-extern FileSystem*fileSystem;
+
+//----------------------------------------------------------------------
+// HashName
+//  Hash function for file names, used by the in-memory index of a
+//  directory and by the directory entry cache.
+//----------------------------------------------------------------------
+
+unsigned int
+HashName(char *name)
+{
+    unsigned int h = 0;
+
+    while (*name != '\0')
+        h = h * 31 + (unsigned char) *name++;
+    return h;
+}
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -43,10 +59,16 @@ Directory::Directory(int size)
     tableSize = size;
     for (int i = 0; i < tableSize; i++){
        table[i].inUse = FALSE;
-       table[i].NameLength = 0;
-       table[i].NamePos = 0;
+       table[i].isdir = FALSE;
+       table[i].name[0] = '\0';
     }
+    hashHead = new int[tableSize];
+    hashNext = new int[tableSize];
+    Rehash();
 
+    // a new directory has to be written out in full
+    dirtyLo = 0;
+    dirtyHi = tableSize - 1;
 }
 
 //----------------------------------------------------------------------
@@ -57,11 +79,14 @@ Directory::Directory(int size)
 Directory::~Directory()
 {
     delete [] table;
+    delete [] hashHead;
+    delete [] hashNext;
 }
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-//  Read the contents of the directory from disk.
+//  Read the contents of the directory from disk.  The table is made
+//  big enough for every entry in the file.
 //
 //  "file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -69,12 +94,27 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int numEntries = file->Length() / sizeof(DirectoryEntry);
+
+    if (numEntries > tableSize)
+        Resize(numEntries);
+    (void) file->ReadAt((char *)table, numEntries * sizeof(DirectoryEntry), 0);
+    for (int i = 0; i < tableSize; i++) {
+        if (i >= numEntries)
+            table[i].inUse = FALSE;     // past the end of the file
+        table[i].name[FileNameMaxLen] = '\0';   // in case the disk is bad
+    }
+    Rehash();
+
+    dirtyLo = tableSize;        // nothing to write back yet
+    dirtyHi = -1;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-//  Write any modifications to the directory back to disk
+//  Write any modifications to the directory back to disk.  Only the
+//  entries that changed are written, plus, if the table grew, any
+//  entries between the old end of the file and the changed ones.
 //
 //  "file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -82,7 +122,101 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int lo = dirtyLo, hi = dirtyHi;
+    int fileEntries = file->Length() / sizeof(DirectoryEntry);
+
+    if (lo > hi)
+        return;                 // nothing changed
+    if (lo > fileEntries)
+        lo = fileEntries;       // can't leave a hole in the file
+    (void) file->WriteAt((char *)&table[lo],
+                (hi - lo + 1) * sizeof(DirectoryEntry),
+                lo * sizeof(DirectoryEntry));
+    dirtyLo = tableSize;
+    dirtyHi = -1;
+}
+
+//----------------------------------------------------------------------
+// Directory::MarkDirty
+//  Remember that entry "i" has to be written back.
+//----------------------------------------------------------------------
+
+void
+Directory::MarkDirty(int i)
+{
+    if (i < dirtyLo)
+        dirtyLo = i;
+    if (i > dirtyHi)
+        dirtyHi = i;
+}
+
+//----------------------------------------------------------------------
+// Directory::Hash, Unhash and Rehash
+//  Maintain the in-memory hash chains over the names of the entries
+//  in use.  There are as many chains as entries.  Rehash also finds
+//  the first free entry.
+//----------------------------------------------------------------------
+
+void
+Directory::Hash(int i)
+{
+    int bucket = HashName(table[i].name) % tableSize;
+
+    hashNext[i] = hashHead[bucket];
+    hashHead[bucket] = i;
+}
+
+void
+Directory::Unhash(int i)
+{
+    int *ptr = &hashHead[HashName(table[i].name) % tableSize];
+
+    while (*ptr != i)
+        ptr = &hashNext[*ptr];
+    *ptr = hashNext[i];
+}
+
+void
+Directory::Rehash()
+{
+    freeHint = tableSize;
+    for (int i = 0; i < tableSize; i++)
+        hashHead[i] = -1;
+    for (int i = 0; i < tableSize; i++)
+        if (table[i].inUse)
+            Hash(i);
+        else if (i < freeHint)
+            freeHint = i;
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+//  Grow the table to "newSize" entries.  The new entries are free.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int newSize)
+{
+    DirectoryEntry *newTable = new DirectoryEntry[newSize];
+
+    ASSERT(newSize > tableSize);
+    for (int i = 0; i < newSize; i++) {
+        if (i < tableSize)
+            newTable[i] = table[i];
+        else {
+            newTable[i].inUse = FALSE;
+            newTable[i].isdir = FALSE;
+            newTable[i].name[0] = '\0';
+        }
+    }
+    delete [] table;
+    delete [] hashHead;
+    delete [] hashNext;
+    table = newTable;
+    tableSize = newSize;
+    hashHead = new int[tableSize];
+    hashNext = new int[tableSize];
+    Rehash();
 }
 
 //----------------------------------------------------------------------
@@ -96,24 +230,13 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *path)
 {
+    char *name = path2name(path);
 
-    char*name;
-    name = path2name(path);
-    DEBUG('f', "Finding index for %s with %s\n", path,name);
-    for (int i = 0; i < tableSize; i++){
-        // printf("this index %d has %d %d and sector %d ",i,table[i].NamePos,table[i].NameLength,table[i].sector);
-        char*ffname = new char[table[i].NameLength+1];
-        if (table[i].inUse){
-            fileSystem->filenameFile->ReadAt(ffname,table[i].NameLength,table[i].NamePos);
-            ffname[table[i].NameLength] = 0;
-            // printf("%s",ffname);
-            if (!strncmp(ffname,name,FileNameMaxLen)){
-                // printf("\n");
-                return i;
-            }
-        }
-        // printf("\n");
-    }
+    DEBUG('f', "Finding index for %s with %s\n", path, name);
+    for (int i = hashHead[HashName(name) % tableSize]; i != -1;
+            i = hashNext[i])
+        if (!strcmp(table[i].name, name))
+            return i;
     return -1;      // name not in directory
 }
 
@@ -130,10 +253,9 @@ int
 Directory::Find(char *name)
 {
     int i = FindIndex(name);
-    // printf("%s is found at %d\n",name,i);
-    if (i != -1){
+
+    if (i != -1)
        return table[i].sector;
-    }
     return -1;
 }
 
@@ -141,33 +263,35 @@ Directory::Find(char *name)
 // Directory::Add
 //  Add a file into the directory.  Return TRUE if successful;
 //  return FALSE if the file name is already in the directory, or if
-//  the directory is completely full, and has no more space for
-//  additional file names.
+//  the name is too long.  If the directory is full, it is made bigger.
 //
 //  "name" -- the name of the file being added
 //  "newSector" -- the disk sector containing the added file's header
+//  "isdir" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector, int isdir=0)
+Directory::Add(char *name, int newSector, int isdir)
 {
+    int i;
+
     name = path2name(name);
-    if (FindIndex(name) != -1)
+    if (strlen(name) > FileNameMaxLen || FindIndex(name) != -1)
        return FALSE;
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-
-            table[i].inUse = TRUE;
-            table[i].isdir = isdir;
-            table[i].NameLength = strlen(name);
-            table[i].NamePos = fileSystem->filenameFile->GetSeekPosition();
-            fileSystem->filenameFile->WriteAt(name,table[i].NameLength,table[i].NamePos);
-            table[i].sector = newSector;
-            // printf("adding for %s length:%d pos:%d\n",name,table[i].NameLength,table[i].NamePos);
-            return TRUE;
-       }
-
-    return FALSE;   // no space.  Fix when we have extensible files.
+    for (i = freeHint; i < tableSize; i++)
+        if (!table[i].inUse)
+            break;
+    if (i == tableSize)
+        Resize(2 * tableSize);  // no space; i is now the first new entry
+    freeHint = i + 1;
+
+    table[i].inUse = TRUE;
+    table[i].isdir = isdir;
+    table[i].sector = newSector;
+    strcpy(table[i].name, name);
+    Hash(i);
+    MarkDirty(i);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -184,8 +308,12 @@ Directory::Remove(char *name)
     int i = FindIndex(name);
 
     if (i == -1)
-    return FALSE;       // name not in directory
-        table[i].inUse = FALSE;
+        return FALSE;       // name not in directory
+    Unhash(i);
+    table[i].inUse = FALSE;
+    if (i < freeHint)
+        freeHint = i;
+    MarkDirty(i);
     return TRUE;
 }
 
@@ -199,12 +327,8 @@ Directory::List()
 {
     printf("- Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse) {
-            char*ffname = new char[table[i].NameLength+1];
-            fileSystem->filenameFile->ReadAt(ffname,table[i].NameLength,table[i].NamePos);
-            ffname[table[i].NameLength] = 0;
-            printf("Name: %s, Sector: %d\n", ffname, table[i].sector);
-        }
+        if (table[i].inUse)
+            printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
 }
 
 //----------------------------------------------------------------------
@@ -221,10 +345,7 @@ Directory::Print()
     printf("- Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
         if (table[i].inUse) {
-            char*ffname = new char[table[i].NameLength+1];
-            fileSystem->filenameFile->ReadAt(ffname,table[i].NameLength,table[i].NamePos);
-            ffname[table[i].NameLength] = 0;
-            printf("Name: %s, Sector: %d\n", ffname, table[i].sector);
+            printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
             hdr->FetchFrom(table[i].sector);
         }
     printf("\n");
@@ -233,42 +354,29 @@ Directory::Print()
 
 //----------------------------------------------------------------------
 // Directory::path2name
-//  extract file name from path
+//  extract file name from path -- everything after the last "/".
+//  The name is not copied; the result points into "path".
 //----------------------------------------------------------------------
 
 char*
 Directory::path2name(char*path){
-    char*file_name = new char[FileNameMaxLen];
-    int pos = -1;
-    int len = strlen(path);
-    for (int i=len-1;i>=0;i--){
-        if(path[i] == '/'){
-            pos = i+1;
-            break;
-        }
-    }
-    int i,j;
-    if(pos == -1) pos = 0;
-    for(i=pos, j=0;i<len;++i,++j){
-        file_name[j] = path[i];
-    }
+    char *slash = strrchr(path, '/');
 
-    file_name[j] = 0;
-    return file_name;
+    return (slash == NULL) ? path : slash + 1;
 }
 
 
 
 //----------------------------------------------------------------------
 // Directory::IsEmpty
-//  Find out if the directory is empty
+//  Find out if the directory is empty, but for its ".." entry
 //----------------------------------------------------------------------
 
 bool
 Directory::IsEmpty(){
     bool isempty = 1;
     for(int i=0;i<tableSize;++i){
-        if(table[i].inUse){
+        if(table[i].inUse && strcmp(table[i].name, "..")){
             isempty = 0;
             break;
         }
@@ -20,9 +20,11 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 40  // for simplicity, we assume
-                    // file names are <= 9 characters long
-#define FileNameSector 2
+#define NumDirEntries 10	// Entries in a new directory; it grows
+				// when they are all in use
+#define FileNameMaxLen 39  // for simplicity, we assume file names are
+                    // <= 39 characters long, which makes a
+                    // DirectoryEntry exactly 48 bytes
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -33,26 +35,39 @@
 
 class DirectoryEntry {
     public:
-        bool isdir;             // 0 means not dir, 1 means a file
         bool inUse;             // Is this directory entry in use?
-        int NamePos;
-        int NameLength;
+        bool isdir;             // 0 means a file, 1 means a directory
         int sector;             // Location on disk to find the
                         //   FileHeader for this file
-       // char name[FileNameMaxLen + 1];  // Text name for file, with +1 for
+        char name[FileNameMaxLen + 1];  // Text name for file, with +1 for
                         // the trailing '\0'
-
 };
 
+// Directory entries are stored on disk as is, so their size is part
+// of the disk format.  This fails to compile if it changes.
+
+typedef char DirectoryEntrySizeCheck[sizeof(DirectoryEntry) == 48 ? 1 : -1];
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file; the
+// directory grows (and the file with it) when all its entries are in
+// use.
+//
+// In memory, the entries are also chained into a hash table on the
+// file name, so a lookup only compares the names that hash alike.
+// The hash table is never stored on disk; it is rebuilt by FetchFrom,
+// which still reads the whole directory.  So is a hint at the first
+// free entry, so Add doesn't have to search the entries in use.  The
+// file system keeps recently used directories in memory (cf.
+// DirectoryCache in dcache.h), so only the first use of a directory
+// pays for reading it.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk.
+// from/to disk.  WriteBack only writes the entries that changed.
 
 class Directory {
   public:
@@ -76,16 +91,29 @@ class Directory {
     void Print();           // Verbose print of the contents
                     //  of the directory -- all the file
                     //  names and their contents.
-    char* path2name(char*name);
+    static char* path2name(char*name);  // Last component of a path
     bool IsEmpty();
     int IsDir(char*name);
   private:
     int tableSize;          // Number of directory entries
     DirectoryEntry *table;      // Table of pairs:
                     // <file name, file header location>
+    int *hashHead;          // First entry on each hash chain (there
+                    // are tableSize chains), or -1
+    int *hashNext;          // Next entry on the same chain, or -1
+    int dirtyLo, dirtyHi;       // Range of entries changed since
+                    // the last FetchFrom/WriteBack
+    int freeHint;           // No entry before this one is free
 
     int FindIndex(char *name);      // Find the index into the directory
                     //  table corresponding to "name"
+    void Resize(int newSize);       // Make room for "newSize" entries
+    void Hash(int i);           // Put entry "i" on its hash chain
+    void Unhash(int i);         // Take entry "i" off its hash chain
+    void Rehash();          // Rebuild all the hash chains
+    void MarkDirty(int i);      // Entry "i" must be written back
 };
 
+extern unsigned int HashName(char *name);  // Hash function for file names
+
 #endif // DIRECTORY_H
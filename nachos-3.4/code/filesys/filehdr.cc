@@ -5,10 +5,10 @@
 //  The file header is used to locate where on disk the
 //  file's data is stored.  We implement this as a fixed size
 //  table of pointers -- each entry in the table points to the
-//  disk sector containing that portion of the file data
-//  (in other words, there are no indirect or doubly indirect
-//  blocks). The table size is chosen so that the file header
-//  will be just big enough to fit in one disk sector,
+//  disk sector containing that portion of the file data, except
+//  the last, which points to a chain of index sectors holding the
+//  rest of the pointers.  The table size is chosen so that the file
+//  header will be just big enough to fit in one disk sector.
 //
 //      Unlike in a real system, we do not keep track of file permissions,
 //  ownership, last modification date, etc., in the file header.
@@ -41,68 +41,78 @@
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(FreeMap *freeMap, int fileSize)
 {
+    int numDirect, numIndex;
+
     size = 0;
     numBytes = fileSize;
     numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
-        return FALSE;        // not enough space
-   // If indirect index is not needed
-    if(numSectors < NumDirect){
-        for (int i = 0; i < numSectors; i++)
-            dataSectors[i] = freeMap->Find();
-    }
+    numDirect = min(numSectors, NumDirect-1);
+    numIndex = divRoundUp(numSectors - numDirect, Sector2Int-1);
+    if (freeMap->NumClear() < numSectors + numIndex)
+        return FALSE;        // not enough space (counting the index sectors)
 
-    else{ // if indirect index is needed
-        for (int i = 0; i < NumDirect; i++)   // Allocate the NumDirect sectors
-            dataSectors[i] = freeMap->Find();
+    for (int i = 0; i < numDirect; i++)
+        dataSectors[i] = freeMap->Find();
+
+    // if indirect index is needed, build the chain of index sectors;
+    // the last entry of each points to the next one
+    if (numIndex > 0) {
         int*secondary_index = new int[Sector2Int];
-        for (int i=0;i<numSectors - (NumDirect-1);++i){
-            secondary_index[i] = freeMap->Find();
+        int left = numSectors - numDirect;
+        int index = dataSectors[NumDirect-1] = freeMap->Find();
+
+        while (left > 0) {
+            int count = min(left, Sector2Int-1);
+
+            for (int i = 0; i < count; i++)
+                secondary_index[i] = freeMap->Find();
+            left -= count;
+            secondary_index[Sector2Int-1] = (left > 0) ? freeMap->Find() : -1;
+            synchDisk->WriteSector(index, (char*)secondary_index);
+            index = secondary_index[Sector2Int-1];
         }
-        synchDisk->WriteSector(dataSectors[NumDirect-1], (char*)secondary_index);
         delete []secondary_index;
     }
 
-    printf("Allocate %d sectors\n",numSectors);
+    DEBUG('f', "Allocate %d sectors\n", numSectors);
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-//  De-allocate all the space allocated for data blocks for this file.
+//  De-allocate all the space allocated for data blocks for this file,
+//  including every sector of the chain of secondary index sectors.
 //
 //  "freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 void
-FileHeader::Deallocate(BitMap *freeMap)
+FileHeader::Deallocate(FreeMap *freeMap)
 {
-    // Doesn't use secondary index
-    if(numSectors < NumDirect){
-        for (int i = 0; i < numSectors ; i++) {
-            //ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-            freeMap->Clear((int) dataSectors[i]);
-        }
+    int numDirect = min(numSectors, NumDirect - 1);
+    int left = numSectors - numDirect;
+    int index = dataSectors[NumDirect-1];
+    int *secondary_index = new int[Sector2Int];
+
+    for (int i = 0; i < numDirect; i++) {
+        //ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
+        freeMap->Clear((int) dataSectors[i]);
     }
 
-    else{
-        char*secondary_index = new char[SectorSize];
-        synchDisk->ReadSector(dataSectors[NumDirect-1], secondary_index);
-        // numSectors - (NumDirect-1) = numSectors-8
-        for (int i=0; i < numSectors - (NumDirect-1); ++i) {
-            // ASSERT(freeMap->Test((int) secondary_index[i*sizeof(int)]));  // ought to be marked!
-            freeMap->Clear((int) secondary_index[i*sizeof(int)]);
-        }
-        for(int i=0; i < NumDirect; ++i){
-            // ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-            freeMap->Clear((int) dataSectors[i]);
-        }
-        delete []secondary_index;
+    // Follow the chain of secondary index sectors
+    while (left > 0) {
+        int count = min(left, Sector2Int-1);
 
+        synchDisk->ReadSector(index, (char*)secondary_index);
+        for (int i = 0; i < count; i++)
+            freeMap->Clear(secondary_index[i]);
+        freeMap->Clear(index);
+        left -= count;
+        index = secondary_index[Sector2Int-1];
     }
-
+    delete []secondary_index;
 }
 
 //----------------------------------------------------------------------
@@ -149,9 +159,9 @@ FileHeader::ByteToSector(int offset)
     }
     else if(offset < ((NumDirect-1) + (Sector2Int-1))* SectorSize ){
         offset -= (NumDirect-1)*SectorSize;
-        char*secondary_index = new char[SectorSize];
-        synchDisk->ReadSector(dataSectors[NumDirect-1], secondary_index);
-        int res = secondary_index[(offset / SectorSize)*sizeof(int)];
+        int*secondary_index = new int[Sector2Int];
+        synchDisk->ReadSector(dataSectors[NumDirect-1], (char*)secondary_index);
+        int res = secondary_index[offset / SectorSize];
         delete []secondary_index;
         // printf("1 logical sector is %d, physical sector is %d\n",offset/SectorSize,res);
         return res;
@@ -188,6 +198,20 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// PrintTime
+//  Print a time stored in a file header, in the format of asctime.
+//  The conversion is only done here, never on the read/write path.
+//----------------------------------------------------------------------
+
+static void
+PrintTime(char *label, int when)
+{
+    time_t t = when;
+
+    printf("%s%s", label, asctime(gmtime(&t)));
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 //  Print the contents of the file header, and the contents of all
@@ -205,9 +229,9 @@ FileHeader::Print()
         printf("%d ", dataSectors[i]);
     printf("\n");
     printf("* Disk sector: %d, file type: %s\n",SectorPos,type);
-    printf("* Create time: %s\n",CreateTime );
-    printf("* Last visit time: %s\n", LastVisit);
-    printf("* last edit time: %s\n", LastEdit);
+    PrintTime("* Create time: ", createTime);
+    PrintTime("* Last visit time: ", lastVisit);
+    PrintTime("* last edit time: ", lastEdit);
 
     printf("\nFile contents:\n");
     if(numSectors < NumDirect){
@@ -236,10 +260,8 @@ FileHeader::Print()
         }
 
         // print secondary index content
-        char*secondary_index = new char[SectorSize];
-        synchDisk->ReadSector(dataSectors[NumDirect-1], secondary_index);
-        for (i = 0; i < NumSectors- (NumDirect-1) ; i++) {
-            synchDisk->ReadSector(secondary_index[i*sizeof(int)], data);
+        for (i = NumDirect-1; i < numSectors; i++) {
+            synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
             for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
                 if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
                     printf("%c", data[j]);
@@ -256,124 +278,128 @@ FileHeader::Print()
 }
 
 //----------------------------------------------------------------------
-// FileHeader::SetLastVisit and SetLastEdit
-//  When editing or reading happens, update its LastVisit and LastEdit variable
+// FileHeader::SetCreateTime, SetLastVisit and SetLastEdit
+//  When a file is created, edited or read, update its times.
+//
+//  A read only updates lastVisit as often as "atimeMode" says it
+//  should, and SetLastVisit returns whether it did, so that the
+//  caller knows if the header needs to be written back.  Reads that
+//  don't change the header cost no disk writes at all.
 //----------------------------------------------------------------------
 
 void
+FileHeader::SetCreateTime(){
+    createTime = lastVisit = lastEdit = (int) time(NULL);
+}
+
+bool
 FileHeader::SetLastVisit(){
-    time_t v_time;
-    time(&v_time);
-    strncpy(LastVisit, asctime(gmtime(&v_time)), 25);
-    LastVisit[24] = 0;
-    //printf("File is visited at %s\n", LastVisit);
+    int now;
+
+    if (atimeMode == AtimeNone)
+        return FALSE;
+    now = (int) time(NULL);
+    if (now == lastVisit)
+        return FALSE;
+    if (atimeMode == AtimeRelative && lastVisit > lastEdit
+            && now - lastVisit < RelatimeInterval)
+        return FALSE;           // already visited since the last edit
+    lastVisit = now;
+    return TRUE;
 }
 
 void
 FileHeader::SetLastEdit(){
-    time_t e_time;
-    time(&e_time);
-    strncpy(LastEdit, asctime(gmtime(&e_time)), 25);
-    LastEdit[24] = 0;
-    //printf("File is edited at %s\n", LastEdit);
+    lastEdit = (int) time(NULL);
 }
 
 
 
+//----------------------------------------------------------------------
+// IndexSectors
+//  Return how many index sectors a file of "sectors" data sectors
+//  needs: none while the direct pointers suffice, then one for every
+//  Sector2Int-1 data sectors beyond them.
+//----------------------------------------------------------------------
+
+static int
+IndexSectors(int sectors)
+{
+    if (sectors <= NumDirect-1)
+        return 0;
+    return divRoundUp(sectors - (NumDirect-1), Sector2Int-1);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Enlarge
-//  Enlarge the
+//  Grow the file by "size" bytes, allocating the data sectors (and
+//  index sectors) the new bytes need.  Return FALSE, leaving the
+//  header as it was, if there is not enough free space on disk.
+//
+//  New data pointers are appended at the end of the chain of index
+//  sectors; the first index sector is allocated when the file first
+//  outgrows its direct pointers, and every new index sector starts
+//  out with its next pointer set to -1.
+//
+//  "freeMap" is the bit map of free disk sectors
+//  "size" is the number of bytes to add to the file
 //----------------------------------------------------------------------
+
 bool
-FileHeader::Enlarge(BitMap* freeMap, int size){
-    numBytes = numBytes + size;
-    int oldNumSectors = numSectors;
-    numSectors = divRoundUp(numBytes, SectorSize);
-    int EnlargeSectors = numSectors - oldNumSectors;
-    if(EnlargeSectors == 0)
-        return true;
-    else{
-        int FreeSectors = freeMap->NumClear();
-        // printf("numclear is %d\n",FreeSectors);
-        if(FreeSectors < EnlargeSectors)
-            return false;
-    }
-    // printf("The file is increased for %d bytes, enlarging disk sectors from %d to %d\n",size,oldNumSectors,numSectors);
-    if(numSectors <= NumDirect-1){
-        for (int i = oldNumSectors; i < numSectors ; i++) {
-            // printf("* %d\n",i);
-            dataSectors[i] =  freeMap->Find();
-        }
-    }
-    else if(numSectors <= (NumDirect-1) + (Sector2Int-1) ){ // if indirect index is needed
-        int*secondary_index = new int[Sector2Int];
-        int start_pos;       // where the secondary index starts
-        if(oldNumSectors < NumDirect){
-            printf("** started to using secondary_index **\n");
-            // If it doesn't need to have secondary index before
-            for (int i = oldNumSectors; i < NumDirect; i++) {
-                dataSectors[i] = freeMap->Find();
+FileHeader::Enlarge(FreeMap *freeMap, int size)
+{
+    int newSectors = divRoundUp(numBytes + size, SectorSize);
+    int needed = newSectors - numSectors
+                 + IndexSectors(newSectors) - IndexSectors(numSectors);
+
+    if (needed > 0 && freeMap->NumClear() < needed)
+        return FALSE;           // leave the header as it was
+
+    for (int i = numSectors; i < min(newSectors, NumDirect-1); i++)
+        dataSectors[i] = freeMap->Find();
+
+    if (newSectors > NumDirect-1 && newSectors > numSectors) {
+        int *secondary_index = new int[Sector2Int];
+        int oldIndexed = max(numSectors - (NumDirect-1), 0);
+        int left = newSectors - (NumDirect-1) - oldIndexed;
+        int index, pos, i;
+
+        if (oldIndexed == 0) {
+            // the file is just outgrowing its direct pointers
+            index = dataSectors[NumDirect-1] = freeMap->Find();
+            for (i = 0; i < Sector2Int; i++)
+                secondary_index[i] = -1;
+            pos = 0;
+        } else {
+            // find the index sector holding the last data pointer
+            index = dataSectors[NumDirect-1];
+            synchDisk->ReadSector(index, (char *)secondary_index);
+            pos = oldIndexed;
+            while (pos > Sector2Int-1) {
+                pos -= Sector2Int-1;
+                index = secondary_index[Sector2Int-1];
+                synchDisk->ReadSector(index, (char *)secondary_index);
             }
-            start_pos = 0;
-        }
-        else{
-            // If secondary index is acquired in the first place.
-            char*tmp = new char[SectorSize];
-            synchDisk->ReadSector(dataSectors[NumDirect-1], tmp);
-            secondary_index = (int*)tmp;
-            start_pos = oldNumSectors - (NumDirect-1);
-        }
-        for (int i=start_pos;i<numSectors - (NumDirect-1);++i){
-            secondary_index[i] = freeMap->Find();
         }
-        synchDisk->WriteSector(dataSectors[NumDirect-1], (char*)secondary_index);
-        delete []secondary_index;
-    }
-    else{
-        int* secondary_index;
-        int* last_secondary_index;
-        int last_secondary_index_addr;
-        int tmp_pos = numSectors - (NumDirect-1);
-        int start_pos = oldNumSectors - (NumDirect-1);
-        char* tmp = new char[SectorSize];
-        synchDisk->ReadSector(dataSectors[NumDirect-1], tmp);
-        secondary_index = (int*)tmp;
-        last_secondary_index_addr = dataSectors[NumDirect-1];
-
-        while( tmp_pos > Sector2Int-1 ){
-            // printf("start_pos %d tmp_pos %d\n",start_pos,tmp_pos);
-            tmp_pos -= (Sector2Int-1);
-            start_pos -= (Sector2Int-1);
 
+        for (; left > 0; left--) {
+            if (pos == Sector2Int-1) {      // this one is full, chain another
+                int next = freeMap->Find();
 
-            if( start_pos == 0 ){
-                secondary_index[Sector2Int-1] = freeMap->Find();
-                synchDisk->WriteSector(last_secondary_index_addr, (char*)secondary_index);
-                last_secondary_index_addr = secondary_index[Sector2Int-1];
-                // printf("---new allocation %d---\n",last_secondary_index_addr);
-                secondary_index = new int [Sector2Int];
-                break;
+                secondary_index[Sector2Int-1] = next;
+                synchDisk->WriteSector(index, (char *)secondary_index);
+                index = next;
+                for (i = 0; i < Sector2Int; i++)
+                    secondary_index[i] = -1;
+                pos = 0;
             }
-            last_secondary_index_addr = secondary_index[Sector2Int-1];
-            synchDisk->ReadSector(secondary_index[Sector2Int-1], tmp);
-
-
-            secondary_index = (int*)tmp;
-            // printf("last_secondary_index %d\n",last_secondary_index_addr);
-        }
-
-        //printf("writing into %d\n",last_secondary_index_addr);
-        for (int i=start_pos;i<tmp_pos;++i){
-            secondary_index[i] = freeMap->Find();
+            secondary_index[pos++] = freeMap->Find();
         }
-
-        synchDisk->WriteSector(last_secondary_index_addr, (char*)secondary_index);
-        delete []secondary_index;
-
+        synchDisk->WriteSector(index, (char *)secondary_index);
+        delete [] secondary_index;
     }
-    return true;
 
+    numBytes += size;
+    numSectors = newSectors;
+    return TRUE;
 }
-
-
-
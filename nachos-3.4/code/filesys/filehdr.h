@@ -15,11 +15,23 @@
 #define FILEHDR_H
 
 #include "disk.h"
-#include "bitmap.h"
+#include "freemap.h"
 
-#define NumDirect 	((SectorSize - 4 * sizeof(int) - 79 ) / sizeof(int)) // 33 / 4 = 8
-#define Sector2Int  (SectorSize / sizeof(int))        // 128 / 4 = 32
-#define MaxFileSize ((NumDirect + (Sector2Int-1)) * SectorSize)  // 40*128 = 5120
+#define NumDirect 	((int) ((SectorSize - 8 * sizeof(int)) / sizeof(int))) // 96 / 4 = 24
+#define Sector2Int  ((int) (SectorSize / sizeof(int)))        // 128 / 4 = 32
+
+// How eagerly a read updates the last visit time of a file (cf. the
+// "strictatime", "relatime" and "noatime" mount options of Linux).
+// Updating it dirties the header, which then has to be written back.
+
+enum AtimeMode {
+    AtimeStrict,		// every read updates it
+    AtimeRelative,		// only the first read after an edit, or
+				// once every RelatimeInterval seconds
+    AtimeNone			// reads never update it
+};
+
+#define RelatimeInterval	(24 * 60 * 60)
 
 // The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
@@ -29,8 +41,11 @@
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.  The first NumDirect-1 pointers name data
+// sectors directly; the last one names the first of a chain of
+// index sectors, each holding Sector2Int-1 more data pointers and
+// the number of the next index sector (-1 at the end of the chain).
+// A file can thus grow until the disk is full.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -38,10 +53,10 @@
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header,
+    bool Allocate(FreeMap *freeMap, int fileSize);// Initialize a file header,
 						//  including allocating space
 						//  on disk for the file data
-    void Deallocate(BitMap *bitMap);  		// De-allocate this file's
+    void Deallocate(FreeMap *freeMap);		// De-allocate this file's
 						//  data blocks
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
@@ -56,16 +71,19 @@ class FileHeader {
 					// in bytes
 
     void Print();			// Print the contents of the file.
-    void SetLastVisit();
-    void SetLastEdit();
-    bool Enlarge(BitMap*freeMap, int size);
+    void SetCreateTime();		// Set all times to now (new file)
+    bool SetLastVisit();		// The file was read; return TRUE if
+					// that changed the header
+    void SetLastEdit();			// The file was written
+    bool Enlarge(FreeMap *freeMap, int size);
 
     int SectorPos;
     int size;
     char type[4];
-    char CreateTime[25];
-    char LastVisit[25];
-    char LastEdit[25];
+    int createTime;			// Times are in seconds since the
+    int lastVisit;			// UNIX epoch; they are kept as
+    int lastEdit;			// ints so the header layout doesn't
+					// depend on the host's time_t
 
 
     int numBytes;			// Number of bytes in the file
@@ -24,9 +24,9 @@
 //  For those operations (such as Create, Remove) that modify the
 //  directory and/or bitmap, if the operation succeeds, the changes
 //  are written immediately back to disk (the two files are kept
-//  open during all this time).  If the operation fails, and we have
-//  modified part of the directory and/or bitmap, we simply discard
-//  the changed version, without writing it back to disk.
+//  open during all this time).  Recently used directories and the
+//  bitmap are kept in memory all the time (cf. DirectoryCache in
+//  dcache.h), so a failed operation must undo its changes to them.
 //
 //  Our implementation at this point has the following restrictions:
 //
@@ -35,9 +35,10 @@
 //     files cannot be bigger than about 3KB in size
 //     there is no hierarchical directory structure, and only a limited
 //       number of files can be added to the system
-//     there is no attempt to make the system robust to failures
-//      (if Nachos exits in the middle of an operation that modifies
-//      the file system, it may corrupt the disk)
+//
+//  Operations that modify the directory and/or bitmap are journaled
+//  (cf. journal.h), so if Nachos exits in the middle of one, the disk
+//  is restored to a consistent state the next time it is mounted.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -46,28 +47,19 @@
 #include "copyright.h"
 #include "time.h"
 #include "disk.h"
-#include "bitmap.h"
+#include "freemap.h"
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "inode.h"
+#include "dcache.h"
+#include "fsck.h"
 #include "system.h"
 
-// Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known
-// sectors, so that they can be located on boot-up.
-#define FreeMapSector       0
-#define DirectorySector     1
-#define FilenameSector      2
-#define PipeSector          3
-
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize     (NumSectors / BitsInByte)
-#define NumDirEntries       10
-#define FilenameFileSize    40
+// Initial file sizes for the bitmap and directory; directories grow
+// when they fill up.
+#define FreeMapFileSize     (divRoundUp(NumSectors, BitsInWord) * sizeof(int))
 #define DirectoryFileSize   (sizeof(DirectoryEntry) * NumDirEntries)
-#define PipeFileSize        100
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 //  Initialize the file system.  If format = TRUE, the disk has
@@ -84,13 +76,11 @@
 FileSystem::FileSystem(bool format)
 {
     DEBUG('f', "Initializing the file system.\n");
+    freeMap = new FreeMap(NumSectors);
     if (format) {
-        BitMap *freeMap      = new BitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
         FileHeader *mapHdr   = new FileHeader;
         FileHeader *dirHdr   = new FileHeader;
-        FileHeader *nameHdr  = new FileHeader;
-        FileHeader *pipeHdr  = new FileHeader;
 
         DEBUG('f', "Formatting the file system.\n");
 
@@ -98,16 +88,13 @@ FileSystem::FileSystem(bool format)
         // (make sure no one else grabs these!)
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
-        freeMap->Mark(FilenameSector);
-        freeMap->Mark(PipeSector);
+        journal->Reserve(freeMap);
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
 
         ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
         ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
-        ASSERT(nameHdr->Allocate(freeMap, FilenameFileSize));
-        ASSERT(pipeHdr->Allocate(freeMap, PipeFileSize));
 
         // Flush the bitmap and directory FileHeaders back to disk
         // We need to do this before we can "Open" the file, since open
@@ -117,16 +104,12 @@ FileSystem::FileSystem(bool format)
         DEBUG('f', "Writing headers back to disk.\n");
         mapHdr->WriteBack(FreeMapSector);
         dirHdr->WriteBack(DirectorySector);
-        nameHdr->WriteBack(FilenameSector);
-        pipeHdr->WriteBack(PipeSector);
         // OK to open the bitmap and directory files now
         // The file system operations assume these two files are left open
         // while Nachos is running.
 
         freeMapFile   = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
-        filenameFile  = new OpenFile(FilenameSector);
-        pipeFile      = new OpenFile(PipeSector);
 
         // Once we have the files "open", we can write the initial version
         // of each file back to disk.  The directory at this point is completely
@@ -141,22 +124,77 @@ FileSystem::FileSystem(bool format)
         if (DebugIsEnabled('f')) {
             freeMap->Print();
             directory->Print();
-            delete freeMap;
-            delete directory;
-            delete mapHdr;
-            delete dirHdr;
         }
+        delete directory;
+        delete mapHdr;
+        delete dirHdr;
     }
     else {
     // if we are not formatting the disk, just open the files representing
     // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
-        filenameFile  = new OpenFile(FilenameSector);
-        pipeFile      = new OpenFile(PipeSector);
+
+    // the bitmap is also kept in memory from now on
+        freeMap->FetchFrom(freeMapFile);
     }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+//  Close the files that are kept open while Nachos is running.
+//  Their headers are written back when the in-core header table
+//  is deleted (or synced).
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    freeMap->Flush(freeMapFile);
+    delete freeMap;
+    delete freeMapFile;
+    delete directoryFile;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+//  Write back every file header that was modified in memory, and
+//  commit the journal.  File data is always written through to disk,
+//  so after this the disk is up to date (and, with -msync, so is the
+//  UNIX file holding it).
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    inodeTable->Sync();
+    journal->Commit();
+    synchDisk->Flush();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Check
+//  Check the consistency of the file system on disk, while it is in
+//  use, and return the number of problems found.  First bring the
+//  disk up to date, so the checker can read it directly.  Nothing is
+//  repaired: that is only safe before the file system is mounted
+//  (cf. the -fsck flag).
+//----------------------------------------------------------------------
+
+int
+FileSystem::Check()
+{
+    Fsck *fsck;
+    int problems;
+
+    freeMap->Flush(freeMapFile);
+    Sync();
+    journal->Checkpoint();
+    fsck = new Fsck(FALSE);
+    problems = fsck->Run();
+    delete fsck;
+    return problems;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Create
 //  Create a file in the Nachos file system (similar to UNIX create).
@@ -190,89 +228,79 @@ bool
 FileSystem::Create(char *name, int initialSize)
 {
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
     int sector;
     bool success;
 
+    char *leaf;
+
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
     // Find the parent directory of the target file
-    int parent_dir_sector = FindDir(name);
+    int parent_dir_sector = WalkPath(name, &leaf);
 
-    DEBUG("f","%s 's parent_dir_sector %d\n",name,parent_dir_sector);
+    DEBUG('f', "%s 's parent_dir_sector %d\n", name, parent_dir_sector);
 
+    if (parent_dir_sector < 0 || *leaf == '\0')
+        return FALSE;           // no such parent directory
     OpenFile* parent_dir = new OpenFile(parent_dir_sector);
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(parent_dir);
+    journal->Begin();           // all or nothing of it reaches the disk
+    directory = dirCache->Get(parent_dir_sector);
 
     int isdir = 0;
     if (initialSize==-1){
         isdir = 1;
         initialSize = DirectoryFileSize;
     }
-    if (directory->Find(name) != -1){
-        return FALSE;          // file is already in directory
-    }
+    if (directory->Find(leaf) != -1)
+        success = FALSE;        // file is already in directory
+    else if (!strcmp(leaf, ".") || !strcmp(leaf, ".."))
+        success = FALSE;        // names reserved for directories
+    else if (strlen(leaf) > FileNameMaxLen)
+        success = FALSE;        // name too long for a directory entry
     else{
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();   // find a sector to hold the file header
+        // find a sector to hold the file header, near the directory
+        sector = freeMap->FindNear(parent_dir_sector);
 
-        // printf("%s is allocated with sector %d\n",name,sector);
         if (sector == -1)
             success = FALSE;        // no free block for file header
-        else if (!directory->Add(name, sector, isdir)){
-                success =  FALSE;    // no space in directory
+        else if (!directory->Add(leaf, sector, isdir)){
+                success =  FALSE;    // can't add the name
+                freeMap->Clear(sector);
             }
         else{
             hdr = new FileHeader;
-            if (!hdr->Allocate(freeMap, initialSize))
+            if (!hdr->Allocate(freeMap, initialSize)) {
                     success = FALSE;    // no space on disk for data
+                    freeMap->Clear(sector);
+                    directory->Remove(leaf);
+            }
             else {
 
                 success = TRUE;
                 // Add file type
-                int i,j = 0;
-                for (i=0;i<strlen(name);++i)
-                    if(name[i]==".")
-                        break;
-                for(i = i+1;i<strlen(name);++i,++j){
-                    hdr->type[j] = name[i];
-                }
-                hdr->type[j] = 0;
+                char *ext = strrchr(leaf, '.');
+                strncpy(hdr->type, (ext == NULL) ? "" : ext + 1, 3);
+                hdr->type[3] = 0;
 
                 // Add file createTime
-                time_t c_time;
-                time(&c_time);
-                strncpy(hdr->CreateTime, asctime(gmtime(&c_time)), 25);
-                hdr->CreateTime[24] = 0;
-                if(isdir) printf("Directory ");
-                else printf("File ");
-                printf("%s is created, header in %d\n",name,sector);
+                hdr->SetCreateTime();
+                DEBUG('f', "%s %s is created, header in %d\n",
+                        isdir ? "Directory" : "File", name, sector);
 
                 hdr->SectorPos = sector;
-                hdr->SetLastVisit();
-                hdr->SetLastEdit();
 
                 // everthing worked, flush all changes back to disk
                 hdr->WriteBack(sector);
-                // printf("flush back\n");
+                dentryCache->Enter(parent_dir_sector, leaf, sector, isdir);
                 directory->WriteBack(parent_dir);
-                // directory->Print();
-                freeMap->WriteBack(freeMapFile);
-                // if(!isdir){
-                //     Directory* test_dir = new Directory(NumDirEntries);
-                //     OpenFile* test_file = new OpenFile(parent_dir_sector);
-
-                //     test_dir->FetchFrom(test_file);
-                //     test_dir->Find(name);
-                // }
+                freeMap->Flush(freeMapFile);
 
                 if(isdir){
                     Directory* dir = new Directory(NumDirEntries);
                     OpenFile* dir_file = new OpenFile(sector);
+                    dir->Add("..", parent_dir_sector, 1);
                     dir->WriteBack(dir_file);
                     delete dir;
                     delete dir_file;
@@ -281,10 +309,10 @@ FileSystem::Create(char *name, int initialSize)
             }
             delete hdr;
         }
-        delete freeMap;
     }
 
-    delete directory;
+    delete parent_dir;
+    journal->End();
     return success;
 }
 
@@ -301,29 +329,23 @@ FileSystem::Create(char *name, int initialSize)
 OpenFile *
 FileSystem::Open(char *name)
 {
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
     int sector;
+    char *leaf;
 
-    int parent_dir_sector = FindDir(name);
+    int parent_dir_sector = WalkPath(name, &leaf);
 
-    printf("Opening file %s under directory at sector %d\n", name,parent_dir_sector);
-    // Open father directory
-    if(parent_dir_sector >= 0){
-        openFile = new OpenFile(parent_dir_sector);
-    }
-    directory->FetchFrom(openFile);
+    DEBUG('f', "Opening file %s under directory at sector %d\n",
+            name, parent_dir_sector);
+    if (parent_dir_sector < 0)
+        return NULL;                // no such parent directory
 
     // Find your file under father directory
-    sector = directory->Find(name);
-    if (sector >= 0){
-        printf("%s is at %d\n",name,sector );
+    sector = Lookup(parent_dir_sector, leaf, NULL);
+    if (sector >= 0)
         openFile = new OpenFile(sector);    // name was found in directory
-    }
-    else{
-        printf("file not found error at %d\n",sector);
-    }
-    delete directory;
+    else
+        DEBUG('f', "File %s not found\n", name);
     return openFile;                // return NULL if not found
 }
 
@@ -336,7 +358,9 @@ FileSystem::Open(char *name)
 //      Write changes to directory, bitmap back to disk
 //
 //  Return TRUE if the file was deleted, FALSE if the file wasn't
-//  in the file system.
+//  in the file system, or is in use.  A directory is in use while
+//  it isn't empty, or while it is the working directory of some
+//  thread (which holds its header in core, cf. ChangeDir).
 //
 //  "name" -- the text name of the file to be removed
 //----------------------------------------------------------------------
@@ -345,59 +369,50 @@ bool
 FileSystem::Remove(char *name)
 {
     Directory *directory;
-    BitMap *freeMap;
-    FileHeader *fileHdr;
-    OpenFile* openFile = NULL;
+    Inode *inode;
+    OpenFile* openFile;
 
     int sector;
-    int dir_sector = FindDir(name);
-    if(dir_sector>=0)
-        openFile = new OpenFile(dir_sector);
+    char *leaf;
+    int dir_sector = WalkPath(name, &leaf);
+    if (dir_sector < 0)
+        return FALSE;               // no such parent directory
+    if (!strcmp(leaf, ".") || !strcmp(leaf, ".."))
+        return FALSE;               // not an entry we can remove
+    directory = dirCache->Get(dir_sector);
+    sector = directory->Find(leaf);
+
+    if (sector == -1)
+       return FALSE;             // file not found
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(openFile);
-    sector = directory->Find(name);
-    printf("Removing file with %d users\n",
-            synchDisk->ownerCount[sector]);
-    if(synchDisk->ownerCount[sector] > 0){
+    if (inodeTable->RefCount(sector) > 0) {
         printf("Unable to delete file.%d users are still using this file at the moment\n",
-            synchDisk->ownerCount[sector]);
-        return false;
+            inodeTable->RefCount(sector));
+        return FALSE;
     }
 
-    if (sector == -1) {
-       delete directory;
-       return FALSE;             // file not found
+    // the parent was got last, so getting the child can't evict it
+    if (directory->IsDir(leaf) == 1 && !dirCache->Get(sector)->IsEmpty()) {
+        printf("omited file that is not empty.\n");
+        return FALSE;
     }
 
-    if(directory->IsDir(name)==1){
-        Directory*tmp_dir  = new Directory(NumDirEntries);
-        OpenFile *tmp_file = new OpenFile(sector);
-        tmp_dir->FetchFrom(tmp_file);
-        if(!tmp_dir->IsEmpty()){
-            printf("omited file that is not empty.\n");
-            return FALSE;
-        }
-        delete tmp_dir;
-        delete tmp_file;
-    }
-
-
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
-
-    fileHdr->Deallocate(freeMap);       // remove data blocks
+    journal->Begin();               // all or nothing of it reaches the disk
+    inode = inodeTable->Acquire(sector);
+    inode->hdr.Deallocate(freeMap);     // remove data blocks
+    inodeTable->Release(inode);
+    inodeTable->Invalidate(sector);     // forget the in-core header
     freeMap->Clear(sector);         // remove header block
-    directory->Remove(name);
-
-    freeMap->WriteBack(freeMapFile);        // flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
-    delete fileHdr;
-    delete directory;
-    delete freeMap;
+    directory->Remove(leaf);
+    dentryCache->Invalidate(dir_sector, leaf);
+    dentryCache->Invalidate(sector, "..");  // in case it was a
+    dirCache->Invalidate(sector);           //  directory
+
+    openFile = new OpenFile(dir_sector);
+    freeMap->Flush(freeMapFile);            // flush to disk
+    directory->WriteBack(openFile);         // flush to disk
+    journal->End();
+    delete openFile;
     return TRUE;
 }
 
@@ -409,17 +424,12 @@ FileSystem::Remove(char *name)
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+    dirCache->Get(DirectorySector)->List();
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Print
 //  Print everything about the file system:
-//    the contents of the bitmap
 //    the contents of the directory
 //    for each file in the directory,
 //        the contents of the file header
@@ -429,98 +439,146 @@ FileSystem::List()
 void
 FileSystem::Print()
 {
-    FileHeader *bitHdr = new FileHeader;
-    FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    dirCache->Get(DirectorySector)->Print();
+}
 
-    // printf("Bit map file header:\n");
-    // bitHdr->FetchFrom(FreeMapSector);
-    // bitHdr->Print();
 
-    // printf("Directory file header:\n");
-    // dirHdr->FetchFrom(DirectorySector);
-    // dirHdr->Print();
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+//  Find "name" in the directory whose header is at "dirSector", and
+//  return the sector of its header, or -1 if there is no such file.
+//  Recent lookups are remembered in the directory entry cache, so a
+//  hot path doesn't have to search the directory at all; otherwise the
+//  directory is searched in the directory cache, and only read from
+//  disk if it isn't there either.
+//
+//  "isdir" -- if not NULL, set to whether the file is a directory
+//----------------------------------------------------------------------
 
-    // freeMap->FetchFrom(freeMapFile);
-    // freeMap->Print();
+int
+FileSystem::Lookup(int dirSector, char *name, bool *isdir)
+{
+    Directory *directory;
+    int sector;
+    bool dir;
 
-    directory->FetchFrom(directoryFile);
-    directory->Print();
+    if (dirSector == DirectorySector && !strcmp(name, "..")) {
+        if (isdir != NULL)
+            *isdir = TRUE;
+        return DirectorySector;     // the root is its own parent
+    }
+    if (dentryCache->Lookup(dirSector, name, &sector, isdir))
+        return sector;
 
-    delete bitHdr;
-    delete dirHdr;
-    delete freeMap;
-    delete directory;
+    directory = dirCache->Get(dirSector);
+    sector = directory->Find(name);
+    if (sector >= 0) {
+        dir = (directory->IsDir(name) == 1);
+        if (isdir != NULL)
+            *isdir = dir;
+        dentryCache->Enter(dirSector, name, sector, dir);
+    }
+    return sector;
 }
 
-
 //----------------------------------------------------------------------
-// FileSystem::FindDir
-//  Find directory position according to "/" in file name
+// FileSystem::WalkPath
+//  Resolve every component of "path" but the last, in a single pass.
+//  Return the sector of the header of the directory that should hold
+//  the last component, and set "leaf" to point at the last component
+//  (within "path").  Return -1 if some directory along the path doesn't
+//  exist, or isn't a directory.
+//
+//  A path starting with "/" is looked up from the root directory; any
+//  other path, from the current thread's working directory.  Empty and
+//  "." components are skipped; ".." is looked up like any other name,
+//  since every directory but the root has a ".." entry naming its
+//  parent (cf. Lookup for the root).  There is no limit on the length
+//  of the path or of its components.
+//
+//  "path" -- the path name to resolve
+//  "leaf" -- set to the last component of the path; may be ""
 //----------------------------------------------------------------------
 
 int
-FileSystem::FindDir(char*name){
-    // Starting from root directory
-    int sector = DirectorySector;
-    OpenFile * parent_file = new OpenFile(sector);
-    Directory* parent_dir  = new Directory(NumDirEntries);
-    parent_dir->FetchFrom(parent_file);
-
-
-    int dir_pos = 0;
-    int subdir_pos = 0;
-    char subdir[20];
-    int nameLength = strlen(name);
-    // printf("Finding parent directory for %s\n",name);
-    while(dir_pos < nameLength){
-        subdir[subdir_pos++] = name[dir_pos++];
-        // printf("%c\n",name[dir_pos]);
-        if(name[dir_pos] == '/'){
-            subdir[subdir_pos] = 0;
-            sector = parent_dir->Find(subdir);
-            // printf("** sub dir is in %d\n",sector);
-            parent_file = new OpenFile(sector);
-            parent_dir  = new Directory(NumDirEntries);
-            parent_dir->FetchFrom(parent_file);
-            dir_pos++;
-            subdir_pos = 0;
+FileSystem::WalkPath(char *path, char **leaf)
+{
+    int sector = (*path == '/') ? DirectorySector : CurrentDir();
+    char *component = new char[strlen(path) + 1];
+    char *end;
+    bool isdir;
+
+    while (*path == '/')
+        path++;
+    while ((end = strchr(path, '/')) != NULL) {
+        strncpy(component, path, end - path);
+        component[end - path] = '\0';
+        if (*component != '\0' && strcmp(component, ".")) {
+            sector = Lookup(sector, component, &isdir);
+            if (sector < 0 || !isdir) {
+                sector = -1;        // no such directory
+                break;
+            }
         }
+        for (path = end; *path == '/'; path++)
+            ;
     }
+    delete [] component;
+    if (leaf != NULL)
+        *leaf = path;
     return sector;
-
 }
 
 //----------------------------------------------------------------------
-// FileSystem::RopPipe
-//  Read data from the pipe
+// FileSystem::FindDir
+//  Find directory position according to "/" in file name.
+//  Return the sector of the parent directory's header, or -1 if some
+//  directory along the path doesn't exist.
 //----------------------------------------------------------------------
+
 int
-FileSystem::PopPipe(char*data){
-    FileHeader*fileHdr = new FileHeader;
-    fileHdr->FetchFrom(PipeSector);
-    int length = fileHdr->size;
-    fileHdr->WriteBack(PipeSector);
-    pipeFile->Read(data,length);
-    pipeFile->Clear();
+FileSystem::FindDir(char*name){
+    return WalkPath(name, NULL);
 }
 
-
-
 //----------------------------------------------------------------------
-// FileSystem::PushPipe
-//  Write data to the pipe
+// FileSystem::CurrentDir
+//  Return the header sector of the current thread's working directory.
 //----------------------------------------------------------------------
-void
-FileSystem::PushPipe(char*data){
-    pipeFile->Write(data,strlen(data)+1);
-    FileHeader*fileHdr = new FileHeader;
-    fileHdr->FetchFrom(PipeSector);
-    fileHdr->WriteBack(PipeSector);
-}
-
-
 
+int
+FileSystem::CurrentDir()
+{
+    if (currentThread == NULL || currentThread->cwd == NULL)
+        return DirectorySector;
+    return currentThread->cwd->sector;
+}
 
+//----------------------------------------------------------------------
+// FileSystem::ChangeDir
+//  Make the directory "path" the working directory of the current
+//  thread (and of the threads it creates from now on).  Relative path
+//  names are then looked up from there, without walking from the root.
+//  The header of the directory is held in core while it is the working
+//  directory, so that Remove can tell it is in use.
+//  Return FALSE if "path" is not a directory.
+//
+//  "path" -- the new working directory
+//----------------------------------------------------------------------
 
+bool
+FileSystem::ChangeDir(char *path)
+{
+    char *leaf;
+    bool isdir = TRUE;
+    int sector = WalkPath(path, &leaf);
+
+    if (sector >= 0 && *leaf != '\0' && strcmp(leaf, "."))
+        sector = Lookup(sector, leaf, &isdir);
+    if (sector < 0 || !isdir)
+        return FALSE;
+    if (currentThread->cwd != NULL)
+        inodeTable->Release(currentThread->cwd);
+    currentThread->cwd = inodeTable->Acquire(sector);
+    return TRUE;
+}
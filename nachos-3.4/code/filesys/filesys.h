@@ -64,6 +64,14 @@ class FileSystem {
 };
 
 #else // FILESYS
+class FreeMap;
+
+// Sectors containing the file headers for the bitmap of free sectors,
+// and the directory of files.  These file headers are placed in well-known
+// sectors, so that they can be located on boot-up.
+#define FreeMapSector       0
+#define DirectorySector     1
+
 class FileSystem {
     public:
         FileSystem(bool format);        // Initialize the file system.
@@ -72,6 +80,7 @@ class FileSystem {
                         // If "format", there is nothing on
                     // the disk, so initialize the directory
                         // and the bitmap of free blocks.
+        ~FileSystem();          // Close the bitmap and directory files
 
         bool Create(char *name, int initialSize);
                     // Create a file (UNIX creat)
@@ -83,16 +92,28 @@ class FileSystem {
         void List();            // List all the files in the file system
 
         void Print();           // List all the files and their contents
-        int FindDir(char*name);
-        int PopPipe(char*data);
-        void PushPipe(char*data);
+        void Sync();            // Write back all modified file headers
+        int Check();            // Check the disk for consistency;
+                    // return the number of problems
+        int FindDir(char*name);     // Parent directory of a path
+        int WalkPath(char *path, char **leaf);
+                    // Resolve a path to its parent
+                    // directory and last component
+        bool ChangeDir(char *path); // Change the working directory
+                    // of the current thread
 
         OpenFile* freeMapFile;       // Bit map of free disk blocks,
                     // represented as a file
+        FreeMap* freeMap;           // The same bit map, kept in memory
         OpenFile* directoryFile;     // "Root" directory -- list of
                     // file names, represented as a file
-        OpenFile* filenameFile;
-        OpenFile* pipeFile;
+
+    private:
+        int Lookup(int dirSector, char *name, bool *isdir);
+                    // Find a file in one directory, through
+                    // the directory entry cache
+        int CurrentDir();           // Working directory of the current
+                    // thread
 };
 
 #endif // FILESYS
@@ -0,0 +1,206 @@
+// freemap.cc
+//	Routines to manage the in-memory map of free disk sectors.
+//
+//	We assume mutual exclusion is provided by the caller, as for
+//	the rest of the file system.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "freemap.h"
+#include "openfile.h"
+
+//----------------------------------------------------------------------
+// FreeMap::FreeMap
+// 	Initialize a map in which every sector is free.  Call FetchFrom
+//	to read the real map from disk.
+//
+//	"nitems" is the number of sectors on the disk
+//----------------------------------------------------------------------
+
+FreeMap::FreeMap(int nitems) : BitMap(nitems)
+{
+    int numTracks = divRoundUp(nitems, SectorsPerTrack);
+
+    trackFree = new int[numTracks];
+    for (int t = 0; t < numTracks; t++)
+        trackFree[t] = 0;
+    for (int i = 0; i < nitems; i++)
+        trackFree[i / SectorsPerTrack]++;
+
+    numMapSectors = divRoundUp(numWords * sizeof(unsigned int), SectorSize);
+    dirty = new bool[numMapSectors];
+    for (int i = 0; i < numMapSectors; i++)
+        dirty[i] = TRUE;		// nothing is on disk yet
+    lastAlloc = 0;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::~FreeMap
+// 	De-allocate the map.  Any changes not yet flushed are lost.
+//----------------------------------------------------------------------
+
+FreeMap::~FreeMap()
+{
+    delete [] trackFree;
+    delete [] dirty;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Changed
+// 	Bit "which" was just set or cleared: adjust the free count of its
+//	track, and remember that its part of the map must be written back.
+//----------------------------------------------------------------------
+
+void
+FreeMap::Changed(int which)
+{
+    if (Test(which))
+        trackFree[which / SectorsPerTrack]--;
+    else
+        trackFree[which / SectorsPerTrack]++;
+    dirty[(which / BitsInByte) / SectorSize] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Mark, FreeMap::Clear
+// 	Mark a sector as in use, or as free.
+//----------------------------------------------------------------------
+
+void
+FreeMap::Mark(int which)
+{
+    if (!Test(which)) {
+        BitMap::Mark(which);
+        Changed(which);
+    }
+}
+
+void
+FreeMap::Clear(int which)
+{
+    if (Test(which)) {
+        BitMap::Clear(which);
+        Changed(which);
+    }
+}
+
+//----------------------------------------------------------------------
+// FreeMap::FindNear
+// 	Allocate a free sector, as close as we can to "sector": on its
+//	track if possible, otherwise on the next track that has a free
+//	sector (wrapping around to the first track).  Return -1 if the
+//	disk is full.
+//
+//	"sector" -- where we would like the new sector to be
+//----------------------------------------------------------------------
+
+int
+FreeMap::FindNear(int sector)
+{
+    int numTracks = divRoundUp(numBits, SectorsPerTrack);
+    int track, which;
+
+    if (numClear == 0)
+        return -1;
+    if (sector < 0 || sector >= numBits)
+        sector = 0;
+    track = sector / SectorsPerTrack;
+    // the last time around, we look at the start of our own track
+    for (int n = 0; n <= numTracks; n++) {
+        int t = (track + n) % numTracks;
+        int lo = t * SectorsPerTrack;
+        int hi = lo + SectorsPerTrack;
+
+        if (trackFree[t] == 0)
+            continue;
+        if (hi > numBits)
+            hi = numBits;
+        if (n == 0)
+            lo = sector;	// on our own track, try after "sector" first
+        which = FindInRange(lo, hi);
+        if (which != -1) {
+            Mark(which);
+            lastAlloc = which;
+            return which;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Find
+// 	Allocate a free sector, preferably right after the one allocated
+//	last, so that the sectors of a file being allocated one after the
+//	other end up next to each other.
+//----------------------------------------------------------------------
+
+int
+FreeMap::Find()
+{
+    return FindNear(lastAlloc + 1);
+}
+
+//----------------------------------------------------------------------
+// FreeMap::FetchFrom
+// 	Read the whole map from disk, and recompute the counts.
+//
+//	"file" is the place to read the map from
+//----------------------------------------------------------------------
+
+void
+FreeMap::FetchFrom(OpenFile *file)
+{
+    int numTracks = divRoundUp(numBits, SectorsPerTrack);
+
+    BitMap::FetchFrom(file);
+    for (int t = 0; t < numTracks; t++)
+        trackFree[t] = 0;
+    for (int i = 0; i < numBits; i++)
+        if (!Test(i))
+            trackFree[i / SectorsPerTrack]++;
+    for (int i = 0; i < numMapSectors; i++)
+        dirty[i] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::WriteBack
+// 	Write the whole map to disk.
+//
+//	"file" is the place to write the map to
+//----------------------------------------------------------------------
+
+void
+FreeMap::WriteBack(OpenFile *file)
+{
+    BitMap::WriteBack(file);
+    for (int i = 0; i < numMapSectors; i++)
+        dirty[i] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Flush
+// 	Write back only the sectors of the map that changed since the
+//	last time.  All the changes made by one file system operation
+//	go to disk together, one write per changed sector of the map.
+//
+//	"file" is the place to write the map to
+//----------------------------------------------------------------------
+
+void
+FreeMap::Flush(OpenFile *file)
+{
+    int mapBytes = numWords * sizeof(unsigned int);
+
+    for (int i = 0; i < numMapSectors; i++)
+        if (dirty[i]) {
+            int bytes = mapBytes - i * SectorSize;
+
+            if (bytes > SectorSize)
+                bytes = SectorSize;
+            file->WriteAt((char *)map + i * SectorSize, bytes, i * SectorSize);
+            dirty[i] = FALSE;
+        }
+}
@@ -0,0 +1,61 @@
+// freemap.h
+//	Data structures for the map of free disk sectors.
+//
+//	The free map is a bitmap with one bit per disk sector, stored
+//	on disk as a file.  The file system keeps it in memory all the
+//	time; it is read from disk once, when the file system starts,
+//	and only the parts of it that change are written back.
+//
+//	On top of the plain bitmap, we keep a count of the free sectors
+//	on each track, so that a new sector can be allocated on the same
+//	track as (or a track close to) a sector it will be used with --
+//	say, a file's data next to its header -- and tracks with no free
+//	sectors can be skipped without looking at them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef FREEMAP_H
+#define FREEMAP_H
+
+#include "bitmap.h"
+#include "disk.h"
+
+// The following class defines the in-memory free map.  Mark, Clear and
+// Find hide the BitMap versions, so that the per-track counts and the
+// list of changed map sectors stay up to date.
+
+class FreeMap : public BitMap {
+  public:
+    FreeMap(int nitems);		// Initialize an empty map of
+					// "nitems" sectors
+    ~FreeMap();				// De-allocate the map
+
+    void Mark(int which);		// Sector "which" is in use
+    void Clear(int which);		// Sector "which" is free
+    int Find();				// Allocate a sector near the one
+					// allocated last
+    int FindNear(int sector);		// Allocate a sector as close as
+					// possible to "sector"
+    int TrackFree(int track) { return trackFree[track]; }
+					// Free sectors on "track"
+
+    void FetchFrom(OpenFile *file);	// Read the whole map from disk
+    void WriteBack(OpenFile *file);	// Write the whole map to disk
+    void Flush(OpenFile *file);		// Write the changed parts of the
+					// map to disk
+
+  private:
+    void Changed(int which);		// Bit "which" changed value
+
+    int *trackFree;			// Free sectors on each track
+    int numMapSectors;			// Size of the map on disk
+    bool *dirty;			// Which sectors of the map file
+					// changed since written back
+    int lastAlloc;			// The sector we allocated last
+};
+
+#endif // FREEMAP_H
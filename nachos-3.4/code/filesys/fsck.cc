@@ -0,0 +1,440 @@
+// fsck.cc
+//	Routines to check (and repair) the consistency of the file system.
+//
+//	Everything is done on a copy of the disk in memory, read in with
+//	a few large reads; only the sectors that are repaired are written
+//	back, through the synchronous disk.  So checking the whole disk
+//	takes hardly any simulated time.
+//
+//	The caller must make sure the disk image is up to date (nothing
+//	left in the journal, no modified file headers in memory).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "fsck.h"
+#include "directory.h"
+#include "filesys.h"
+#include "system.h"
+
+#define NoOwner		-1
+
+//----------------------------------------------------------------------
+// Fsck::Fsck
+// 	Set up the checker.  Sectors that belong to the journal are not
+//	part of any file, but are always in use.
+//
+//	"fixProblems" -- should the problems found be fixed?
+//----------------------------------------------------------------------
+
+Fsck::Fsck(bool fixProblems)
+{
+    repair = fixProblems;
+    limit = (journal != NULL && journal->IsEnabled()) ? JournalStart
+                                                      : NumSectors;
+    numChunks = divRoundUp(NumSectors, FsckChunk);
+    chunks = new char *[numChunks];
+    for (int i = 0; i < numChunks; i++)
+        chunks[i] = NULL;
+    mapData = NULL;
+    owner = new int[NumSectors];
+    changed = new bool[NumSectors];
+    for (int i = 0; i < NumSectors; i++) {
+        owner[i] = NoOwner;
+        changed[i] = FALSE;
+    }
+    problems = 0;
+    numFiles = numDirs = 0;
+}
+
+//----------------------------------------------------------------------
+// Fsck::~Fsck
+// 	De-allocate the checker.
+//----------------------------------------------------------------------
+
+Fsck::~Fsck()
+{
+    for (int i = 0; i < numChunks; i++)
+        delete [] chunks[i];
+    delete [] chunks;
+    delete [] mapData;
+    delete [] owner;
+    delete [] changed;
+}
+
+//----------------------------------------------------------------------
+// Fsck::Run
+// 	Check the whole file system: every file reachable from the root
+//	directory (plus the free map file), then the free map.
+//	If repairing, write the repaired sectors back to disk.
+//
+//	If the free map or root directory itself is damaged,
+//	give up; there is nothing sensible to repair it with.
+//----------------------------------------------------------------------
+
+int
+Fsck::Run()
+{
+    FileHeader *mapHdr = (FileHeader *)Sector(FreeMapSector);
+    int inUse = 0, written = 0;
+
+    Load();
+    if (!CheckFile(FreeMapSector, "(free map)", FALSE, DirectorySector)
+            || !CheckFile(DirectorySector, "/", TRUE, DirectorySector)) {
+        printf("fsck: the file system is damaged beyond repair\n");
+        return ++problems;
+    }
+    if (mapHdr->numBytes * BitsInByte < NumSectors) {
+        printf("fsck: (free map): wrong size %d\n", mapHdr->numBytes);
+        return ++problems;
+    }
+    CheckFreeMap();
+
+    if (repair) {
+        for (int i = 0; i < NumSectors; i++)
+            if (changed[i]) {
+                synchDisk->WriteSector(i, Sector(i));
+                written++;
+            }
+    }
+    for (int i = 0; i < NumSectors; i++)
+        if (owner[i] != NoOwner)
+            inUse++;
+    printf("fsck: %d files, %d directories, %d/%d sectors in use",
+            numFiles, numDirs, inUse, limit);
+    if (repair)
+        printf(", %d problems, %d sectors repaired\n", problems, written);
+    else
+        printf(", %d problems\n", problems);
+    return problems;
+}
+
+//----------------------------------------------------------------------
+// Fsck::Load
+// 	Read the whole disk into memory, FsckChunk sectors at a time,
+//	unless it is bigger than FsckPreload.  Then only the chunks that
+//	hold metadata are read in, as the checker gets to them.
+//----------------------------------------------------------------------
+
+void
+Fsck::Load()
+{
+    if ((long long) NumSectors * SectorSize > FsckPreload)
+        return;
+    for (int i = 0; i < numChunks; i++)
+        Sector(i * FsckChunk);
+}
+
+//----------------------------------------------------------------------
+// Fsck::Sector
+// 	Return where the image of "sector" is in memory, reading in its
+//	chunk if it isn't there yet.  Chunks are never thrown away, so
+//	the pointer stays good until the checker is deleted.
+//----------------------------------------------------------------------
+
+char *
+Fsck::Sector(int sector)
+{
+    int c = sector / FsckChunk;
+
+    if (chunks[c] == NULL) {
+        int first = c * FsckChunk;
+
+        chunks[c] = new char[FsckChunk * SectorSize];
+        synchDisk->ReadBulk(first, min(FsckChunk, NumSectors - first),
+                chunks[c]);
+    }
+    return &chunks[c][(sector % FsckChunk) * SectorSize];
+}
+
+//----------------------------------------------------------------------
+// Fsck::Changed
+// 	Remember to write "sector" back, once the check is over.
+//----------------------------------------------------------------------
+
+void
+Fsck::Changed(int sector)
+{
+    changed[sector] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Fsck::CheckFile
+// 	Check the file whose header is at "sector": its size, and every
+//	sector it uses.  If it is a directory, check its entries too.
+//	Return FALSE if the file can't be used; then none of its sectors
+//	are counted as in use.
+//
+//	"sector" -- where the file header is
+//	"path" -- the name of the file, for messages
+//	"isdir" -- is the file a directory?
+//	"parent" -- where the header of the directory holding it is
+//----------------------------------------------------------------------
+
+bool
+Fsck::CheckFile(int sector, char *path, bool isdir, int parent)
+{
+    FileHeader *hdr;
+    int *data;
+
+    if (!Claim(sector, sector, path))
+        return FALSE;
+    hdr = (FileHeader *)Sector(sector);
+    if (hdr->numBytes < 0 || hdr->numSectors < 0 || hdr->numSectors > limit
+            || divRoundUp(hdr->numBytes, SectorSize) > hdr->numSectors) {
+        printf("fsck: %s: bad size %d (%d sectors)\n", path,
+                hdr->numBytes, hdr->numSectors);
+        problems++;
+        Unclaim(sector);
+        return FALSE;
+    }
+
+    data = new int[hdr->numSectors + 1];
+    if (!Collect(hdr, sector, path, data)) {
+        Unclaim(sector);
+        delete [] data;
+        return FALSE;
+    }
+    if (isdir) {
+        numDirs++;
+        CheckDirectory(sector, path, data, parent);
+    } else
+        numFiles++;
+    if (sector == FreeMapSector)
+        mapData = data;		// kept for CheckFreeMap
+    else
+        delete [] data;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Fsck::Collect
+// 	Claim every sector used by a file, and list its data sectors in
+//	order.  The first NumDirect-1 data sectors are in the header; the
+//	last slot of the header points to a chain of index sectors, each
+//	with Sector2Int-1 more data sectors and a pointer to the next.
+//	Return FALSE if some sector is out of range or already in use.
+//
+//	"hdr", "hdrSector" -- the file header, and where it is
+//	"path" -- the name of the file, for messages
+//	"data" -- set to the data sectors of the file
+//----------------------------------------------------------------------
+
+bool
+Fsck::Collect(FileHeader *hdr, int hdrSector, char *path, int *data)
+{
+    int numDirect = min(hdr->numSectors, NumDirect - 1);
+    int left = hdr->numSectors - numDirect;
+    int index, *entries, n;
+
+    for (n = 0; n < numDirect; n++) {
+        if (!Claim(hdr->dataSectors[n], hdrSector, path))
+            return FALSE;
+        data[n] = hdr->dataSectors[n];
+    }
+    for (index = hdr->dataSectors[NumDirect - 1]; left > 0;
+            index = entries[Sector2Int - 1]) {
+        int count = min(left, Sector2Int - 1);
+
+        if (!Claim(index, hdrSector, path))
+            return FALSE;
+        entries = (int *)Sector(index);
+        for (int i = 0; i < count; i++) {
+            if (!Claim(entries[i], hdrSector, path))
+                return FALSE;
+            data[n++] = entries[i];
+        }
+        left -= count;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Fsck::Claim
+// 	Record that "sector" is used by the file with its header at
+//	"hdrSector".  Return FALSE, and complain, if that can't be right.
+//----------------------------------------------------------------------
+
+bool
+Fsck::Claim(int sector, int hdrSector, char *path)
+{
+    if (sector < 0 || sector >= limit) {
+        printf("fsck: %s: sector %d out of range\n", path, sector);
+        problems++;
+        return FALSE;
+    }
+    if (owner[sector] != NoOwner) {
+        printf("fsck: %s: sector %d is already used (by header %d)\n",
+                path, sector, owner[sector]);
+        problems++;
+        return FALSE;
+    }
+    owner[sector] = hdrSector;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Fsck::Unclaim
+// 	Forget every sector claimed for the file with its header at
+//	"hdrSector"; the file is not going to be kept.
+//----------------------------------------------------------------------
+
+void
+Fsck::Unclaim(int hdrSector)
+{
+    for (int i = 0; i < NumSectors; i++)
+        if (owner[i] == hdrSector)
+            owner[i] = NoOwner;
+}
+
+//----------------------------------------------------------------------
+// Fsck::CheckDirectory
+// 	Check every entry in use in a directory, and the file it names.
+//	When repairing, remove the entries that are bad: a name that isn't
+//	a name, the same name twice, or a file that can't be used.  The
+//	".." entry isn't followed, since it points back up; it must name
+//	the parent directory, and is pointed there when repairing.
+//
+//	"sector" -- where the header of the directory is
+//	"path" -- the name of the directory, for messages
+//	"data" -- the data sectors of the directory
+//	"parent" -- where the header of the parent directory is
+//----------------------------------------------------------------------
+
+void
+Fsck::CheckDirectory(int sector, char *path, int *data, int parent)
+{
+    FileHeader *hdr = (FileHeader *)Sector(sector);
+    int numEntries = hdr->numBytes / sizeof(DirectoryEntry);
+    char *contents = new char[hdr->numSectors * SectorSize];
+    DirectoryEntry *table = (DirectoryEntry *)contents;
+    bool modified = FALSE;
+
+    Gather(data, hdr->numSectors, contents);
+    for (int i = 0; i < numEntries; i++) {
+        DirectoryEntry *entry = &table[i];
+        char *name = entry->name;
+        char *child;
+        bool ok = TRUE;
+
+        if (!entry->inUse)
+            continue;
+        if (memchr(name, '\0', FileNameMaxLen + 1) == NULL
+                || *name == '\0' || strchr(name, '/') != NULL) {
+            name = "?";
+            ok = FALSE;
+        }
+        child = new char[strlen(path) + strlen(name) + 2];
+        sprintf(child, "%s%s%s", path,
+                (path[strlen(path) - 1] == '/') ? "" : "/", name);
+
+        if (!ok) {
+            printf("fsck: %s: bad name in entry %d\n", child, i);
+            problems++;
+        } else {
+            for (int j = 0; j < i && ok; j++)
+                if (table[j].inUse && !strcmp(table[j].name, name)) {
+                    printf("fsck: %s: name appears twice\n", child);
+                    problems++;
+                    ok = FALSE;
+                }
+        }
+        if (ok && !strcmp(name, "..")) {
+            if (!entry->isdir || entry->sector != parent) {
+                printf("fsck: %s: should be %d, not %d\n", child, parent,
+                        entry->sector);
+                problems++;
+                if (repair) {
+                    entry->isdir = TRUE;
+                    entry->sector = parent;
+                    modified = TRUE;
+                }
+            }
+            delete [] child;
+            continue;
+        }
+        if (ok)
+            ok = CheckFile(entry->sector, child, entry->isdir, sector);
+
+        if (!ok && repair) {
+            printf("fsck: %s: removed\n", child);
+            entry->inUse = FALSE;
+            modified = TRUE;
+        }
+        delete [] child;
+    }
+    if (modified)
+        Scatter(data, hdr->numSectors, contents);
+    delete [] contents;
+}
+
+//----------------------------------------------------------------------
+// Fsck::CheckFreeMap
+// 	Compare the free map with the sectors found in use.  A sector
+//	marked in use but not used has leaked; a sector in use but marked
+//	free would sooner or later be given to a second file.  When
+//	repairing, make the free map agree with what is in use.
+//----------------------------------------------------------------------
+
+void
+Fsck::CheckFreeMap()
+{
+    FileHeader *hdr = (FileHeader *)Sector(FreeMapSector);
+    char *contents = new char[hdr->numSectors * SectorSize];
+    unsigned int *map = (unsigned int *)contents;
+    int leaked = 0, lost = 0;
+
+    Gather(mapData, hdr->numSectors, contents);
+    for (int i = 0; i < NumSectors; i++) {
+        unsigned int *word = &map[i / BitsInWord];
+        unsigned int bit = 1 << (i % BitsInWord);
+        bool used = (i >= limit) || (owner[i] != NoOwner);
+
+        if ((*word & bit) && !used) {
+            DEBUG('f', "Sector %d leaked\n", i);
+            leaked++;
+            *word &= ~bit;
+        } else if (!(*word & bit) && used) {
+            DEBUG('f', "Sector %d in use, but marked free\n", i);
+            lost++;
+            *word |= bit;
+        }
+    }
+    if (leaked > 0)
+        printf("fsck: (free map): %d sectors marked in use, but not used\n",
+                leaked);
+    if (lost > 0)
+        printf("fsck: (free map): %d sectors in use, but marked free\n",
+                lost);
+    problems += leaked + lost;
+    if (repair && (leaked > 0 || lost > 0))
+        Scatter(mapData, hdr->numSectors, contents);
+    delete [] contents;
+}
+
+//----------------------------------------------------------------------
+// Fsck::Gather, Fsck::Scatter
+// 	Copy the contents of a file out of the in-memory image, or back
+//	into it (marking the sectors to be written back).
+//
+//	"data" -- the data sectors of the file, in order
+//	"count" -- how many there are
+//----------------------------------------------------------------------
+
+void
+Fsck::Gather(int *data, int count, char *into)
+{
+    for (int i = 0; i < count; i++)
+        bcopy(Sector(data[i]), &into[i * SectorSize], SectorSize);
+}
+
+void
+Fsck::Scatter(int *data, int count, char *from)
+{
+    for (int i = 0; i < count; i++) {
+        bcopy(&from[i * SectorSize], Sector(data[i]), SectorSize);
+        Changed(data[i]);
+    }
+}
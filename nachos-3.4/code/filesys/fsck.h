@@ -0,0 +1,90 @@
+// fsck.h
+//	Data structures for checking the consistency of the file system.
+//
+//	The checker reads the whole disk image into memory at once, in
+//	large sequential chunks, rather than sector by sector through the
+//	simulated disk.  (A disk too big for that is read a chunk at a
+//	time, as the checker gets to it.)  It then walks the directory
+//	tree from the root,
+//	checking each file header and its index chain, and records which
+//	file uses each sector.  Finally it compares that with the free map.
+//
+//	Problems found, and what a repair does about them:
+//
+//	   a header or directory entry that makes no sense, or a sector
+//	     used by two files -- the later directory entry is removed
+//	     (the file is lost, and its sectors are freed)
+//	   a sector in use but marked free -- it is marked in use
+//	   a sector marked in use but not used by any file (a leak)
+//	     -- it is marked free
+//
+//	Repairs are only safe when nothing has the file system open, so
+//	they are only done when checking at boot (-fsck), before the file
+//	system is mounted.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef FSCK_H
+#define FSCK_H
+
+#include "disk.h"
+#include "filehdr.h"
+
+#define FsckChunk	64		// sectors read from the image at
+					// a time
+#define FsckPreload	(16 << 20)	// biggest disk read in all at once
+
+// The following class defines the consistency checker.  It is meant
+// to be used once: create it, Run it, delete it.
+
+class Fsck {
+  public:
+    Fsck(bool fixProblems);		// Set up the checker; if
+					// "fixProblems", fix what it finds
+    ~Fsck();				// De-allocate the checker
+
+    int Run();				// Check the disk; return the number
+					// of problems found
+
+  private:
+    void Load();			// Read the whole image into memory
+    char *Sector(int sector);		// The image of "sector"
+    void Changed(int sector);		// "sector" was repaired in memory
+
+    bool CheckFile(int sector, char *path, bool isdir, int parent);
+					// Check the file with its header at
+					// "sector"; FALSE if it is unusable
+    bool Collect(FileHeader *hdr, int hdrSector, char *path, int *data);
+					// Claim the data and index sectors of
+					// a file, following its index chain
+    bool Claim(int sector, int hdrSector, char *path);
+					// "sector" is used by a file
+    void Unclaim(int hdrSector);	// Forget the sectors of a bad file
+    void CheckDirectory(int sector, char *path, int *data, int parent);
+					// Check every entry of a directory
+    void CheckFreeMap();		// Compare the free map with the
+					// sectors in use
+    void Gather(int *data, int count, char *into);
+    void Scatter(int *data, int count, char *from);
+					// Copy the contents of a file from/to
+					// its sectors in the image
+
+    bool repair;			// Fix what we find?
+    int limit;				// Sectors from here on belong to
+					// the journal
+    char **chunks;			// The disk, FsckChunk sectors at a
+    int numChunks;			// time (NULL if not read in yet)
+    int *mapData;			// Data sectors of the free map file
+    int *owner;				// Header sector of the file that uses
+					// each sector, or -1
+    bool *changed;			// Sectors to write back
+
+    int problems;			// Problems found so far
+    int numFiles, numDirs;		// Files and directories found
+};
+
+#endif // FSCK_H
@@ -7,6 +7,8 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   DirGrowTest -- grow a directory until its file needs a chain
+//		of index sectors, then look up and remove every entry
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -22,6 +24,7 @@
 #include "stats.h"
 #include "directory.h"
 #include "openfile.h"
+#include "pipe.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -204,27 +207,89 @@ PerformanceTest()
     printf("reading done\n");
     //stats->Print();
 }
+//----------------------------------------------------------------------
+// DirGrowTest
+// 	Create enough files in one directory that the directory file
+//	outgrows its direct pointers and the first index sector, so that
+//	FileHeader::Enlarge has to chain a second index sector onto it.
+//	Then check that every file can still be found, and remove them
+//	all (and the directory).
+//----------------------------------------------------------------------
+
+#define GrowDir 	"/grow"
+#define GrowFiles 	(((NumDirect-1) + (Sector2Int-1)) * SectorSize \
+				/ (int) sizeof(DirectoryEntry) + 8)
+
+void
+DirGrowTest()
+{
+    char name[32];
+    OpenFile *openFile;
+    int i, errors = 0;
+
+    printf("Growing %s to %d files\n", GrowDir, GrowFiles);
+    if (!fileSystem->Create(GrowDir, -1)) {
+	printf("Dir grow test: can't create %s\n", GrowDir);
+	return;
+    }
+    for (i = 0; i < GrowFiles; i++) {
+	sprintf(name, "%s/f%d", GrowDir, i);
+	if (!fileSystem->Create(name, 0)) {
+	    printf("Dir grow test: can't create %s\n", name);
+	    errors++;
+	}
+    }
+    for (i = 0; i < GrowFiles; i++) {
+	sprintf(name, "%s/f%d", GrowDir, i);
+	if ((openFile = fileSystem->Open(name)) == NULL) {
+	    printf("Dir grow test: unable to open %s\n", name);
+	    errors++;
+	} else
+	    delete openFile;
+    }
+    for (i = 0; i < GrowFiles; i++) {
+	sprintf(name, "%s/f%d", GrowDir, i);
+	if (!fileSystem->Remove(name)) {
+	    printf("Dir grow test: unable to remove %s\n", name);
+	    errors++;
+	}
+    }
+    if (!fileSystem->Remove(GrowDir)) {
+	printf("Dir grow test: unable to remove %s\n", GrowDir);
+	errors++;
+    }
+    errors += fileSystem->Check();
+    printf("Dir grow test: %d errors\n", errors);
+}
+
+// pipe shared by the two threads of PerformanceTest2
+static PipeBuffer *testPipe;
+
 void fileTest1(){
-    char res[ContentSize] = Contents;
-    fileSystem->PushPipe(Contents);
+    testPipe->Write(Contents, ContentSize);
     currentThread->Yield();
-    fileSystem->PushPipe("987654321");
+    testPipe->Write("987654321", 9);
+    testPipe->Close(TRUE);
 }
 
 void fileTest2(){
-    char*ans = new char[ContentSize];
-    fileSystem->PopPipe(ans);
-    printf("Pipe reading out %s\n",ans);
-    currentThread->Yield();
-    fileSystem->PopPipe(ans);
-    printf("Pipe reading out %s\n",ans);
+    char*ans = new char[ContentSize + 1];
+    int n;
 
+    while ((n = testPipe->Read(ans, ContentSize)) > 0) {
+        ans[n] = '\0';
+        printf("Pipe reading out %s\n", ans);
+    }
+    testPipe->Close(FALSE);
+    delete testPipe;
+    delete [] ans;
 }
 
 void
 PerformanceTest2(){
     Thread*t1 = new Thread("t1");
     Thread*t2 = new Thread("t2");
+    testPipe = new PipeBuffer();
     t1->Fork(fileTest1,0);
     t2->Fork(fileTest2,0);
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+// inode.cc
+//	Routines to manage the in-core table of file headers.
+//
+//	A header is read from disk the first time any OpenFile asks for
+//	it, and is shared by every OpenFile on the same file after that.
+//	Changes to the header (the file grew, its times changed) just
+//	mark it dirty; it is written back once, when the last OpenFile
+//	on it is closed, or when the file system is synced.
+//
+//	We assume mutual exclusion is provided by the caller, as for
+//	the rest of the file system.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "inode.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Inode::Inode
+// 	Bring a file header into memory.
+//
+//	"sectorNumber" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+Inode::Inode(int sectorNumber)
+{
+    sector = sectorNumber;
+    refCount = 0;
+    dirty = FALSE;
+    next = NULL;
+    lock = new RWLock("inode", rwPolicy);
+    hdr.FetchFrom(sector);
+}
+
+//----------------------------------------------------------------------
+// Inode::~Inode
+// 	Throw away the in-core header, writing it back first if it was
+//	modified.
+//----------------------------------------------------------------------
+
+Inode::~Inode()
+{
+    Flush();
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Inode::Flush
+// 	Write the header back to disk, but only if it was modified since
+//	it was read in (or last written back).
+//----------------------------------------------------------------------
+
+void
+Inode::Flush()
+{
+    if (dirty) {
+        DEBUG('f', "Writing back header at sector %d\n", sector);
+        journal->Begin();
+        hdr.WriteBack(sector);
+        journal->End();
+        dirty = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// InodeTable::InodeTable
+// 	Initialize an empty table of in-core headers.
+//----------------------------------------------------------------------
+
+InodeTable::InodeTable()
+{
+    for (int i = 0; i < InodeHashSize; i++)
+        buckets[i] = NULL;
+    unused = new List;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::~InodeTable
+// 	Write back every modified header and free the table.
+//----------------------------------------------------------------------
+
+InodeTable::~InodeTable()
+{
+    for (int i = 0; i < InodeHashSize; i++)
+        while (buckets[i] != NULL) {
+            Inode *inode = buckets[i];
+            buckets[i] = inode->next;
+            delete inode;		// flushes it, if dirty
+        }
+    delete unused;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Lookup
+// 	Return the in-core header stored at "sector", or NULL if it
+//	isn't in core.
+//----------------------------------------------------------------------
+
+Inode *
+InodeTable::Lookup(int sector)
+{
+    Inode *inode;
+
+    for (inode = buckets[sector % InodeHashSize]; inode != NULL;
+            inode = inode->next)
+        if (inode->sector == sector)
+            return inode;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Unhash
+// 	Take an inode off its hash chain (but don't free it).
+//----------------------------------------------------------------------
+
+void
+InodeTable::Unhash(Inode *inode)
+{
+    Inode **ptr = &buckets[inode->sector % InodeHashSize];
+
+    while (*ptr != inode)
+        ptr = &(*ptr)->next;
+    *ptr = inode->next;
+    inode->next = NULL;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Acquire
+// 	Return the shared in-core header of the file whose header is
+//	stored at "sector", reading it from disk if nobody has it in
+//	core.  The caller must Release it when done.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+Inode *
+InodeTable::Acquire(int sector)
+{
+    Inode *inode = Lookup(sector);
+
+    if (inode == NULL) {
+        inode = new Inode(sector);
+        inode->next = buckets[sector % InodeHashSize];
+        buckets[sector % InodeHashSize] = inode;
+    } else if (inode->refCount == 0)
+        unused->Remove((void *)inode);	// it's in use again
+    inode->refCount++;
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Release
+// 	Give back an in-core header.  When nobody is using it any more,
+//	write it back if it was modified, and keep it on the unused
+//	list, in case the file is opened again soon.  If there are too
+//	many unused headers, free the least recently used one.
+//
+//	"inode" -- the header returned by Acquire
+//----------------------------------------------------------------------
+
+void
+InodeTable::Release(Inode *inode)
+{
+    ASSERT(inode->refCount > 0);
+    if (--inode->refCount > 0)
+        return;
+
+    inode->Flush();
+    unused->Append((void *)inode);
+    if (unused->NumInList() > InodeCacheSize) {
+        Inode *victim = (Inode *)unused->Remove();
+        Unhash(victim);
+        delete victim;
+    }
+}
+
+//----------------------------------------------------------------------
+// InodeTable::RefCount
+// 	Return the number of OpenFiles using the header at "sector", and
+//	of threads whose working directory it is.
+//----------------------------------------------------------------------
+
+int
+InodeTable::RefCount(int sector)
+{
+    Inode *inode = Lookup(sector);
+
+    return (inode == NULL) ? 0 : inode->refCount;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Invalidate
+// 	Forget the in-core header at "sector", without writing it back.
+//	Called when a file is deleted, so that a new file that happens to
+//	get the same header sector doesn't see the old header.
+//
+//	The file must not be open.
+//----------------------------------------------------------------------
+
+void
+InodeTable::Invalidate(int sector)
+{
+    Inode *inode = Lookup(sector);
+
+    if (inode == NULL)
+        return;
+    ASSERT(inode->refCount == 0);
+    unused->Remove((void *)inode);
+    Unhash(inode);
+    inode->dirty = FALSE;		// the file is gone, don't write it
+    delete inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Sync
+// 	Write back every in-core header that has been modified.
+//----------------------------------------------------------------------
+
+void
+InodeTable::Sync()
+{
+    for (int i = 0; i < InodeHashSize; i++)
+        for (Inode *inode = buckets[i]; inode != NULL; inode = inode->next)
+            inode->Flush();
+}
@@ -0,0 +1,88 @@
+// inode.h
+//	Data structures for the in-core table of file headers.
+//
+//	Every open file needs its file header in memory.  Rather than
+//	have each OpenFile fetch a private copy, all the OpenFiles for
+//	a file share a single in-core copy (in UNIX terms, the in-core
+//	i-node), found by the sector number of the header.  The table
+//	counts how many OpenFiles are using each header, and remembers
+//	whether the header has been modified since it was last written
+//	back to disk.
+//
+//	Headers that nobody has open are kept around for a little while
+//	(up to InodeCacheSize of them), so that a file or directory that
+//	is opened over and over -- for instance, while looking up path
+//	names -- doesn't have its header read from disk every time.
+//
+//	Each in-core header also carries the readers-writer lock for its
+//	file, so all the OpenFiles on a file share one lock, and only
+//	files that are in core have one.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef INODE_H
+#define INODE_H
+
+#include "filehdr.h"
+#include "list.h"
+#include "synch.h"
+
+#define InodeHashSize	31	// number of hash chains in the table
+#define InodeCacheSize	32	// how many unused headers we keep in core
+
+// The following class defines an in-core file header.  The header
+// itself is stored exactly as it is on disk; the remaining fields are
+// bookkeeping that never goes to disk.
+
+class Inode {
+  public:
+    Inode(int sectorNumber);		// Bring the header at "sectorNumber"
+					// into memory
+    ~Inode();				// Write the header back if dirty
+
+    void MarkDirty() { dirty = TRUE; }	// The header was modified
+    void Flush();			// Write the header back to disk,
+					// if it was modified
+
+    FileHeader hdr;			// The file header, as on disk
+    int sector;				// Disk sector holding the header
+    int refCount;			// Number of OpenFiles using it
+    bool dirty;				// Modified since last written back?
+    Inode *next;			// Next inode on the same hash chain
+    RWLock *lock;			// Held by OpenFile::Read/Write
+};
+
+// The following class defines the table of in-core file headers.
+// Acquire returns the shared header for a sector (reading it from
+// disk only if it isn't already in core); Release gives it back.
+
+class InodeTable {
+  public:
+    InodeTable();			// Initialize an empty table
+    ~InodeTable();			// Write back and free every header
+
+    Inode *Acquire(int sector);		// Get the in-core header for the
+					// file whose header is at "sector"
+    void Release(Inode *inode);		// Done with the header
+
+    int RefCount(int sector);		// How many OpenFiles have the
+					// file open (or threads have it as
+					// their working directory)?
+    void Invalidate(int sector);	// The file was deleted; forget
+					// any in-core copy of its header
+    void Sync();			// Write back all modified headers
+
+  private:
+    Inode *Lookup(int sector);		// Find the in-core header, or NULL
+    void Unhash(Inode *inode);		// Take an inode off its hash chain
+
+    Inode *buckets[InodeHashSize];	// Hash chains, by header sector
+    List *unused;			// Headers nobody has open, least
+					// recently used first
+};
+
+#endif // INODE_H
@@ -0,0 +1,418 @@
+// journal.cc
+//	Routines to manage the metadata journal.
+//
+//	The disk completes requests one at a time and in order, so a
+//	transaction is committed as soon as its commit block has been
+//	written after the rest of it.
+//
+//	A block that is in the log but not yet in its real place must not
+//	be overwritten directly (say, because the sector was freed and
+//	reused for file data): replaying the log after a crash would then
+//	put the old block back.  So such a write joins the current
+//	transaction, as if it were made inside one.
+//
+//	A transaction is never committed while an operation is under
+//	way, or a crash could leave half of the operation on disk.  So
+//	each operation says how much room it needs when it begins, and
+//	the transaction is committed first if that room isn't left; an
+//	operation that turns out to need more makes the transaction grow.
+//
+//	We assume mutual exclusion is provided by the caller, as for
+//	the rest of the file system.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "freemap.h"
+#include "system.h"
+
+#define SuperMagic	0x4a524e4c	// "JRNL"
+#define DescMagic	0x44455343	// "DESC"
+#define CommitMagic	0x434f4d54	// "COMT"
+
+#define IntsPerSector	((int) (SectorSize / sizeof(int)))
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Set up the journal.  When formatting, write an empty log.
+//	Otherwise replay whatever complete transactions are in the log,
+//	so that the rest of the file system sees a consistent disk.
+//
+//	"format" -- is the disk being formatted?
+//----------------------------------------------------------------------
+
+Journal::Journal(bool format)
+{
+    enabled = TRUE;
+    busy = FALSE;
+    depth = 0;
+    ops = 0;
+    seq = 1;
+    logUsed = 0;
+    numPending = 0;
+    numLogged = 0;
+    pendingSize = MaxTxnSectors;
+    pendingSector = new int[pendingSize];
+    pendingData = new char[pendingSize * SectorSize];
+    loggedData = new char[LogSize * SectorSize];
+
+    if (format)
+        WriteSuper();
+    else
+        Replay();
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	Commit anything still pending and checkpoint, so that the log is
+//	empty on a clean shutdown; then de-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    Commit();
+    Checkpoint();
+    delete [] pendingSector;
+    delete [] pendingData;
+    delete [] loggedData;
+}
+
+//----------------------------------------------------------------------
+// Journal::Reserve
+// 	Mark the sectors of the journal as in use, when formatting, so
+//	they are never allocated to a file.
+//----------------------------------------------------------------------
+
+void
+Journal::Reserve(FreeMap *freeMap)
+{
+    for (int i = JournalStart; i < NumSectors; i++)
+        freeMap->Mark(i);
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin, Journal::End
+// 	Bracket an operation that changes metadata.  Every write in
+//	between goes into the current transaction.  They can be nested;
+//	only the outermost End counts.
+//
+//	Operations are grouped until GroupCommitOps of them are waiting,
+//	or the transaction might not have room for another one.  An
+//	operation that needs more than TxnReserve blocks says so, and the
+//	waiting ones are committed before it starts if need be.
+//
+//	"sectors" -- about how many blocks the operation changes
+//----------------------------------------------------------------------
+
+void
+Journal::Begin(int sectors)
+{
+    if (depth++ == 0 && numPending + sectors > MaxTxnSectors)
+        Commit();		// nothing of this operation is pending yet
+}
+
+void
+Journal::End()
+{
+    ASSERT(depth > 0);
+    if (--depth > 0)
+        return;
+    ops++;
+    if (ops >= GroupCommitOps || numPending > MaxTxnSectors - TxnReserve)
+        Commit();
+}
+
+//----------------------------------------------------------------------
+// Journal::FindPending, Journal::FindLogged
+// 	Return where the copy of "sector" is in the current transaction,
+//	or among the committed blocks; -1 if it isn't there.
+//----------------------------------------------------------------------
+
+int
+Journal::FindPending(int sector)
+{
+    for (int i = 0; i < numPending; i++)
+        if (pendingSector[i] == sector)
+            return i;
+    return -1;
+}
+
+int
+Journal::FindLogged(int sector)
+{
+    for (int i = 0; i < numLogged; i++)
+        if (loggedSector[i] == sector)
+            return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Journal::GrowPending
+// 	Double the room for blocks in the current transaction.
+//----------------------------------------------------------------------
+
+void
+Journal::GrowPending()
+{
+    int *sectors = new int[2 * pendingSize];
+    char *data = new char[2 * pendingSize * SectorSize];
+
+    bcopy((char *)pendingSector, (char *)sectors, numPending * sizeof(int));
+    bcopy(pendingData, data, numPending * SectorSize);
+    delete [] pendingSector;
+    delete [] pendingData;
+    pendingSector = sectors;
+    pendingData = data;
+    pendingSize *= 2;
+}
+
+//----------------------------------------------------------------------
+// Journal::Absorb
+// 	Called by SynchDisk on every write.  Inside a transaction, keep
+//	the block and return TRUE: it will be written to the log when
+//	the transaction commits.  Outside of one, do the same if an older
+//	copy of the sector is waiting in the journal, so that the new one
+//	can't be overwritten by it; otherwise return FALSE, so the block
+//	is written to its real place.
+//
+//	"sector" -- the sector being written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+bool
+Journal::Absorb(int sector, char *data)
+{
+    int i;
+
+    if (!enabled || busy || sector >= JournalStart)
+        return FALSE;
+
+    i = FindPending(sector);
+    if (i == -1) {
+        if (depth == 0 && FindLogged(sector) == -1)
+            return FALSE;		// the journal has no copy of it
+        if (numPending == pendingSize) {
+            if (depth == 0)
+                Commit();		// no operation is under way
+            else
+                GrowPending();
+        }
+        i = numPending++;
+        pendingSector[i] = sector;
+    }
+    bcopy(data, &pendingData[i * SectorSize], SectorSize);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Lookup
+// 	Called by SynchDisk on every read.  If the newest copy of "sector"
+//	is in the journal, copy it into "data" and return TRUE.
+//----------------------------------------------------------------------
+
+bool
+Journal::Lookup(int sector, char *data)
+{
+    int i;
+
+    if (!enabled)
+        return FALSE;
+    if ((i = FindPending(sector)) != -1) {
+        bcopy(&pendingData[i * SectorSize], data, SectorSize);
+        return TRUE;
+    }
+    if ((i = FindLogged(sector)) != -1) {
+        bcopy(&loggedData[i * SectorSize], data, SectorSize);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Write the current transaction to the log: the descriptor, the
+//	blocks, and then the commit block, all one after the other (with
+//	a descriptor for every DescSectors blocks).  The blocks stay in
+//	memory until they are checkpointed.  Once the log is half full,
+//	checkpoint, so there is always room for the next transaction.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    int block[IntsPerSector];
+    int pos, size;
+
+    if (!enabled || numPending == 0)
+        return;
+    size = numPending + divRoundUp(numPending, DescSectors) + 1;
+    ASSERT(size <= LogSize);		// a transaction has to fit in the log
+    if (logUsed + size > LogSize)
+        Checkpoint();
+
+    busy = TRUE;
+    DEBUG('f', "Committing transaction %d, %d blocks\n", seq, numPending);
+    pos = JournalStart + 1 + logUsed;
+
+    for (int first = 0; first < numPending; first += DescSectors) {
+        int count = min(numPending - first, DescSectors);
+
+        bzero((char *)block, SectorSize);
+        block[0] = DescMagic;
+        block[1] = seq;
+        block[2] = count;
+        for (int i = 0; i < count; i++)
+            block[3 + i] = pendingSector[first + i];
+        synchDisk->WriteSector(pos++, (char *)block);
+
+        for (int i = 0; i < count; i++)
+            synchDisk->WriteSector(pos++,
+                    &pendingData[(first + i) * SectorSize]);
+    }
+
+    bzero((char *)block, SectorSize);
+    block[0] = CommitMagic;
+    block[1] = seq;
+    synchDisk->WriteSector(pos++, (char *)block);
+
+    // the blocks are safe in the log; remember them until checkpointed
+    for (int i = 0; i < numPending; i++) {
+        int j = FindLogged(pendingSector[i]);
+
+        if (j == -1) {
+            j = numLogged++;
+            loggedSector[j] = pendingSector[i];
+        }
+        bcopy(&pendingData[i * SectorSize], &loggedData[j * SectorSize],
+                SectorSize);
+    }
+    logUsed += size;
+    seq++;
+    numPending = 0;
+    ops = 0;
+    busy = FALSE;
+
+    if (logUsed > LogSize / 2)
+        Checkpoint();
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Write every committed block to its real place, then mark the log
+//	empty by moving the superblock's sequence number past every
+//	transaction in it.
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    bool wasBusy = busy;
+
+    if (!enabled || numLogged == 0)
+        return;
+    busy = TRUE;
+    DEBUG('f', "Checkpointing %d blocks\n", numLogged);
+    for (int i = 0; i < numLogged; i++)
+        synchDisk->WriteSector(loggedSector[i], &loggedData[i * SectorSize]);
+    numLogged = 0;
+    logUsed = 0;
+    WriteSuper();
+    busy = wasBusy;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteSuper
+// 	Write the superblock: the log starts with transaction "seq".
+//----------------------------------------------------------------------
+
+void
+Journal::WriteSuper()
+{
+    int block[IntsPerSector];
+
+    bzero((char *)block, SectorSize);
+    block[0] = SuperMagic;
+    block[1] = seq;
+    synchDisk->WriteSector(JournalStart, (char *)block);
+}
+
+//----------------------------------------------------------------------
+// Journal::Replay
+// 	Redo every complete transaction in the log, in order, stopping
+//	at the first one that is missing its commit block (the system
+//	crashed while writing it) or that is left over from before the
+//	last checkpoint (wrong sequence number).  Then empty the log.
+//
+//	Each transaction is read twice: once to find its commit block,
+//	then, if it has one, to redo its blocks.
+//
+//	If the disk has no journal superblock, it was formatted without
+//	a journal; leave journaling off.
+//----------------------------------------------------------------------
+
+void
+Journal::Replay()
+{
+    int desc[IntsPerSector];
+    char *data = new char[SectorSize];
+    int pos = 0, replayed = 0;
+
+    busy = TRUE;
+    synchDisk->ReadSector(JournalStart, (char *)desc);
+    if (desc[0] != SuperMagic) {
+        DEBUG('f', "No journal on this disk\n");
+        enabled = FALSE;
+        busy = FALSE;
+        delete [] data;
+        return;
+    }
+    seq = desc[1];
+
+    while (pos + 2 <= LogSize) {
+        int end = pos, count;
+        bool complete = FALSE;
+
+        // find the commit block, after the descriptors and their blocks
+        while (end < LogSize) {
+            synchDisk->ReadSector(JournalStart + 1 + end, (char *)desc);
+            if (desc[1] != seq)
+                break;
+            if (desc[0] == CommitMagic) {
+                complete = (end > pos);
+                break;
+            }
+            count = desc[2];
+            if (desc[0] != DescMagic || count <= 0 || count > DescSectors
+                    || end + count + 2 > LogSize)
+                break;
+            end += count + 1;
+        }
+        if (!complete)
+            break;		// never committed
+
+        for (int at = pos; at < end; at += count + 1) {
+            synchDisk->ReadSector(JournalStart + 1 + at, (char *)desc);
+            count = desc[2];
+            for (int i = 0; i < count; i++) {
+                int sector = desc[3 + i];
+
+                if (sector < 0 || sector >= JournalStart)
+                    continue;	// can't be a real block; ignore it
+                synchDisk->ReadSector(JournalStart + 1 + at + 1 + i, data);
+                synchDisk->WriteSector(sector, data);
+            }
+        }
+        pos = end + 1;
+        seq++;
+        replayed++;
+    }
+    if (replayed > 0)
+        printf("Journal: replayed %d transactions\n", replayed);
+
+    WriteSuper();
+    busy = FALSE;
+    delete [] data;
+}
@@ -0,0 +1,119 @@
+// journal.h
+//	Data structures for the metadata journal.
+//
+//	A file system operation such as Create changes several sectors
+//	of metadata -- the new file header, the parent directory, the
+//	free map.  If Nachos dies with only some of them written, the
+//	disk is left inconsistent.  To prevent that, the changes are
+//	first written to a log at the end of the disk, and only later
+//	to their real places ("checkpointed").  When the file system is
+//	mounted, every transaction that made it completely into the log
+//	is written to its real place again ("replayed"); a transaction
+//	that didn't is simply ignored, as if it never happened.
+//
+//	Changes of several operations are grouped into one transaction,
+//	so that they are written to the log together, in one sequential
+//	burst, instead of as scattered writes all over the disk.
+//
+//	Only metadata is journaled: the writes made between Begin and End.
+//	File data is written to its real place directly.
+//
+//	The log looks like this:
+//
+//	    superblock | desc data... commit | desc data... commit | ...
+//
+//	Each transaction is a descriptor (which lists the real sectors
+//	of the blocks that follow), the blocks themselves, and a commit
+//	block.  A transaction with more blocks than a descriptor can list
+//	has several descriptors, each followed by its blocks, before the
+//	commit block.  The superblock gives the sequence number of the
+//	first transaction in the log that hasn't been checkpointed yet.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+
+#define JournalSectors	64		// size of the journal, at the end
+					// of the disk
+#define JournalStart	(NumSectors - JournalSectors)
+#define LogSize		(JournalSectors - 1)	// all but the superblock
+
+#define DescSectors	((int) ((SectorSize - 3 * sizeof(int)) / sizeof(int)))
+					// blocks one descriptor can list
+#define MaxTxnSectors	min(DescSectors, LogSize / 2 - 1)
+					// blocks we like to keep a transaction
+					// to: one descriptor, and room in the
+					// log for it twice over
+#define TxnReserve	12		// room an operation is assumed to
+					// need, unless it says otherwise
+#define GroupCommitOps	8		// most operations we group together
+
+class FreeMap;
+
+// The following class defines the journal.  SynchDisk sends every
+// write made inside a transaction here (Absorb), and looks here first
+// on every read (Lookup), since the newest copy of a sector may not
+// be in its real place yet.
+
+class Journal {
+  public:
+    Journal(bool format);		// Set up the journal; if not
+					// formatting, replay the log
+    ~Journal();				// Commit, checkpoint, and de-allocate
+					// the journal
+
+    void Reserve(FreeMap *freeMap);	// Mark the journal sectors in use
+
+    void Begin(int sectors = TxnReserve);
+					// An operation that changes at most
+					// about "sectors" blocks starts
+    void End();				// The operation is done; commit if
+					// enough operations are waiting
+    void Commit();			// Write the current transaction to
+					// the log
+    void Checkpoint();			// Write all logged blocks to their
+					// real place, and empty the log
+
+    bool Absorb(int sector, char *data);
+					// Called on every write: keep the
+					// block if in a transaction
+    bool Lookup(int sector, char *data);
+					// Called on every read: return a
+					// logged copy of the block, if any
+    bool IsEnabled() { return enabled; }
+					// Does the disk have a journal?
+
+  private:
+    int FindPending(int sector);	// Index in the current transaction
+    int FindLogged(int sector);		// Index in the committed blocks
+    void GrowPending();			// Make room for more blocks in the
+					// current transaction
+    void Replay();			// Redo the transactions in the log
+    void WriteSuper();			// Write the superblock
+
+    bool enabled;			// FALSE if the disk has no journal
+    bool busy;				// Writing the log or checkpointing
+    int depth;				// Nesting of Begin/End
+    int ops;				// Operations in this transaction
+    int seq;				// Sequence # of the next transaction
+    int logUsed;			// Log sectors used since the last
+					// checkpoint
+
+    int numPending;			// The current transaction
+    int pendingSize;			// Room for this many blocks in it
+    int *pendingSector;
+    char *pendingData;
+
+    int numLogged;			// Blocks committed to the log but
+    int loggedSector[LogSize];		// not yet checkpointed
+    char *loggedData;
+};
+
+#endif // JOURNAL_H
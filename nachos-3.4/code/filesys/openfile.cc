@@ -5,7 +5,10 @@
 //  the OpenFile data structure).
 //
 //  Also as in UNIX, for convenience, we keep the file header in
-//  memory while the file is open.
+//  memory while the file is open.  All the OpenFiles on the same file
+//  share one in-core copy of the header (see inode.h), so that a write
+//  through one of them is seen by the others; the header is written
+//  back when the last of them is closed.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -13,6 +16,7 @@
 
 #include "copyright.h"
 #include "filehdr.h"
+#include "inode.h"
 #include "openfile.h"
 #include "system.h"
 #ifdef HOST_SPARC
@@ -22,7 +26,8 @@
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 //  Open a Nachos file for reading and writing.  Bring the file header
-//  into memory while the file is open.
+//  into memory while the file is open, unless some other OpenFile
+//  already has it in memory.
 //
 //  "sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
@@ -30,23 +35,21 @@
 OpenFile::OpenFile(int sector)
 {
     hdrPos = sector;
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
-    // printf("---this file at %d has already contain %d---\n",sector,hdr->size);
+    inode = inodeTable->Acquire(sector);
+    hdr = &inode->hdr;
     seekPosition = hdr->size;
     readPosition = 0;
-    synchDisk->ownerCount[hdrPos]++;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 //  Close a Nachos file, de-allocating any in-memory data structures.
+//  The header is written back if this was the last OpenFile on it.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    synchDisk->ownerCount[hdrPos]--;
-    delete hdr;
+    inodeTable->Release(inode);
 }
 
 //----------------------------------------------------------------------
@@ -69,7 +72,9 @@ OpenFile::Seek(int position)
 //  Return the number of bytes actually written or read, and as a
 //  side effect, increment the current position within the file.
 //
-//  Implemented using the more primitive ReadAt/WriteAt.
+//  Implemented using the more primitive ReadAt/WriteAt, holding the
+//  file's readers-writer lock (shared by every OpenFile on the file),
+//  so that a read never sees a write half done.
 //
 //  "into" -- the buffer to contain the data to be read from disk
 //  "from" -- the buffer containing the data to be written to disk
@@ -78,21 +83,19 @@ OpenFile::Seek(int position)
 
 int
 OpenFile::Read(char *into, int numBytes){
-    synchDisk->StartReader(hdrPos);
+    inode->lock->ReadAcquire();
     int result = ReadAt(into, numBytes, readPosition);
     readPosition += result;
-    // currentThread->Yield();
-    synchDisk->EndReader(hdrPos);
+    inode->lock->ReadRelease();
     return result;
 }
 
 int
 OpenFile::Write(char *into, int numBytes){
-    synchDisk->StartWriter(hdrPos);
+    inode->lock->WriteAcquire();
     int result = WriteAt(into, numBytes, seekPosition);
     seekPosition += result;
-    // currentThread->Yield();
-    synchDisk->EndWriter(hdrPos);
+    inode->lock->WriteRelease();
     return result;
 }
 
@@ -101,6 +104,8 @@ OpenFile::Write(char *into, int numBytes){
 //  Read/write a portion of a file, starting at "position".
 //  Return the number of bytes actually written or read, but has
 //  no side effects (except that Write modifies the file, of course).
+//  A write past the end of the file grows it; if the disk is too full
+//  for that, only the bytes that fit in the file as it is are written.
 //
 //  There is no guarantee the request starts or ends on an even disk sector
 //  boundary; however the disk only knows how to read/write a whole disk
@@ -143,16 +148,13 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++){
-        // synchDisk->StartReader(hdr->ByteToSector(i * SectorSize));
+    for (i = firstSector; i <= lastSector; i++)
         synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
                     &buf[(i - firstSector) * SectorSize]);
-        // synchDisk->EndReader(hdr->ByteToSector(i * SectorSize));
-    }
 
-    // Set last visit after read
-    hdr->SetLastVisit();
-    hdr->WriteBack(hdr->SectorPos);
+    // Set last visit after read; the header goes back to disk later
+    if (hdr->SetLastVisit())
+        inode->MarkDirty();
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
@@ -177,13 +179,17 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
     // Change it to allow file length extention
     if ((position + numBytes) > fileLength){
-        //printf("file is at %d enlarging %d %d %d\n",hdrPos,position,numBytes,fileLength);
-        BitMap* freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(fileSystem->freeMapFile);
-        hdr->Enlarge(freeMap, position + numBytes - fileLength);
-        hdr->WriteBack(hdrPos);
-        freeMap->WriteBack(fileSystem->freeMapFile);
-        delete freeMap;
+        // every Sector2Int-1 new data sectors need one more index sector
+        journal->Begin(TxnReserve + divRoundUp(position + numBytes
+                    - fileLength, (Sector2Int - 1) * SectorSize));
+        if (hdr->Enlarge(fileSystem->freeMap, position + numBytes - fileLength)) {
+            inode->MarkDirty();
+            fileSystem->freeMap->Flush(fileSystem->freeMapFile);
+        } else
+            numBytes = fileLength - position;   // disk full: short write
+        journal->End();
+        if (numBytes == 0)
+            return 0;
     }
 
     firstSector = divRoundDown(position, SectorSize);
@@ -205,9 +211,8 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     hdr->size = hdr->size + numBytes;
 
     // Set last edit time
-    hdr->SetLastVisit();
     hdr->SetLastEdit();
-    hdr->WriteBack(hdrPos);
+    inode->MarkDirty();
 
 // copy in the bytes we want to change
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
@@ -247,6 +252,7 @@ void
 OpenFile::Clear(){
     hdr->size = 0;
     hdr->numBytes = 0;
+    inode->MarkDirty();
     seekPosition = 0;
     readPosition = 0;
 }
@@ -60,6 +60,7 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class Inode;
 
 class OpenFile {
   public:
@@ -90,7 +91,8 @@ class OpenFile {
     void Clear();
     void Print();
   private:
-    FileHeader *hdr;			// Header for this file
+    Inode *inode;			// Shared in-core header for this file
+    FileHeader *hdr;			// The header itself (&inode->hdr)
     int seekPosition;			// Current position within the file
     int readPosition;
     int hdrPos;
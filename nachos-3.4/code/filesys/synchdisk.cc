@@ -16,6 +16,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -38,20 +39,14 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"format" -- the disk is being formatted (cf. Disk::Disk)
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, bool format)
 {
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (int) this);
-    for (int i=0;i<NumSectors;++i){
-        // printf("%d\n",i);
-        writable[i] = new Semaphore("name",1);
-        readerCount[i] = 0;
-        ownerCount[i] = 0;
-    }
-    mutex = new Semaphore("name",1);
+    disk = new Disk(name, DiskRequestDone, (int) this, format);
     for(int i=0;i<CacheSize;++i){
         cache[i].valid = 0;
         cache[i].sector = 0;
@@ -75,7 +70,8 @@ SynchDisk::~SynchDisk()
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read.  If the newest copy of the sector
+//	is still in the journal, it is returned from there.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -85,6 +81,9 @@ void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
     int index = -1;
+
+    if (journal != NULL && journal->Lookup(sectorNumber, data))
+        return;                 // newest copy is still in the journal
     for(int i=0;i<CacheSize;++i){
         if(cache[i].valid == 1 && cache[i].sector == sectorNumber){
             index = i;
@@ -93,7 +92,7 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
     }
     //miss
     if(index == -1){
-        printf("miss %d\n",sectorNumber);
+        TRACE_EVENT(TraceCacheMiss, sectorNumber, 0);
         lock->Acquire();            // only one disk I/O at a time
         disk->ReadRequest(sectorNumber, data);
         semaphore->P();         // wait for interrupt
@@ -123,7 +122,7 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
         bcopy(data,cache[rep].data,SectorSize);
     }
     else{
-        printf("hit %d\n",sectorNumber);
+        TRACE_EVENT(TraceCacheHit, sectorNumber, 0);
         cache[index].timestep = stats->totalTicks;
         disk->ReadRequest(sectorNumber, data);
         semaphore->P();         // wait for interrupt
@@ -141,7 +140,8 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+//	after the data has been written.  Inside a journal transaction,
+//	the sector is only written to the log, when the transaction commits.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -150,6 +150,8 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
+    if (journal != NULL && journal->Absorb(sectorNumber, data))
+        return;                 // goes to the log when committed
     lock->Acquire();			// only one disk I/O at a time
     disk->WriteRequest(sectorNumber, data);
     semaphore->P();			// wait for interrupt
@@ -162,76 +164,42 @@ SynchDisk::WriteSector(int sectorNumber, char* data)
 }
 
 //----------------------------------------------------------------------
-// SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
-//----------------------------------------------------------------------
-
-void
-SynchDisk::RequestDone()
-{
-    semaphore->V();
-}
-
-
-//----------------------------------------------------------------------
-// SynchDisk::StartReader
-//  When the reader starting to read, check if there are writers writing
-//----------------------------------------------------------------------
-
-void
-SynchDisk::StartReader(int sector)
-{
-    mutex->P();
-    readerCount[sector]++;
-    printf("readerCount is %d\n",readerCount[sector]);
-    if(readerCount[sector]==1){
-        writable[sector]->P();
-    }
-    mutex->V();
-}
-
-
-
-//----------------------------------------------------------------------
-// SynchDisk::EndReader
-//  When the reader finish reading, release the sem if
-//  no readers are working.
+// SynchDisk::ReadBulk
+// 	Read "count" sectors, starting at "first", straight from the disk
+//	image, bypassing the cache and the journal; see Disk::ReadBulk.
+//	The caller must make sure the disk is up to date.
 //----------------------------------------------------------------------
 
 void
-SynchDisk::EndReader(int sector)
+SynchDisk::ReadBulk(int first, int count, char* data)
 {
-    mutex->P();
-    readerCount[sector]--;
-    if(readerCount[sector]==0)
-        writable[sector]->V();
-    mutex->V();
+    lock->Acquire();			// no request may be in progress
+    disk->ReadBulk(first, count, data);
+    lock->Release();
 }
 
-
 //----------------------------------------------------------------------
-// SynchDisk::StartWriter
-//  When the writer starts to read, check if there are writers writing
-//  or readers reading
+// SynchDisk::Flush
+// 	Make sure every sector written so far is in the UNIX file that
+//	holds the disk; see Disk::Flush.
 //----------------------------------------------------------------------
 
 void
-SynchDisk::StartWriter(int sector)
+SynchDisk::Flush()
 {
-    writable[sector]->P();
+    lock->Acquire();
+    disk->Flush();
+    lock->Release();
 }
 
-
-
 //----------------------------------------------------------------------
-// SynchDisk::EndWriter
-//  When the writer finish reading, release the semaphore
+// SynchDisk::RequestDone
+// 	Disk interrupt handler.  Wake up any thread waiting for the disk
+//	request to finish.
 //----------------------------------------------------------------------
 
 void
-SynchDisk::EndWriter(int sector)
+SynchDisk::RequestDone()
 {
-    writable[sector]->V();
+    semaphore->V();
 }
-
@@ -37,7 +37,8 @@ public:
 
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
+    SynchDisk(char* name, bool format = FALSE);
+    					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
 
@@ -48,26 +49,21 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+    void ReadBulk(int first, int count, char* data);
+					// Read a run of sectors straight
+					// from the disk image (cf. fsck)
+    void Flush();			// Make sure everything written is
+					// in the disk image
 
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
-    void StartReader(int sector);
-    void EndReader(int sector);
-
-    void StartWriter(int sector);
-    void EndWriter(int sector);
-
 
     Disk *disk;		  		// Raw disk device
     Semaphore *semaphore; 		// To synchronize requesting thread
 					// with the interrupt handler
     Lock *lock;		  		// Only one read/write request
 					// can be sent to the disk at a time
-    Semaphore *writable[NumSectors];     // Exclusively read/write a disk sector
-    Semaphore *mutex;               // Exclusively access readerCount array
-    int readerCount[NumSectors];    // record reader count
-    int ownerCount[NumSectors];
 
     CacheEntry* cache = new CacheEntry[CacheSize];
 };
@@ -7,6 +7,9 @@
 //	delay), to signal that a byte has arrived and/or that a written
 //	byte has departed.
 //
+//	Also, routines for the synchronous interface to the console,
+//	which queues output so that it goes to the device in batches.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -23,6 +26,12 @@ static void ConsoleReadPoll(int c)
 { Console *console = (Console *)c; console->CheckCharAvail(); }
 static void ConsoleWriteDone(int c)
 { Console *console = (Console *)c; console->WriteDone(); }
+static void SynchReadAvail(int c)
+{ SynchConsole *console = (SynchConsole *)c; console->ReadAvail(); }
+static void SynchWriteDone(int c)
+{ SynchConsole *console = (SynchConsole *)c; console->WriteDone(); }
+
+bool consoleBatchTiming = FALSE;
 
 //----------------------------------------------------------------------
 // Console::Console
@@ -35,10 +44,13 @@ static void ConsoleWriteDone(int c)
 // 	"writeDone" is the interrupt handler called when a character has
 //		been output, so that it is ok to request the next char be
 //		output
+//	"poll" -- start polling the keyboard now?  (While polling, there
+//		is always an interrupt pending, so Nachos never runs out
+//		of things to do and halts.)
 //----------------------------------------------------------------------
 
 Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
-		VoidFunctionPtr writeDone, int callArg)
+		VoidFunctionPtr writeDone, int callArg, bool poll)
 {
     if (readFile == NULL)
 	readFileNo = 0;					// keyboard = stdin
@@ -54,10 +66,37 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     readHandler = readAvail;
     handlerArg = callArg;
     putBusy = FALSE;
-    incoming = EOF;
+    putCount = 0;
+    inBuf = new char[ConsoleInputSize];
+    inHead = inCount = 0;
+    inEOF = FALSE;
+    polling = pollPending = FALSE;
+
+    if (poll)
+	StartPolling();
+}
+
+//----------------------------------------------------------------------
+// Console::StartPolling, Console::StopPolling
+// 	Start polling for incoming characters, if we aren't already; or
+//	stop, once the poll already scheduled has happened.
+//----------------------------------------------------------------------
+
+void
+Console::StartPolling()
+{
+    polling = TRUE;
+    if (!pollPending) {
+	pollPending = TRUE;
+	interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime,
+			ConsoleReadInt);
+    }
+}
 
-    // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
+void
+Console::StopPolling()
+{
+    polling = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -71,36 +110,47 @@ Console::~Console()
 	Close(readFileNo);
     if (writeFileNo != 1)
 	Close(writeFileNo);
+    delete [] inBuf;
 }
 
 //----------------------------------------------------------------------
 // Console::CheckCharAvail()
-// 	Periodically called to check if a character is available for
-//	input from the simulated keyboard (eg, has it been typed?).
+// 	Periodically called to check if characters are available for
+//	input from the simulated keyboard (eg, have they been typed?).
 //
-//	Only read it in if there is buffer space for it (if the previous
-//	character has been grabbed out of the buffer by the Nachos kernel).
-//	Invoke the "read" interrupt handler, once the character has been
-//	put into the buffer.
+//	Read in as many as the UNIX file has ready and there is buffer
+//	space for, with one read.  Invoke the "read" interrupt handler,
+//	once they have been put into the buffer (or the file has run out).
 //----------------------------------------------------------------------
 
 void
 Console::CheckCharAvail()
 {
-    char c;
+    int tail, room, n;
 
-    // schedule the next time to poll for a packet
+    // schedule the next time to poll, unless we were told to stop
+    pollPending = FALSE;
+    if (!polling)
+	return;
+    pollPending = TRUE;
     interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime,
 			ConsoleReadInt);
 
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
+    // do nothing if the buffer is full, or none to be read
+    if (inEOF || inCount == ConsoleInputSize || !PollFile(readFileNo))
 	return;
 
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
-    incoming = c ;
-    stats->numConsoleCharsRead++;
+    // otherwise, read what we can (up to the end of the ring) and tell
+    // the user about it
+    tail = (inHead + inCount) % ConsoleInputSize;
+    room = min(ConsoleInputSize - inCount, ConsoleInputSize - tail);
+    n = ReadPartial(readFileNo, &inBuf[tail], room);
+    if (n <= 0)
+	inEOF = TRUE;
+    else {
+	inCount += n;
+	stats->numConsoleCharsRead += n;
+    }
     (*readHandler)(handlerArg);
 }
 
@@ -115,7 +165,7 @@ void
 Console::WriteDone()
 {
     putBusy = FALSE;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putCount;
     (*writeHandler)(handlerArg);
 }
 
@@ -128,12 +178,55 @@ Console::WriteDone()
 char
 Console::GetChar()
 {
-   char ch = incoming;
+    char ch;
+
+    if (GetChars(&ch, 1, FALSE) == 0)
+	return EOF;
+    return ch;
+}
+
+//----------------------------------------------------------------------
+// Console::GetChars()
+// 	Take up to "numBytes" characters from the input buffer.  If
+//	"line", stop after the first newline.  Return how many were taken.
+//----------------------------------------------------------------------
+
+int
+Console::GetChars(char *into, int numBytes, bool line)
+{
+    int n = 0;
+
+    while (n < numBytes && inCount > 0) {
+	char ch = inBuf[inHead];
 
-   incoming = EOF;
-   return ch;
+	into[n++] = ch;
+	inHead = (inHead + 1) % ConsoleInputSize;
+	inCount--;
+	if (line && ch == '\n')
+	    break;
+    }
+    return n;
 }
 
+//----------------------------------------------------------------------
+// Console::LineReady()
+// 	Return TRUE if a reader wanting a line of at most "numBytes"
+//	characters can have one now: a newline is buffered, or that many
+//	characters are, or the buffer is full, or the file has run out.
+//----------------------------------------------------------------------
+
+bool
+Console::LineReady(int numBytes)
+{
+    if (inCount >= numBytes || inCount == ConsoleInputSize || inEOF)
+	return TRUE;
+    for (int i = 0; i < inCount; i++)
+	if (inBuf[(inHead + i) % ConsoleInputSize] == '\n')
+	    return TRUE;
+    return FALSE;
+}
+
+
 //----------------------------------------------------------------------
 // Console::PutChar()
 // 	Write a character to the simulated display, schedule an interrupt
@@ -143,59 +236,231 @@ Console::GetChar()
 void
 Console::PutChar(char ch)
 {
-    ASSERT(putBusy == FALSE);
-    WriteFile(writeFileNo, &ch, sizeof(char));
+    PutBuffer(&ch, 1);
+}
+
+//----------------------------------------------------------------------
+// Console::PutBuffer()
+// 	Write "numBytes" characters to the simulated display, with a
+//	single write to the UNIX file, schedule one interrupt for when
+//	they have all gone out, and return.  They take ConsoleTime
+//	apiece, unless "consoleBatchTiming", when the whole batch takes
+//	ConsoleTime.
+//----------------------------------------------------------------------
+
+void
+Console::PutBuffer(char *data, int numBytes)
+{
+    ASSERT(putBusy == FALSE && numBytes > 0);
+    WriteFile(writeFileNo, data, numBytes);
     putBusy = TRUE;
-    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
-					ConsoleWriteInt);
+    putCount = numBytes;
+    interrupt->Schedule(ConsoleWriteDone, (int)this,
+		consoleBatchTiming ? ConsoleTime : ConsoleTime * numBytes,
+		ConsoleWriteInt);
 }
 
 //----------------------------------------------------------------------
-// SynchConsole::SynchConsole()
+// SynchConsole::SynchConsole
+// 	Initialize the synchronous interface to the console, in turn
+//	initializing the console device.  The keyboard isn't polled
+//	until somebody asks for a character.
+//
+//	"readFile", "writeFile" -- as for Console::Console
 //----------------------------------------------------------------------
 
-static void
-SynchConsole::ReadAvail(int arg) { SynchConsole *c = (SynchConsole *)arg; c->readAvail->V(); }
-static void
-SynchConsole::WriteDone(int arg) { SynchConsole *c = (SynchConsole *)arg; c->writeDone->V(); }
+SynchConsole::SynchConsole(char *readFile, char *writeFile)
+{
+    console = new Console(readFile, writeFile, SynchReadAvail,
+				SynchWriteDone, (int)this, FALSE);
+    readLock = new Lock("console read lock");
+    writeLock = new Lock("console write lock");
+    readAvail = new Semaphore("console read avail", 0);
+    canonical = TRUE;
+    writeRoom = new Semaphore("console write room", 0);
+    ring = new char[ConsoleRingSize];
+    head = count = inFlight = 0;
+    waiting = 0;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::~SynchConsole
+// 	De-allocate the synchronous console, and the console device.
+//	Output still queued is lost; call Flush first to avoid that.
+//----------------------------------------------------------------------
 
-SynchConsole::SynchConsole(char*readFile, char*writeFile){
-    lock = new Lock("synch console");
-    console = new Console(readFile,writeFile,ReadAvail,WriteDone,this);
-    readAvail = new Semaphore("read sem",0);
-    writeDone = new Semaphore("write sem",0);
+SynchConsole::~SynchConsole()
+{
+    delete console;
+    delete readLock;
+    delete writeLock;
+    delete readAvail;
+    delete writeRoom;
+    delete [] ring;
 }
 
 //----------------------------------------------------------------------
-// SynchConsole::GetChar()
-//  Read a character from the input buffer, if there is any there.
-//  Either return the character, or EOF if none buffered.
+// SynchConsole::GetChar
+// 	Wait for a character to arrive from the keyboard, and return it
+//	(EOF at end of file).
 //----------------------------------------------------------------------
 
 char
 SynchConsole::GetChar()
 {
-    lock->Acquire();
-    readAvail->P();
-    char ch = console->GetChar();
-    lock->Release();
+    char ch;
+    bool savedMode = canonical;
+
+    canonical = FALSE;
+    if (Read(&ch, 1) == 0)
+	ch = EOF;
+    canonical = savedMode;
     return ch;
 }
 
 //----------------------------------------------------------------------
-// Console::PutChar()
-//  Write a character to the simulated display, schedule an interrupt
-//  to occur in the future, and return.
+// SynchConsole::Read
+// 	Wait until there is input for us -- a whole line, in canonical
+//	mode, or anything at all otherwise -- and return up to "numBytes"
+//	characters of it.  Anything after the line stays buffered for the
+//	next Read.  Return 0 at end of file.
+//
+//	The keyboard is polled only while we wait; the interrupt handler
+//	wakes us up each time input arrives.
+//
+//	"into" -- where to put the input
+//	"numBytes" -- the most to return
+//----------------------------------------------------------------------
+
+int
+SynchConsole::Read(char *into, int numBytes)
+{
+    int n;
+
+    readLock->Acquire();
+    for (;;) {
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	bool ready = canonical ? console->LineReady(numBytes)
+			: (console->NumAvail() > 0 || console->AtEOF());
+
+	if (ready) {
+	    n = console->GetChars(into, numBytes, canonical);
+	    console->StopPolling();
+	    (void) interrupt->SetLevel(oldLevel);
+	    break;
+	}
+	console->StartPolling();
+	(void) interrupt->SetLevel(oldLevel);
+	readAvail->P();
+    }
+    readLock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::PutChar, SynchConsole::Write
+// 	Queue characters for display, and return without waiting for
+//	them to go out, unless the ring is full.  If the device is idle,
+//	start it on what we have queued.
+//
+//	The ring is shared with the interrupt handler, so it is only
+//	touched with interrupts disabled.
+//
+//	"from" -- the characters to display
+//	"numBytes" -- how many of them
 //----------------------------------------------------------------------
 
 void
 SynchConsole::PutChar(char ch)
 {
-    lock->Acquire();
-    console->PutChar(ch);
-    writeDone->P();
-    lock->Release();
+    Write(&ch, 1);
 }
 
+void
+SynchConsole::Write(char *from, int numBytes)
+{
+    writeLock->Acquire();
+    while (numBytes > 0) {
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	int n = min(numBytes, ConsoleRingSize - count);
 
+	if (n == 0) {			// full; wait for the device
+	    waiting++;
+	    (void) interrupt->SetLevel(oldLevel);
+	    writeRoom->P();
+	    continue;
+	}
+	for (int i = 0; i < n; i++)
+	    ring[(head + count + i) % ConsoleRingSize] = from[i];
+	count += n;
+	from += n;
+	numBytes -= n;
+	if (inFlight == 0)
+	    StartWrite();
+	(void) interrupt->SetLevel(oldLevel);
+    }
+    writeLock->Release();
+}
 
+//----------------------------------------------------------------------
+// SynchConsole::Flush
+// 	Wait until every character queued has gone out.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Flush()
+{
+    writeLock->Acquire();
+    for (;;) {
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+	if (count == 0) {
+	    (void) interrupt->SetLevel(oldLevel);
+	    break;
+	}
+	waiting++;
+	(void) interrupt->SetLevel(oldLevel);
+	writeRoom->P();
+    }
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::StartWrite
+// 	Hand the device everything queued, up to the end of the ring
+//	(the rest goes in the next batch).  Interrupts are disabled.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::StartWrite()
+{
+    inFlight = min(count, ConsoleRingSize - head);
+    console->PutBuffer(&ring[head], inFlight);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::ReadAvail, SynchConsole::WriteDone
+// 	Console interrupt handlers.  Input has arrived; or a batch
+//	has gone out, so start the next one, and wake up a thread waiting
+//	for room (or for the ring to drain).
+//----------------------------------------------------------------------
+
+void
+SynchConsole::ReadAvail()
+{
+    readAvail->V();
+}
+
+void
+SynchConsole::WriteDone()
+{
+    head = (head + inFlight) % ConsoleRingSize;
+    count -= inFlight;
+    inFlight = 0;
+    if (count > 0)
+	StartWrite();
+    if (waiting > 0) {
+	waiting--;
+	writeRoom->V();
+    }
+}
@@ -31,26 +31,47 @@
 // and writing to UNIX files ("readFile" and "writeFile").
 //
 // Since the device is asynchronous, the interrupt handler "readAvail"
-// is called when a character has arrived, ready to be read in.
+// is called when characters have arrived, ready to be read in.  The
+// device reads whatever the UNIX file has ready in one go, into a ring
+// buffer of ConsoleInputSize characters.
 // The interrupt handler "writeDone" is called when an output character
 // has been "put", so that the next character can be written.
 
+#define ConsoleInputSize	512	// characters typed ahead, not yet read
+
 class Console {
   public:
     Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
-	VoidFunctionPtr writeDone, int callArg);
-				// initialize the hardware console device
+	VoidFunctionPtr writeDone, int callArg, bool poll = TRUE);
+				// initialize the hardware console device;
+				// if not "poll", the keyboard is not
+				// looked at until StartPolling
     ~Console();			// clean up console emulation
 
 // external interface -- Nachos kernel code can call these
     void PutChar(char ch);	// Write "ch" to the console display,
 				// and return immediately.  "writeHandler"
 				// is called when the I/O completes.
+    void PutBuffer(char *data, int numBytes);
+				// The same, for "numBytes" characters
+				// at once; "writeHandler" is called
+				// once, when they have all gone out
+    void StartPolling();	// Start looking for keyboard input
+    void StopPolling();		// ... and stop (nobody is waiting for it)
 
     char GetChar();	   	// Poll the console input.  If a char is
 				// available, return it.  Otherwise, return EOF.
     				// "readHandler" is called whenever there is
 				// a char to be gotten
+    int GetChars(char *into, int numBytes, bool line);
+				// Take up to "numBytes" chars of input
+				// (if "line", stopping after a newline);
+				// return how many
+    bool LineReady(int numBytes);
+				// Is there a whole line of input, or
+				// "numBytes" chars of it, or end of file?
+    int NumAvail() { return inCount; }	// chars of input buffered
+    bool AtEOF() { return inEOF && inCount == 0; }
 
 // internal emulation routines -- DO NOT call these.
     void WriteDone();	 	// internal routines to signal I/O completion
@@ -67,33 +88,68 @@ class Console {
 					// interrupt handlers
     bool putBusy;    			// Is a PutChar operation in progress?
 					// If so, you can't do another one!
-    char incoming;    			// Contains the character to be read,
-					// if there is one available.
-					// Otherwise contains EOF.
+    int putCount;			// Characters it is writing
+    bool polling;			// Looking for keyboard input yet?
+    char *inBuf;			// Characters read from "readFileNo"
+    int inHead, inCount;		// and not yet taken, as a ring
+    bool inEOF;				// Has "readFileNo" run out?
+    bool pollPending;			// Is a poll scheduled?
 };
-class SynchConsole{
-public:
+// The following class defines a synchronous interface to the console.
+// Output is queued in a ring buffer and handed to the device a batch
+// at a time (as much as is queued), so a thread writing a buffer waits
+// only when the ring is full, and the device takes one write and one
+// interrupt per batch rather than per character.
+//
+// Input is read from the device's ring.  In canonical (line) mode, the
+// default, Read waits for a whole line and returns it at once;
+// otherwise it returns whatever has been typed, waiting only if that
+// is nothing.  A reader sleeps on a semaphore until input arrives; the
+// keyboard is only polled while somebody is waiting.
+
+#define ConsoleRingSize	1024	// bytes of output queued for display
+
+class SynchConsole {
+  public:
     SynchConsole(char *readFile, char *writeFile);
-                // initialize the hardware console device
-    ~SynchConsole();         // clean up console emulation
+				// initialize the console (cf. Console)
+    ~SynchConsole();		// clean up console emulation
 
-// external interface -- Nachos kernel code can call these
-    void PutChar(char ch);  // Write "ch" to the console display,
-                // and return immediately.  "writeHandler"
-                // is called when the I/O completes.
+    void PutChar(char ch);	// Queue "ch" for display
+    void Write(char *from, int numBytes);
+				// Queue "numBytes" bytes for display;
+				// wait only while the ring is full
+    void Flush();		// Wait until everything queued has
+				// been displayed
+    char GetChar();		// Wait for a character to be typed,
+				// and return it
+    int Read(char *into, int numBytes);
+				// Wait for a line (or, if not canonical,
+				// any input); return up to "numBytes"
+				// chars of it, or 0 at end of file
+    void SetCanonical(bool line) { canonical = line; }
 
-    char GetChar();     // Poll the console input.  If a char is
-                // available, return it.  Otherwise, return EOF.
-                    // "readHandler" is called whenever there is
-                // a char to be gotten
-    static void SynchConsole::ReadAvail(int arg);
-    static void SynchConsole::WriteDone(int arg);
+    void ReadAvail();		// internal routines, called by the
+    void WriteDone();		// console interrupt handlers
 
   private:
-    Console* console;
-    Lock* lock;
-    Semaphore* readAvail;
-    Semaphore* writeDone;
+    void StartWrite();		// Hand the next batch to the device
 
+    Console *console;
+    Lock *readLock;		// one reader at a time
+    Lock *writeLock;		// one writer at a time
+    Semaphore *readAvail;	// input has arrived
+    bool canonical;		// Read a line at a time?
+    Semaphore *writeRoom;	// a batch has been written
+    char *ring;			// output waiting to be displayed
+    int head;			// first byte not yet displayed
+    int count;			// bytes in the ring
+    int inFlight;		// of which the device is writing now
+    int waiting;		// writers waiting on writeRoom
 };
+
+extern bool consoleBatchTiming;	// does a batch of output take as long
+				// as one character (rather than one
+				// character time per byte)?
+
 #endif // CONSOLE_H
@@ -20,10 +20,23 @@
 // We put this at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file
 // as a disk (which would probably trash the file's contents).
-#define MagicNumber 	0x456789ab
+#define MagicNumber 	0x456789ab	// followed by sector 0
+#define GeometryMagic	0x456789ac	// followed by the geometry
 #define MagicSize 	sizeof(int)
 
-#define DiskSize 	(MagicSize + (NumSectors * SectorSize))
+// The geometry stored after GeometryMagic.
+#define GeometrySize	(3 * sizeof(int))	// sector size, sectors per
+						// track, number of tracks
+
+// Where a sector starts in the UNIX file.  The disk may be bigger than
+// 2GB, so the offset doesn't always fit in an int.
+#define SectorOffset(sector) \
+	((long long) SectorSize * (sector) + headerSize)
+
+int SectorsPerTrack = DefaultSectorsPerTrack;
+int NumTracks = DefaultNumTracks;
+bool diskMapped = FALSE;
+bool diskSync = FALSE;
 
 // dummy procedure because we can't take a pointer of a member function
 static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
@@ -32,38 +45,76 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  Set the geometry of the
+//	disk from what is stored in the file.
+//
+//	When formatting, or if the file doesn't exist, create it afresh
+//	with the geometry in SectorsPerTrack and NumTracks.
+//
+//	If "diskMapped", map the file into memory once it is the right
+//	size.  If it can't be mapped, fall back on system calls.
 //
 //	"name" -- text name of the file simulating the Nachos disk
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
 //	"callArg" -- argument to pass the interrupt handler
+//	"format" -- throw away what is in the file
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg, bool format)
 {
     int magicNum;
+    int geometry[GeometrySize / sizeof(int)];
     int tmp = 0;
 
     DEBUG('d', "Initializing the disk, 0x%x 0x%x\n", callWhenDone, callArg);
     handler = callWhenDone;
     handlerArg = callArg;
     lastSector = 0;
+    requestStart = 0;
     bufferInit = 0;
 
-    fileno = OpenForReadWrite(name, FALSE);
+    fileno = format ? -1 : OpenForReadWrite(name, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number
 	Read(fileno, (char *) &magicNum, MagicSize);
-	ASSERT(magicNum == MagicNumber);
+	if (magicNum == GeometryMagic) {
+	    Read(fileno, (char *) geometry, GeometrySize);
+	    ASSERT(geometry[0] == SectorSize);	// compiled for another size
+	    SectorsPerTrack = geometry[1];
+	    NumTracks = geometry[2];
+	    headerSize = MagicSize + GeometrySize;
+	} else {
+	    ASSERT(magicNum == MagicNumber);
+	    ASSERT(SectorSize == 128);		// an old disk
+	    SectorsPerTrack = DefaultSectorsPerTrack;
+	    NumTracks = DefaultNumTracks;
+	    headerSize = MagicSize;
+	}
     } else {				// file doesn't exist, create it
         fileno = OpenForWrite(name);
-	magicNum = MagicNumber;
+	magicNum = GeometryMagic;
 	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+	geometry[0] = SectorSize;
+	geometry[1] = SectorsPerTrack;
+	geometry[2] = NumTracks;
+	WriteFile(fileno, (char *) geometry, GeometrySize);
+	headerSize = MagicSize + GeometrySize;
 
 	// need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);
+        Lseek(fileno, SectorOffset(NumSectors) - sizeof(int), 0);
 	WriteFile(fileno, (char *)&tmp, sizeof(int));
     }
+    DEBUG('d', "Disk has %d tracks of %d sectors of %d bytes\n",
+	  NumTracks, SectorsPerTrack, SectorSize);
+
+    mapped = NULL;
+    mappedSize = SectorOffset(NumSectors);
+    if (diskMapped) {
+	mapped = MapFile(fileno, mappedSize);
+	if (mapped == NULL)
+	    printf("Can't map %s into memory; using read/write instead\n",
+		   name);
+    }
     active = FALSE;
 }
 
@@ -75,9 +126,27 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
 
 Disk::~Disk()
 {
+    if (mapped != NULL) {
+	Flush();
+	UnmapFile(mapped, mappedSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Flush()
+// 	If the UNIX file is mapped into memory, and "diskSync" is set,
+//	wait until everything written to the disk is in the file.  With
+//	system calls, it is there as soon as the request is made.
+//----------------------------------------------------------------------
+
+void
+Disk::Flush()
+{
+    if (mapped != NULL && diskSync)
+	SyncMappedFile(mapped, mappedSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -100,7 +169,8 @@ PrintSector (bool writing, int sector, char *data)
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
 // 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
+//	   Do the read/write immediately to the UNIX file (or to its
+//	     image in memory, if mapped)
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
@@ -125,14 +195,21 @@ Disk::ReadRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
 
     DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    if (mapped != NULL)
+	bcopy(&mapped[SectorOffset(sectorNumber)], data, SectorSize);
+    else {
+	Lseek(fileno, SectorOffset(sectorNumber), 0);
+	Read(fileno, data, SectorSize);
+    }
     if (DebugIsEnabled('d'))
 	PrintSector(FALSE, sectorNumber, data);
 
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
+    TRACE_EVENT(TraceDiskRequest, sectorNumber, 0);
+    metrics->Count(CountDiskRequests);
+    requestStart = stats->totalTicks;
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -150,14 +227,21 @@ Disk::WriteRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
 
     DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    if (mapped != NULL)
+	bcopy(data, &mapped[SectorOffset(sectorNumber)], SectorSize);
+    else {
+	Lseek(fileno, SectorOffset(sectorNumber), 0);
+	WriteFile(fileno, data, SectorSize);
+    }
     if (DebugIsEnabled('d'))
 	PrintSector(TRUE, sectorNumber, data);
 
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
+    TRACE_EVENT(TraceDiskRequest, sectorNumber, 1);
+    metrics->Count(CountDiskRequests);
+    requestStart = stats->totalTicks;
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -171,6 +255,8 @@ void
 Disk::HandleInterrupt ()
 {
     active = FALSE;
+    TRACE_EVENT(TraceDiskDone, lastSector, 0);
+    metrics->RecordLatency(LatencyDisk, stats->totalTicks - requestStart);
     (*handler)(handlerArg);
 }
 
@@ -217,6 +303,33 @@ Disk::ModuloDiff(int to, int from)
     return ((toOffset - fromOffset) + SectorsPerTrack) % SectorsPerTrack;
 }
 
+//----------------------------------------------------------------------
+// Disk::ReadBulk
+// 	Read "count" sectors, starting at "first", straight from the UNIX
+//	file in a single read.  Unlike ReadRequest, this is not a simulated
+//	disk operation: it takes no simulated time and causes no interrupt.
+//	It is meant for tools such as fsck, that look at the whole disk.
+//
+//	"first" -- the first sector to read
+//	"count" -- how many sectors to read
+//	"data" -- the buffer to hold them
+//----------------------------------------------------------------------
+
+void
+Disk::ReadBulk(int first, int count, char* data)
+{
+    ASSERT(!active);
+    ASSERT((first >= 0) && (count >= 0) && (first + count <= NumSectors));
+
+    DEBUG('d', "Reading %d sectors from sector %d\n", count, first);
+    if (mapped != NULL)
+	bcopy(&mapped[SectorOffset(first)], data, SectorSize * count);
+    else {
+	Lseek(fileno, SectorOffset(first), 0);
+	Read(fileno, data, SectorSize * count);
+    }
+}
+
 //----------------------------------------------------------------------
 // Disk::ComputeLatency()
 // 	Return how long will it take to read/write a disk sector, from
@@ -45,19 +45,47 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// The sector size is fixed when Nachos is compiled (-DSECTOR_SIZE=4096,
+// say), since the file system lays out its data structures to fit in a
+// sector.  The number of tracks, and of sectors per track, are chosen
+// when the disk is formatted, and stored at the front of the UNIX file;
+// they are read back in when the disk is opened.  A disk made before
+// this was possible has only a magic number there, and 32 tracks of 32
+// sectors of 128 bytes.
+
+#ifndef SECTOR_SIZE
+#define SECTOR_SIZE		128
+#endif
+
+#define SectorSize 		SECTOR_SIZE	// number of bytes per disk sector
+#define DefaultSectorsPerTrack	32
+#define DefaultNumTracks	32
 
-#define SectorSize 		128	// number of bytes per disk sector
-#define SectorsPerTrack 	32	// number of sectors per disk track 
-#define NumTracks 		32	// number of tracks per disk
+extern int SectorsPerTrack;		// number of sectors per disk track
+extern int NumTracks;			// number of tracks per disk
 #define NumSectors 		(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
 
+// Instead of a system call per request, the UNIX file can be mapped
+// into memory, and sectors copied in and out of it.  That changes
+// nothing about the simulated disk -- requests take just as long --
+// but Nachos spends much less real time in the host kernel.  The data
+// then reaches the file whenever the host decides, unless "diskSync"
+// is set, in which case Flush waits for it.
+
+extern bool diskMapped;			// map the UNIX file into memory?
+extern bool diskSync;			// if so, have Flush msync it?
+
 class Disk {
   public:
-    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg);
+    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg,
+	 bool format = FALSE);
     					// Create a simulated disk.  
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
+					// If "format", (re)create the UNIX
+					// file with the current geometry.
     ~Disk();				// Deallocate the disk.
     
     void ReadRequest(int sectorNumber, char* data);
@@ -66,6 +94,12 @@ class Disk {
     					// the disk and return immediately.
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
+    void ReadBulk(int first, int count, char* data);
+					// Read a run of sectors at once,
+					// outside of the simulation (no
+					// simulated time, no interrupt)
+    void Flush();			// Make sure everything written is
+					// in the UNIX file (if mapped)
 
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
@@ -77,6 +111,10 @@ class Disk {
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    int headerSize;			// Bytes before sector 0 in the file
+    char *mapped;			// The file, mapped into memory, or
+					// NULL if we use system calls
+    long long mappedSize;		// How much of it is mapped
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     int handlerArg;			// Argument to interrupt handler 
@@ -84,6 +122,8 @@ class Disk {
     int lastSector;			// The previous disk request 
     int bufferInit;			// When the track buffer started 
 					// being loaded
+    int requestStart;			// When the request in progress
+					// was made
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
@@ -160,8 +160,10 @@ Interrupt::OneTick()
     } else {					// USER_PROGRAM
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
+	metrics->ForCurrentThread()->userTicks += UserTick;
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
+    metrics->Poll();			// write a snapshot, if one is due
 
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
@@ -169,6 +171,8 @@ Interrupt::OneTick()
 					// interrupts disabled)
     while (CheckIfDue(FALSE))		// check for pending interrupts
 	;
+    if (smp != NULL && !yieldOnReturn)	// let another CPU run, if this
+	smp->Tick();			// one has had its quantum
     ChangeLevel(IntOff, IntOn);		// re-enable interrupts
     if (yieldOnReturn) {		// if the timer device handler asked 
 					// for a context switch, ok to do it now
@@ -242,7 +246,10 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    if (smp != NULL)
+	smp->Stop();			// prints how busy each CPU was
     stats->Print();
+    metrics->Print();
     Cleanup();     // Never returns.
 }
 
@@ -329,6 +336,8 @@ Interrupt::CheckIfDue(bool advanceClock)
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
 						// running in the kernel
+    TRACE_EVENT(TraceInterrupt, toOccur->type, 0);
+    metrics->Count(CountInterrupts);
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
@@ -85,13 +85,12 @@ Machine::Machine(bool debug)
     // pageTable     = NULL;
     // tlb_top       = 0;
     // pageTable_top = 0;
-    // tlb_miss_time = 0;
-    // tlb_hit_time  = 0;
 // #else	// use linear page table
     tlb = NULL;
     // pageTable = NULL;
 #endif
 
+    timing = NULL;
     singleStep = debug;
     CheckEndian();
 }
@@ -106,6 +105,7 @@ Machine::~Machine()
     delete [] mainMemory;
     if (tlb != NULL)
         delete [] tlb;
+    delete timing;			// prints the cache statistics
 }
 
 //----------------------------------------------------------------------
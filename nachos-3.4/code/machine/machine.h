@@ -26,12 +26,12 @@
 #include "translate.h"
 #include "disk.h"
 #include "bitmap.h"
+#include "timing.h"
 
 // Definitions related to the size, and format of user memory
 
-#define PageSize 	SectorSize 	// set the page size equal to
-					// the disk sector size, for
-					// simplicity
+#define PageSize 	128		// no longer tied to the disk
+					// sector size, which can change
 
 #define NumPhysPages    64
 #define MemorySize 	(NumPhysPages * PageSize)
@@ -182,8 +182,6 @@ class Machine {
     // pointer point to the top of tlb, implemented for FIFO
     int tlb_top;
     int pageTable_top;
-    int tlb_miss_time;
-    int tlb_hit_time;
     int cnttt;
 
     TranslationEntry *pageTable;
@@ -193,6 +191,9 @@ class Machine {
     // Simulate the disk
     OpenFile *simDisk;
 
+    TimingModel *timing;	// charges instructions for stalls, if
+				// the timing model is on (else NULL)
+
   private:
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
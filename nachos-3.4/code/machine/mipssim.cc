@@ -38,6 +38,8 @@ Machine::Run()
     interrupt->setStatus(UserMode);
     for (;;) {
         OneInstruction(instr);
+	if (profiler != NULL)
+	    profiler->Instruction();
 	interrupt->OneTick();
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
@@ -218,14 +220,23 @@ Machine::OneInstruction(Instruction *instr)
 	
       case OP_JAL:
 	registers[R31] = registers[NextPCReg] + 4;
+	if (profiler != NULL)
+	    profiler->Call(registers[R31]);
       case OP_J:
 	pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
 	break;
 	
       case OP_JALR:
 	registers[instr->rd] = registers[NextPCReg] + 4;
+	if (profiler != NULL)
+	    profiler->Call(registers[instr->rd]);
+	pcAfter = registers[instr->rs];
+	break;
+
       case OP_JR:
 	pcAfter = registers[instr->rs];
+	if (profiler != NULL && instr->rs == RetAddrReg)
+	    profiler->Return(pcAfter);
 	break;
 	
       case OP_LB:
@@ -553,6 +564,12 @@ Machine::OneInstruction(Instruction *instr)
     }
     
     // Now we have successfully executed the instruction.
+
+    // Charge it for any stalls (the address is only used by loads and
+    // stores, and is computed before this instruction's load lands)
+    if (timing != NULL)
+	timing->Execute(instr, registers[PCReg],
+			registers[instr->rs] + instr->extra);
     
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
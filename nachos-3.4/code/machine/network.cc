@@ -20,6 +20,78 @@ static void NetworkReadPoll(int arg)
 static void NetworkSendDone(int arg)
 { Network *net = (Network *)arg; net->SendDone(); }
 
+// Set up a pool of "size" packet buffers, all free
+PacketPool::PacketPool(int size)
+{
+    packets = new Packet[size];
+    freeList = NULL;
+    for (int i = 0; i < size; i++) {
+	packets[i].next = freeList;
+	freeList = &packets[i];
+    }
+    numFree = size;
+    waiting = 0;
+    freed = new Semaphore("packet freed", 0);
+}
+
+PacketPool::~PacketPool()
+{
+    delete [] packets;
+    delete freed;
+}
+
+// take a free buffer, waiting for one to be freed if need be.
+// Called by threads only.
+Packet *
+PacketPool::Alloc()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Packet *pkt;
+
+    while (freeList == NULL) {
+	waiting++;
+	freed->P();
+    }
+    pkt = freeList;
+    freeList = pkt->next;
+    numFree--;
+    (void) interrupt->SetLevel(oldLevel);
+    return pkt;
+}
+
+// take a free buffer, unless no more than "reserve" are left.
+// Never waits, so it can be called by an interrupt handler.
+Packet *
+PacketPool::TryAlloc(int reserve)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Packet *pkt = NULL;
+
+    if (numFree > reserve) {
+	pkt = freeList;
+	freeList = pkt->next;
+	numFree--;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return pkt;
+}
+
+// give a buffer back, and wake up a thread waiting for one
+void
+PacketPool::Free(Packet *pkt)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    pkt->next = freeList;
+    freeList = pkt;
+    numFree++;
+    if (waiting > 0) {
+	waiting--;
+	freed->V();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
 // Initialize the network emulation
 //   addr is used to generate the socket name
 //   reliability says whether we drop packets to emulate unreliable links
@@ -37,7 +109,8 @@ Network::Network(NetworkAddress addr, double reliability,
     readHandler = readAvail;
     handlerArg = callArg;
     sendBusy = FALSE;
-    inHdr.length = 0;
+    pool = new PacketPool(PacketPoolSize);
+    ringHead = ringCount = 0;
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", (int)addr);
@@ -52,38 +125,59 @@ Network::~Network()
 {
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
+    while (ringCount > 0)
+	FreePacket(Receive());
+    delete pool;
 }
 
-// if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
-// packet might be dropped if we can't read it in time.
+// read every packet waiting on the socket, as far as there is room in
+// the ring (and free buffers), straight into packet buffers, with one
+// system call.  Packets we have no room for stay in the socket until
+// the next poll.  In real life, they might be dropped.
 void
 Network::CheckPktAvail()
 {
+    Packet *pkts[NetRingSize];
+    char *buffers[NetRingSize];
+    int sizes[NetRingSize];
+    int i, n, numBufs;
+
     // schedule the next time to poll for a packet
     interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
 
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
+    if (ringCount == NetRingSize) 	// do nothing if the ring is full
 	return;		
     if (!PollSocket(sock)) 	// do nothing if no packet to be read
 	return;
 
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
-
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == ident) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete []buffer ;
-
-    DEBUG('n', "Network received packet from %d, length %d...\n",
-	  				(int) inHdr.from, inHdr.length);
-    stats->numPacketsRecvd++;
-
-    // tell post office that the packet has arrived
-    (*readHandler)(handlerArg);	
+    // otherwise, read as many packets as we can in
+    for (numBufs = 0; numBufs < NetRingSize - ringCount; numBufs++) {
+	pkts[numBufs] = pool->TryAlloc(PoolReserve);
+	if (pkts[numBufs] == NULL)
+	    break;
+	buffers[numBufs] = (char *) pkts[numBufs];
+    }
+    n = ReadFromSocketBatch(sock, buffers, sizes, MaxWireSize, numBufs);
+    for (i = n; i < numBufs; i++)		// not needed this time
+	pool->Free(pkts[i]);
+    if (n > 0)
+	stats->numPacketBatches++;
+
+    for (i = 0; i < n; i++) {
+	PacketHeader *hdr = &pkts[i]->hdr;
+
+	ASSERT((sizes[i] >= (int) sizeof(PacketHeader))
+		&& (hdr->to == ident) && (hdr->length <= MaxPacketSize)
+		&& (sizes[i] == (int) (sizeof(PacketHeader) + hdr->length)));
+	DEBUG('n', "Network received packet from %d, length %d...\n",
+	  				(int) hdr->from, hdr->length);
+	stats->numPacketsRecvd++;
+	ring[(ringHead + ringCount) % NetRingSize] = pkts[i];
+	ringCount++;
+
+	// tell post office that the packet has arrived
+	(*readHandler)(handlerArg);	
+    }
 }
 
 // notify user that another packet can be sent
@@ -95,21 +189,23 @@ Network::SendDone()
     (*writeHandler)(handlerArg);
 }
 
-// send a packet by concatenating hdr and data, and schedule
-// an interrupt to tell the user when the next packet can be sent 
+// send a packet, in place, and schedule an interrupt to tell the user
+// when the next packet can be sent 
 //
-// Note we always pad out a packet to MaxWireSize before putting it into
-// the socket, because it's simpler at the receive end.
+// Only as many bytes as the packet holds go into the socket; the
+// receiver gets the length from the datagram.
 void
-Network::Send(PacketHeader hdr, char* data)
+Network::Send(Packet *pkt)
 {
     char toName[32];
+    PacketHeader *hdr = &pkt->hdr;
 
-    sprintf(toName, "SOCKET_%d", (int)hdr.to);
+    sprintf(toName, "SOCKET_%d", (int)hdr->to);
     
-    ASSERT((sendBusy == FALSE) && (hdr.length > 0) 
-		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
-    DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
+    hdr->from = ident;
+    ASSERT((sendBusy == FALSE) && (hdr->length > 0) 
+		&& (hdr->length <= MaxPacketSize));
+    DEBUG('n', "Sending to addr %d, %d bytes... ", hdr->to, hdr->length);
 
     interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
 
@@ -118,22 +214,22 @@ Network::Send(PacketHeader hdr, char* data)
 	return;
     }
 
-    // concatenate hdr and data into a single buffer, and send it out
-    char *buffer = new char[MaxWireSize];
-    *(PacketHeader *)buffer = hdr;
-    bcopy(data, buffer + sizeof(PacketHeader), hdr.length);
-    SendToSocket(sock, buffer, MaxWireSize, toName);
-    delete []buffer;
+    SendToSocket(sock, (char *) pkt, sizeof(PacketHeader) + hdr->length,
+			toName);
 }
 
-// read a packet, if one is buffered
-PacketHeader
-Network::Receive(char* data)
+// take the oldest packet that has arrived, if there is one
+Packet *
+Network::Receive()
 {
-    PacketHeader hdr = inHdr;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Packet *pkt = NULL;
 
-    inHdr.length = 0;
-    if (hdr.length != 0)
-    	bcopy(inbox, data, hdr.length);
-    return hdr;
+    if (ringCount > 0) {
+	pkt = ring[ringHead];
+	ringHead = (ringHead + 1) % NetRingSize;
+	ringCount--;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return pkt;
 }
@@ -1,7 +1,7 @@
 // network.h 
 //	Data structures to emulate a physical network connection.
 //	The network provides the abstraction of ordered, unreliable,
-//	fixed-size packet delivery to other machines on the network.
+//	bounded-size packet delivery to other machines on the network.
 //
 //	You may note that the interface to the network is similar to 
 //	the console device -- both are full duplex channels.
@@ -41,10 +41,60 @@ class PacketHeader {
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
 
+// The following class defines a packet buffer.  The header and the data
+// are laid out just as they go out on the wire, so a packet is read
+// from and written to the socket in place; only the header and
+// "length" bytes of data are sent.
+
+class Packet {
+  public:
+    PacketHeader hdr;		// Header, filled in as for Network::Send
+    char data[MaxPacketSize];	// Payload
+    Packet *next;		// Next free packet, while in the pool
+};
+
+// The following class defines a pool of packet buffers, so that
+// sending and receiving a packet needs no memory allocation.
+// Incoming packets are read straight into buffers from the pool, and
+// handed up to the Post Office, which returns them when the message
+// has been read.  The last few buffers are kept for senders, so that
+// mail nobody has read yet can't stop us sending.
+
+class Semaphore;
+
+#define PacketPoolSize	64	// buffers in the pool
+#define PoolReserve	8	// of which incoming packets can't take these
+
+class PacketPool {
+  public:
+    PacketPool(int size);	// Allocate "size" packet buffers
+    ~PacketPool();
+
+    Packet *Alloc();		// Take a free buffer; wait if there is none
+    Packet *TryAlloc(int reserve);
+				// Take a free buffer only if more than
+				// "reserve" are free, else return NULL;
+				// for interrupt handlers
+    void Free(Packet *pkt);	// Give a buffer back
+
+  private:
+    Packet *packets;		// All the buffers
+    Packet *freeList;		// The free ones
+    int numFree;
+    int waiting;		// Threads waiting for a free buffer
+    Semaphore *freed;		// V'ed for each buffer freed while
+				// a thread is waiting
+};
+
+#define NetRingSize	16	// packets the network buffers, between
+				// polls, for the Post Office to pick up
+
 
 // The following class defines a physical network device.  The network
-// is capable of delivering fixed sized packets, in order but unreliably, 
-// to other machines connected to the network.
+// is capable of delivering packets of up to MaxWireSize bytes, in order
+// but unreliably, to other machines connected to the network.  Each
+// time the network is polled, it takes every packet waiting (up to
+// the room left in its ring) in one go.
 //
 // The "reliability" of the network can be specified to the constructor.
 // This number, between 0 and 1, is the chance that the network will lose 
@@ -59,26 +109,29 @@ class Network {
 				// Allocate and initialize network driver
     ~Network();			// De-allocate the network driver data
     
-    void Send(PacketHeader hdr, char* data);
-    				// Send the packet data to a remote machine,
-				// specified by "hdr".  Returns immediately.
-    				// "writeHandler" is invoked once the next 
-				// packet can be sent.  Note that writeHandler 
-				// is called whether or not the packet is 
-				// dropped, and note that the "from" field of 
-				// the PacketHeader is filled in automatically 
-				// by Send().
-
-    PacketHeader Receive(char* data);
-    				// Poll the network for incoming messages.  
-				// If there is a packet waiting, copy the 
-				// packet into "data" and return the header.
-				// If no packet is waiting, return a header 
-				// with length 0.
+    void Send(Packet *pkt);	// Send a packet to the remote machine
+				// named by its header.  Returns
+				// immediately.  "writeHandler" is invoked
+				// once the next packet can be sent (and
+				// "pkt" reused).  Note that writeHandler
+				// is called whether or not the packet is
+				// dropped, and note that the "from" field
+				// of the header is filled in automatically
+				// by Send().  Only the header and
+				// "hdr.length" bytes go on the wire.
+
+    Packet *Receive();		// Take the oldest packet that has
+				// arrived, or return NULL if there is
+				// none.  It belongs to the caller, who
+				// should give it back with FreePacket.
+
+    Packet *AllocPacket() { return pool->Alloc(); }
+    void FreePacket(Packet *pkt) { pool->Free(pkt); }
+				// Get and return a packet buffer
 
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
-    void CheckPktAvail();	// Check if there is an incoming packet
+    void CheckPktAvail();	// Read whatever packets have arrived
 
   private:
     NetworkAddress ident;	// This machine's network address
@@ -92,10 +145,9 @@ class Network {
     int handlerArg;		// Argument to be passed to interrupt handler
 				//   (pointer to post office)
     bool sendBusy;		// Packet is being sent.
-    bool packetAvail;		// Packet has arrived, can be pulled off of
-				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+    PacketPool *pool;		// Packet buffers
+    Packet *ring[NetRingSize];	// Packets that have arrived, in order,
+    int ringHead, ringCount;	//   for the Post Office to pick up
 };
 
 #endif // NETWORK_H
@@ -22,6 +22,9 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = 0;
+    numPacketBatches = 0;
+    numLockWaits = lockWaitTicks = maxLockWait = 0;
 }
 
 //----------------------------------------------------------------------
@@ -39,6 +42,11 @@ Statistics::Print()
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
-    printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
-	numPacketsSent);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %d, misses %d\n", numTLBHits, numTLBMisses);
+    printf("Network I/O: packets received %d (in %d batches), sent %d\n",
+	numPacketsRecvd, numPacketBatches, numPacketsSent);
+    if (numLockWaits > 0)
+	printf("RW locks: waits %d, ticks waited %d, longest write wait %d\n",
+	    numLockWaits, lockWaitTicks, maxLockWait);
 }
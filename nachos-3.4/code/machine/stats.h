@@ -33,8 +33,14 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numTLBHits;		// translations found in the TLB
+    int numTLBMisses;		// ... and not found there
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numPacketBatches;	// number of polls that received packets
+    int numLockWaits;		// times a thread waited for a RWLock
+    int lockWaitTicks;		// total time spent waiting for them
+    int maxLockWait;		// longest time a writer waited
 
     Statistics(); 		// initialize everything to zero
 
@@ -217,15 +217,60 @@ WriteFile(int fd, char *buffer, int nBytes)
 //----------------------------------------------------------------------
 // Lseek
 // 	Change the location within an open file.  Abort on error.
+//	The offset may be past 2GB (we compile with 64-bit file offsets).
 //----------------------------------------------------------------------
 
 void
-Lseek(int fd, int offset, int whence)
+Lseek(int fd, long long offset, int whence)
 {
-    int retVal = lseek(fd, offset, whence);
+    off_t retVal = lseek(fd, (off_t) offset, whence);
     ASSERT(retVal >= 0);
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "length" bytes of an open file into memory, so that
+//	reading/writing the memory reads/writes the file.  Return NULL if
+//	that can't be done (say, the file is too big for our address
+//	space); the caller can then fall back on Read and WriteFile.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, long long length)
+{
+    void *addr;
+
+    if ((long long) (size_t) length != length)
+        return NULL;
+    addr = mmap(NULL, (size_t) length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+    return (addr == MAP_FAILED) ? NULL : (char *) addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Wait until everything written to a mapped file is in the file.
+//	Abort on error.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *addr, long long length)
+{
+    int retVal = msync(addr, (size_t) length, MS_SYNC);
+    ASSERT(retVal == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.  Changes made through the memory are kept.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *addr, long long length)
+{
+    munmap(addr, (size_t) length);
+}
+
 //----------------------------------------------------------------------
 // Tell
 // 	Report the current location within an open file.
@@ -373,10 +418,62 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
     ASSERT(retVal == packetSize);
 }
 
+//----------------------------------------------------------------------
+// ReadFromSocketBatch
+// 	Read the packets waiting on the IPC port, up to "count" of them,
+//	each into its own buffer of "maxSize" bytes, without waiting.
+//	Return how many were read; "sizes" gets the length of each.
+//
+//	Where the host has recvmmsg, this is a single system call.
+//----------------------------------------------------------------------
+
+#define MaxSocketBatch 32
+
+int
+ReadFromSocketBatch(int sockID, char **buffers, int *sizes, int maxSize,
+			int count)
+{
+    int n;
+
+    ASSERT(count <= MaxSocketBatch);
+#ifdef MSG_WAITFORONE
+    struct mmsghdr msgs[MaxSocketBatch];
+    struct iovec iovs[MaxSocketBatch];
+
+    memset(msgs, 0, count * sizeof(struct mmsghdr));
+    for (n = 0; n < count; n++) {
+	iovs[n].iov_base = buffers[n];
+	iovs[n].iov_len = maxSize;
+	msgs[n].msg_hdr.msg_iov = &iovs[n];
+	msgs[n].msg_hdr.msg_iovlen = 1;
+    }
+    n = recvmmsg(sockID, msgs, count, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+	ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+	return 0;
+    }
+    for (int i = 0; i < n; i++)
+	sizes[i] = msgs[i].msg_len;
+#else
+    for (n = 0; n < count; n++) {
+	int retVal = recvfrom(sockID, buffers[n], maxSize, MSG_DONTWAIT,
+				NULL, NULL);
+
+	if (retVal < 0) {
+	    ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+	    break;
+	}
+	sizes[n] = retVal;
+    }
+#endif
+    return n;
+}
+
 //----------------------------------------------------------------------
 // SendToSocket
-// 	Transmit a fixed size packet to another Nachos' IPC port.
-//	Abort on error.
+// 	Transmit a packet to another Nachos' IPC port.  If that Nachos
+//	isn't running (yet, or any more), the packet is lost, as it would
+//	be on a real network.  Abort on any other error.
 //----------------------------------------------------------------------
 void
 SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
@@ -387,6 +484,8 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
     InitSocketName(&uName, toName);
     retVal = sendto(sockID, buffer, packetSize, 0,
 			   (sockaddr*) &uName, sizeof(uName));
+    if (retVal < 0 && (errno == ECONNREFUSED || errno == ENOENT))
+	return;
     ASSERT(retVal == packetSize);
 }
 
@@ -403,6 +502,19 @@ CallOnUserAbort(VoidNoArgFunctionPtr func)
     (void)signal(SIGINT, (VoidFunctionPtr) func);
 }
 
+//----------------------------------------------------------------------
+// CallOnUserSignal
+// 	Arrange that "func" will be called when Nachos is sent SIGUSR1
+//	(e.g., by "kill -USR1"), to ask it to report on itself.  "func"
+//	runs as a signal handler, so it should do no more than set a flag.
+//----------------------------------------------------------------------
+
+void
+CallOnUserSignal(VoidNoArgFunctionPtr func)
+{
+    (void)signal(SIGUSR1, (VoidFunctionPtr) func);
+}
+
 //----------------------------------------------------------------------
 // Sleep
 // 	Put the UNIX process running Nachos to sleep for x seconds,
@@ -438,6 +550,21 @@ Exit(int exitCode)
     exit(exitCode);
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the host's time of day, in microseconds, to measure how
+//	long things really take (as opposed to simulated time).
+//----------------------------------------------------------------------
+
+long long
+HostTime()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
 //----------------------------------------------------------------------
 // RandomInit
 // 	Initialize the pseudo-random number generator.  We use the
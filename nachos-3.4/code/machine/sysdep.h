@@ -24,11 +24,16 @@ extern int OpenForReadWrite(char *name, bool crashOnError);
 extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, char *buffer, int nBytes);
-extern void Lseek(int fd, int offset, int whence);
+extern void Lseek(int fd, long long offset, int whence);
 extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(char *name);
 
+// Map a whole file into memory, shared with the file; and undo that
+extern char *MapFile(int fd, long long length);
+extern void SyncMappedFile(char *addr, long long length);
+extern void UnmapFile(char *addr, long long length);
+
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
 extern void CloseSocket(int sockID);
@@ -36,6 +41,8 @@ extern void AssignNameToSocket(char *socketName, int sockID);
 extern void DeAssignNameToSocket(char *socketName);
 extern bool PollSocket(int sockID);
 extern void ReadFromSocket(int sockID, char *buffer, int packetSize);
+extern int ReadFromSocketBatch(int sockID, char **buffers, int *sizes,
+				int maxSize, int count);
 extern void SendToSocket(int sockID, char *buffer, int packetSize,char *toName);
 
 // Process control: abort, exit, and sleep
@@ -46,6 +53,12 @@ extern void Delay(int seconds);
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
+// Arrange for "func" to be called when Nachos is sent SIGUSR1
+extern void CallOnUserSignal(VoidNoArgFunctionPtr func);
+
+// Host time of day, in microseconds
+extern long long HostTime();
+
 // Initialize the pseudo random number generator
 extern void RandomInit(unsigned seed);
 extern int Random();
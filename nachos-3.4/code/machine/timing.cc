@@ -0,0 +1,485 @@
+// timing.cc
+//	Routines to charge user instructions for the time they would
+//	take on a pipelined MIPS, with caches.
+//
+//	Time is kept in simulated ticks: a value "ready" at tick T can be
+//	used by an instruction issued at T or later, and an instruction
+//	issued earlier waits (its thread is charged the difference).
+//	Since stalls go into stats->totalTicks, the kernel's time, and the
+//	other threads', passes for the pipeline and the write buffer too.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "timing.h"
+#include "machine.h"
+#include "mipsops.h"
+#include "system.h"
+
+// The cache, latencies, and write buffer, unless the spec says otherwise
+#define DefaultCacheSize	8192
+#define DefaultAssoc		2
+#define DefaultLineSize		32
+#define DefaultMemLatency	20
+#define DefaultMulLatency	12
+#define DefaultDivLatency	35
+#define DefaultLoadUse		1
+#define DefaultTLBPenalty	30
+#define DefaultWriteBuffer	4
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache.
+//
+//	"cacheName" -- printed with the statistics
+//	"bytes" -- bytes of data it holds
+//	"ways" -- lines in each set
+//	"lineBytes" -- bytes in each line
+//	"isWriteBack" -- if TRUE, writes stay in the cache (allocating a
+//		line on a miss) until the line is replaced; else they go
+//		to memory, and only update a line that is already cached
+//----------------------------------------------------------------------
+
+Cache::Cache(char *cacheName, int bytes, int ways, int lineBytes,
+	     bool isWriteBack)
+{
+    ASSERT(lineBytes >= 4 && (lineBytes & (lineBytes - 1)) == 0);
+    ASSERT(ways > 0 && bytes >= ways * lineBytes);
+    ASSERT(bytes % (ways * lineBytes) == 0);
+    name = cacheName;
+    size = bytes;
+    assoc = ways;
+    lineSize = lineBytes;
+    writeBack = isWriteBack;
+    numSets = size / (assoc * lineSize);
+    lines = new CacheLine[numSets * assoc];
+    for (int i = 0; i < numSets * assoc; i++) {
+	lines[i].valid = lines[i].dirty = FALSE;
+	lines[i].lastUse = 0;
+    }
+    useClock = 0;
+    missPenalty = 0;
+    hits = misses = writeBacks = 0;
+}
+
+Cache::~Cache()
+{
+    delete [] lines;
+}
+
+//----------------------------------------------------------------------
+// Cache::Lookup
+// 	Find the line holding "addr" for thread "asid", counting a hit or
+//	a miss.  On a miss, if "allocate", replace the least recently used
+//	line in its set with it, adding the time that takes to "cycles";
+//	otherwise return NULL.
+//----------------------------------------------------------------------
+
+CacheLine *
+Cache::Lookup(int asid, int addr, bool allocate, int *cycles)
+{
+    unsigned int tag = (unsigned int) addr / lineSize;
+    CacheLine *set = &lines[(tag % numSets) * assoc];
+    CacheLine *victim = &set[0];
+
+    useClock++;
+    for (int i = 0; i < assoc; i++) {
+	if (set[i].valid && set[i].tag == tag && set[i].asid == asid) {
+	    hits++;
+	    set[i].lastUse = useClock;
+	    return &set[i];
+	}
+	if (victim->valid && (!set[i].valid
+				|| set[i].lastUse < victim->lastUse))
+	    victim = &set[i];
+    }
+    misses++;
+    if (!allocate)
+	return NULL;
+
+    if (victim->valid && victim->dirty) {	// write it out first
+	writeBacks++;
+	*cycles += missPenalty;
+    }
+    *cycles += missPenalty;
+    victim->valid = TRUE;
+    victim->dirty = FALSE;
+    victim->asid = asid;
+    victim->tag = tag;
+    victim->lastUse = useClock;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// Cache::Read
+// 	Read "addr"; return how long the processor waits for it (0 on a
+//	hit).
+//----------------------------------------------------------------------
+
+int
+Cache::Read(int asid, int addr)
+{
+    int cycles = 0;
+
+    (void) Lookup(asid, addr, TRUE, &cycles);
+    return cycles;
+}
+
+//----------------------------------------------------------------------
+// Cache::Write
+// 	Write "addr"; return how long the processor waits for the cache
+//	(not counting, in a write-through cache, the write buffer).
+//----------------------------------------------------------------------
+
+int
+Cache::Write(int asid, int addr)
+{
+    int cycles = 0;
+    CacheLine *line = Lookup(asid, addr, writeBack, &cycles);
+
+    if (line != NULL && writeBack)
+	line->dirty = TRUE;
+    return cycles;
+}
+
+//----------------------------------------------------------------------
+// Cache::Print
+// 	Print the cache's configuration, hits and misses.
+//----------------------------------------------------------------------
+
+void
+Cache::Print()
+{
+    int accesses = hits + misses;
+
+    printf("%s: %d bytes, %d-way, %d-byte lines, write-%s: "
+	   "hits %d, misses %d (%.2f%%)", name, size, assoc, lineSize,
+	   writeBack ? "back" : "through", hits, misses,
+	   accesses ? 100.0 * misses / accesses : 0.0);
+    if (writeBack)
+	printf(", write-backs %d", writeBacks);
+    printf("\n");
+}
+
+//----------------------------------------------------------------------
+// ParseCache
+// 	Parse "size:assoc:lineSize[:wb|wt]" into "cacheSpec"; sizes may
+//	end in "k".  Return FALSE if it doesn't parse.
+//----------------------------------------------------------------------
+
+static bool
+ParseCache(char *value, int *cacheSpec)
+{
+    for (int i = 0; i < 3; i++) {
+	char *end = value;
+
+	for (cacheSpec[i] = 0; *end >= '0' && *end <= '9'; end++)
+	    cacheSpec[i] = cacheSpec[i] * 10 + (*end - '0');
+	if (cacheSpec[i] <= 0)
+	    return FALSE;
+	if (*end == 'k' || *end == 'K') {
+	    cacheSpec[i] *= 1024;
+	    end++;
+	}
+	if (*end == '\0')
+	    return i == 2;
+	if (*end != ':')
+	    return FALSE;
+	value = end + 1;
+    }
+    if (!strcmp(value, "wb"))
+	cacheSpec[3] = TRUE;
+    else if (!strcmp(value, "wt"))
+	cacheSpec[3] = FALSE;
+    else
+	return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// TimingModel::ParseSpec
+// 	Set the parameters given in "spec", a comma-separated list of
+//	"name=value".  The caches' are returned in "instSpec" and
+//	"dataSpec" (size, associativity, line size, write-back).
+//----------------------------------------------------------------------
+
+void
+TimingModel::ParseSpec(char *spec, int *instSpec, int *dataSpec)
+{
+    char *copy = new char[strlen(spec) + 1];
+    char *param;
+
+    strcpy(copy, spec);
+    for (param = strtok(copy, ","); param != NULL; param = strtok(NULL, ",")) {
+	char *value = strchr(param, '=');
+	bool ok = (value != NULL);
+
+	if (ok) {
+	    *value++ = '\0';
+	    if (!strcmp(param, "icache"))
+		ok = ParseCache(value, instSpec);
+	    else if (!strcmp(param, "dcache"))
+		ok = ParseCache(value, dataSpec);
+	    else if (!strcmp(param, "mem"))
+		memLatency = atoi(value);
+	    else if (!strcmp(param, "mul"))
+		mulLatency = atoi(value);
+	    else if (!strcmp(param, "div"))
+		divLatency = atoi(value);
+	    else if (!strcmp(param, "loaduse"))
+		loadUse = atoi(value);
+	    else if (!strcmp(param, "tlb"))
+		tlbPenalty = atoi(value);
+	    else if (!strcmp(param, "wbuf"))
+		bufferSize = atoi(value);
+	    else
+		ok = FALSE;
+	}
+	if (!ok) {
+	    printf("Bad timing parameter \"%s\"; expected icache=, dcache= "
+		   "(size:assoc:line[:wb|wt]), mem=, mul=, div=, loaduse=, "
+		   "tlb= or wbuf=\n", param);
+	    ASSERT(FALSE);
+	}
+    }
+    delete [] copy;
+}
+
+//----------------------------------------------------------------------
+// TimingModel::TimingModel
+// 	Set up the timing model, with the defaults changed as "spec"
+//	(which may be NULL) says.
+//----------------------------------------------------------------------
+
+TimingModel::TimingModel(char *spec)
+{
+    int instSpec[4] = { DefaultCacheSize, DefaultAssoc, DefaultLineSize,
+			TRUE };
+    int dataSpec[4] = { DefaultCacheSize, DefaultAssoc, DefaultLineSize,
+			TRUE };
+
+    memLatency = DefaultMemLatency;
+    mulLatency = DefaultMulLatency;
+    divLatency = DefaultDivLatency;
+    loadUse = DefaultLoadUse;
+    tlbPenalty = DefaultTLBPenalty;
+    bufferSize = DefaultWriteBuffer;
+    if (spec != NULL)
+	ParseSpec(spec, instSpec, dataSpec);
+    ASSERT(bufferSize > 0 && bufferSize <= MaxWriteBuffer);
+
+    icache = new Cache("I-cache", instSpec[0], instSpec[1], instSpec[2],
+		       instSpec[3]);
+    dcache = new Cache("D-cache", dataSpec[0], dataSpec[1], dataSpec[2],
+		       dataSpec[3]);
+    icache->missPenalty = memLatency + instSpec[2] / 4;	// a word a cycle
+    dcache->missPenalty = memLatency + dataSpec[2] / 4;
+
+    for (int i = 0; i < TimingRegs; i++)
+	regReady[i] = 0;
+    delayReg = 0;
+    bufferHead = bufferCount = 0;
+    cacheStalls = bufferStalls = loadStalls = mulDivStalls = tlbStalls = 0;
+}
+
+//----------------------------------------------------------------------
+// TimingModel::~TimingModel
+// 	Print where the stalls came from, and the caches' hits and misses.
+//----------------------------------------------------------------------
+
+TimingModel::~TimingModel()
+{
+    printf("Timing: stall ticks: cache %d, write buffer %d, load-use %d, "
+	   "multiply/divide %d, TLB %d\n", cacheStalls, bufferStalls,
+	   loadStalls, mulDivStalls, tlbStalls);
+    icache->Print();
+    dcache->Print();
+    delete icache;
+    delete dcache;
+}
+
+//----------------------------------------------------------------------
+// TimingModel::Stall
+// 	Hold up the running user program for "cycles" ticks.
+//----------------------------------------------------------------------
+
+void
+TimingModel::Stall(int cycles)
+{
+    if (cycles <= 0)
+	return;
+    stats->totalTicks += cycles;
+    stats->userTicks += cycles;
+    metrics->ForCurrentThread()->userTicks += cycles;
+}
+
+//----------------------------------------------------------------------
+// TimingModel::WriteToMemory
+// 	Put a write in the write buffer, first waiting for the oldest
+//	one to finish if the buffer is full.  The writes go to memory one
+//	at a time.  Return how long the processor waited.
+//----------------------------------------------------------------------
+
+int
+TimingModel::WriteToMemory()
+{
+    int now = stats->totalTicks;
+    int wait = 0, start;
+
+    while (bufferCount > 0 && buffer[bufferHead] <= now) {
+	bufferHead = (bufferHead + 1) % MaxWriteBuffer;
+	bufferCount--;
+    }
+    if (bufferCount == bufferSize) {
+	wait = buffer[bufferHead] - now;
+	bufferHead = (bufferHead + 1) % MaxWriteBuffer;
+	bufferCount--;
+    }
+    start = now + wait;
+    if (bufferCount > 0) {
+	int last = buffer[(bufferHead + bufferCount - 1) % MaxWriteBuffer];
+
+	if (last > start)
+	    start = last;
+    }
+    buffer[(bufferHead + bufferCount) % MaxWriteBuffer] = start + memLatency;
+    bufferCount++;
+    return wait;
+}
+
+//----------------------------------------------------------------------
+// SourceRegs
+// 	Put the registers "instr" reads (TimingHiLo for HI or LO) in
+//	"regs", and return how many there are.
+//----------------------------------------------------------------------
+
+static int
+SourceRegs(Instruction *instr, int *regs)
+{
+    switch (instr->opCode) {
+      case OP_MULT: case OP_MULTU: case OP_DIV: case OP_DIVU:
+	regs[2] = TimingHiLo;			// the last one must be done
+	regs[0] = instr->rs;
+	regs[1] = instr->rt;
+	return 3;
+
+      case OP_ADD: case OP_ADDU: case OP_AND: case OP_NOR: case OP_OR:
+      case OP_SLT: case OP_SLTU: case OP_SUB: case OP_SUBU: case OP_XOR:
+      case OP_SLLV: case OP_SRAV: case OP_SRLV: case OP_BEQ: case OP_BNE:
+      case OP_LWL: case OP_LWR:
+      case OP_SB: case OP_SH: case OP_SW: case OP_SWL: case OP_SWR:
+	regs[0] = instr->rs;
+	regs[1] = instr->rt;
+	return 2;
+
+      case OP_SLL: case OP_SRA: case OP_SRL:
+	regs[0] = instr->rt;
+	return 1;
+
+      case OP_MFHI: case OP_MFLO:
+	regs[0] = TimingHiLo;
+	return 1;
+
+      case OP_ADDI: case OP_ADDIU: case OP_ANDI: case OP_ORI: case OP_XORI:
+      case OP_SLTI: case OP_SLTIU:
+      case OP_LB: case OP_LBU: case OP_LH: case OP_LHU: case OP_LW:
+      case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ: case OP_BLEZ:
+      case OP_BLTZ: case OP_BLTZAL:
+      case OP_JR: case OP_JALR: case OP_MTHI: case OP_MTLO:
+	regs[0] = instr->rs;
+	return 1;
+
+      default:					// J, JAL, LUI
+	return 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// TimingModel::Execute
+// 	Charge the running thread for what "instr" waited for: being
+//	fetched, its operands, and its load or store.  Then note when its
+//	results will be ready, if that isn't right away.
+//
+//	As on MIPS I, the instruction in a load's delay slot doesn't wait
+//	for the loaded register: it reads the value from before the load.
+//
+//	"pc" -- where "instr" is
+//	"memAddr" -- the (virtual) address it read or wrote, if it is a
+//		load or store
+//----------------------------------------------------------------------
+
+void
+TimingModel::Execute(Instruction *instr, int pc, int memAddr)
+{
+    int asid = currentThread->get_threadID();
+    int regs[3];
+    int numRegs, stall;
+    int delayed = delayReg;		// we are in its load delay slot
+
+    delayReg = 0;
+
+    stall = icache->Read(asid, pc);
+    cacheStalls += stall;
+    Stall(stall);
+
+    numRegs = SourceRegs(instr, regs);
+    for (int i = 0; i < numRegs; i++) {
+	stall = regReady[regs[i]] - stats->totalTicks;
+	if (regs[i] == 0 || regs[i] == delayed || stall <= 0)
+	    continue;			// ready, or the old value is used
+	if (regs[i] == TimingHiLo)
+	    mulDivStalls += stall;
+	else
+	    loadStalls += stall;
+	Stall(stall);
+    }
+
+    switch (instr->opCode) {
+      case OP_LB: case OP_LBU: case OP_LH: case OP_LHU: case OP_LW:
+      case OP_LWL: case OP_LWR:
+	stall = dcache->Read(asid, memAddr);
+	cacheStalls += stall;
+	Stall(stall);
+	// usable after the delay slot, and "loadUse" more
+	regReady[(int) instr->rt] = stats->totalTicks + 2 + loadUse;
+	delayReg = instr->rt;
+	break;
+
+      case OP_SB: case OP_SH: case OP_SW: case OP_SWL: case OP_SWR:
+	stall = dcache->Write(asid, memAddr);
+	cacheStalls += stall;
+	Stall(stall);
+	if (!dcache->WritesBack()) {
+	    stall = WriteToMemory();
+	    bufferStalls += stall;
+	    Stall(stall);
+	}
+	break;
+
+      case OP_MULT: case OP_MULTU:
+	regReady[TimingHiLo] = stats->totalTicks + mulLatency;
+	break;
+
+      case OP_DIV: case OP_DIVU:
+	regReady[TimingHiLo] = stats->totalTicks + divLatency;
+	break;
+    }
+}
+
+//----------------------------------------------------------------------
+// TimingModel::TLBMiss
+// 	Charge the running user program for a TLB miss: the trap, and
+//	the refill.  Misses while the kernel copies to or from user memory
+//	are the kernel's time, and aren't charged.
+//----------------------------------------------------------------------
+
+void
+TimingModel::TLBMiss()
+{
+    if (interrupt->getStatus() != UserMode)
+	return;
+    tlbStalls += tlbPenalty;
+    Stall(tlbPenalty);
+}
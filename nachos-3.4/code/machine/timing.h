@@ -0,0 +1,137 @@
+// timing.h
+//	Data structures for an (optional) timing model of the simulated
+//	MIPS processor.
+//
+//	Without it, every user instruction takes one UserTick.  With it,
+//	an instruction also waits for:
+//
+//	  the instruction cache, and the data cache, on a miss -- the
+//		line is fetched from memory (and a dirty line written back,
+//		first, with a write-back cache);
+//	  the write buffer, when a write-through cache has more stores
+//		outstanding than the buffer holds;
+//	  a value being loaded, if it is used too soon after the load;
+//	  the result of a multiply or divide, if HI or LO is read (or
+//		another multiply or divide started) before it is done;
+//	  the kernel to refill the TLB, on a TLB miss.
+//
+//	The stall cycles are added to the user ticks of the running
+//	thread, and to the simulated time, and the hits and misses of each
+//	cache are printed when Nachos halts.
+//
+//	The caches are looked up by virtual address, and each line is
+//	tagged with the thread that brought it in (so threads can't hit on
+//	one another's lines).  There is no branch penalty, since MIPS
+//	branches have a delay slot.
+//
+//	The model is turned on with "-timing [spec]", where "spec" lists
+//	the parameters to change from their defaults, e.g.
+//
+//		-timing icache=16k:2:32,dcache=8k:4:16:wt,mem=40,tlb=50
+//
+//	"icache" and "dcache" are "size:associativity:line size[:policy]",
+//	the policy being "wb" (write-back, allocating on a write miss) or
+//	"wt" (write-through, through a write buffer, not allocating).  The
+//	other parameters are in cycles, except "wbuf", the entries in the
+//	write buffer.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define MaxWriteBuffer		16	// entries a write buffer can have
+#define TimingRegs		33	// the GPRs, and HI/LO (as one)
+#define TimingHiLo		32
+
+class Instruction;
+
+// The following class defines one line of a cache.
+
+class CacheLine {
+  public:
+    bool valid;
+    bool dirty;			// Written since it was fetched
+    int asid;			// The thread it belongs to
+    unsigned int tag;		// Line address (virtual)
+    int lastUse;		// When it was last touched, for LRU
+};
+
+// The following class defines a set-associative cache, with LRU
+// replacement.
+
+class Cache {
+  public:
+    Cache(char *cacheName, int bytes, int ways, int lineBytes,
+	  bool isWriteBack);
+    ~Cache();
+
+    int Read(int asid, int addr);	// Look up "addr"; return the
+					// cycles it took beyond a hit
+    int Write(int asid, int addr);	// ... and write to it
+    bool WritesBack() { return writeBack; }
+    void Print();			// Print the hits and misses
+
+    int missPenalty;		// Cycles to fetch a line from memory
+
+  private:
+    char *name;
+    int size, assoc, lineSize;
+    bool writeBack;		// Else write-through, no write-allocate
+    int numSets;
+    CacheLine *lines;		// numSets sets of "assoc" lines
+    int useClock;		// Bumped on each access, for LRU
+
+    int hits, misses;
+    int writeBacks;		// Dirty lines written back to memory
+
+    CacheLine *Lookup(int asid, int addr, bool allocate, int *cycles);
+};
+
+// The following class defines the timing model.
+
+class TimingModel {
+  public:
+    TimingModel(char *spec);	// Set up the caches and latencies;
+				// "spec" may be NULL, for the defaults
+    ~TimingModel();		// Print the cache statistics
+
+    void Execute(Instruction *instr, int pc, int memAddr);
+				// Charge the stalls for an instruction,
+				// at "pc", that has just been executed,
+				// and that accessed "memAddr" if it is a
+				// load or store
+    void TLBMiss();		// Charge for refilling the TLB
+
+  private:
+    Cache *icache, *dcache;
+    int memLatency;		// Cycles for a memory access
+    int mulLatency;		// ... for a multiply to finish
+    int divLatency;		// ... for a divide
+    int loadUse;		// ... beyond the load delay slot, before
+				// a loaded value can be used
+    int tlbPenalty;		// ... for the kernel to refill the TLB
+    int bufferSize;		// Entries in the write buffer
+
+    int regReady[TimingRegs];	// Tick each register's value is ready
+    int delayReg;		// Register loaded by the last instruction;
+				// the one in its delay slot sees the old
+				// value, without waiting.  0 if none
+    int buffer[MaxWriteBuffer];	// When each buffered write is done,
+    int bufferHead, bufferCount;	// ... as a circular queue
+
+    int cacheStalls, bufferStalls, loadStalls, mulDivStalls, tlbStalls;
+
+    void ParseSpec(char *spec, int *instSpec, int *dataSpec);
+    int WriteToMemory();	// Queue a word for writing to memory;
+				// return the cycles spent waiting for
+				// room in the write buffer
+    void Stall(int cycles);	// Add "cycles" to the running thread's time
+};
+
+#endif // TIMING_H
@@ -263,13 +263,15 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	    	}
 	    }
 		if (entry == NULL) {				// not found
-				(machine->tlb_miss_time)++;
+				stats->numTLBMisses++;
+				if (timing != NULL)
+				    timing->TLBMiss();
 	    	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
 	    	    return PageFaultException;		// really, this is a TLB fault,
 							// the page may be in memory,
 							// but not in the TLB
 		}
-		(machine->tlb_hit_time)++;
+		stats->numTLBHits++;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
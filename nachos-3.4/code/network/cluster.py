@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+# cluster.py
+#	Start a cluster of Nachos machines on this host, run one of the
+#	network benchmarks in nettest.cc (NetBench) on all of them, and
+#	print the results, one JSON object per run.
+#
+#	Each machine is "nachos -m <id> -l <reliability> -nb ...", run in
+#	a directory of its own (so each has its own DISK), which holds
+#	symbolic links to the other machines' SOCKET_<id> files.
+#
+#	Sweeps are given as comma-separated lists, and every combination
+#	is run; for example
+#
+#		./cluster.py --modes pingpong,stream --nodes 2,4 \
+#			--sizes 16,256 --count 100 --reliability 1,0.9
+#
+#	A run that doesn't finish within --timeout seconds is killed and
+#	reported with "ok": false.
+#
+# Copyright (c) 1992-1993 The Regents of the University of California.
+# All rights reserved.  See copyright.h for copyright notice and limitation
+# of liability and disclaimer of warranty provisions.
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+MaxNodes = 9		# the Post Office has 10 mailboxes (cf. NetBench)
+
+
+def parse_bench_line(line):
+    """Turn "bench key=value ..." into a dict; numbers become ints."""
+    result = {}
+    for field in line.split()[1:]:
+        key, value = field.split("=", 1)
+        result[key] = int(value) if value.lstrip("-").isdigit() else value
+    return result
+
+
+def run_cluster(nachos, mode, nodes, size, count, reliability, timeout):
+    """Run one benchmark on "nodes" machines; return its results."""
+    top = tempfile.mkdtemp(prefix="nachos-cluster-")
+    procs = []
+    try:
+        for me in range(nodes):
+            os.mkdir(os.path.join(top, "node%d" % me))
+        for me in range(nodes):
+            for peer in range(nodes):
+                if peer != me:
+                    os.symlink(os.path.join(top, "node%d" % peer,
+                                            "SOCKET_%d" % peer),
+                               os.path.join(top, "node%d" % me,
+                                            "SOCKET_%d" % peer))
+
+        start = time.time()
+        for me in range(nodes):
+            cmd = [nachos, "-m", str(me), "-l", str(reliability),
+                   "-nb", mode, str(nodes), str(size), str(count)]
+            procs.append(subprocess.Popen(
+                cmd, cwd=os.path.join(top, "node%d" % me),
+                stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                universal_newlines=True))
+
+        ok = True
+        outputs = []
+        deadline = start + timeout
+        for p in procs:
+            try:
+                out, _ = p.communicate(timeout=max(0, deadline - time.time()))
+            except subprocess.TimeoutExpired:
+                ok = False
+                p.kill()
+                out, _ = p.communicate()
+            outputs.append(out)
+        wall = time.time() - start
+
+        per_node = []
+        for me, out in enumerate(outputs):
+            lines = [l for l in out.splitlines() if l.startswith("bench ")]
+            if lines:
+                per_node.append(parse_bench_line(lines[-1]))
+            else:
+                ok = False
+                per_node.append({"node": me, "output": out[-500:]})
+
+        run = {"mode": mode, "nodes": nodes, "size": size, "count": count,
+               "reliability": reliability, "ok": ok,
+               "wall_seconds": round(wall, 3), "per_node": per_node}
+        if ok:
+            ticks = max(n["ticks"] for n in per_node)
+            received = sum(n["bytes"] for n in per_node)
+            run["ticks"] = ticks
+            run["bytes"] = received
+            run["bytes_per_kilotick"] = round(1000.0 * received / ticks, 3) \
+                if ticks > 0 else None
+            if mode == "pingpong":
+                run["ticks_per_round_trip"] = per_node[0]["ticks"] // count
+        return run
+    finally:
+        for p in procs:
+            if p.poll() is None:
+                p.kill()
+        shutil.rmtree(top, ignore_errors=True)
+
+
+def int_list(s):
+    return [int(x) for x in s.split(",")]
+
+
+def float_list(s):
+    return [float(x) for x in s.split(",")]
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description="Run Nachos network benchmarks on a local cluster.")
+    parser.add_argument("--nachos", default=os.path.join(here, "nachos"),
+                        help="Nachos binary, built with -DNETWORK")
+    parser.add_argument("--modes", default="pingpong,stream,alltoall",
+                        help="pingpong, stream and/or alltoall")
+    parser.add_argument("--nodes", type=int_list, default=[2],
+                        help="cluster sizes, 2 to %d" % MaxNodes)
+    parser.add_argument("--sizes", type=int_list, default=[64],
+                        help="bytes per message")
+    parser.add_argument("--count", type=int_list, default=[100],
+                        help="messages per sender")
+    parser.add_argument("--reliability", type=float_list, default=[1.0],
+                        help="chance that a packet gets through (-l)")
+    parser.add_argument("--timeout", type=float, default=120,
+                        help="seconds before a run is given up")
+    parser.add_argument("--output", default="-",
+                        help="file for the results (default: stdout)")
+    args = parser.parse_args()
+
+    for n in args.nodes:
+        if not 2 <= n <= MaxNodes:
+            parser.error("--nodes must be between 2 and %d" % MaxNodes)
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    failed = 0
+    for mode in args.modes.split(","):
+        for nodes in args.nodes:
+            for size in args.sizes:
+                for count in args.count:
+                    for reliability in args.reliability:
+                        run = run_cluster(os.path.abspath(args.nachos), mode,
+                                          nodes, size, count, reliability,
+                                          args.timeout)
+                        failed += not run["ok"]
+                        out.write(json.dumps(run) + "\n")
+                        out.flush()
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -21,6 +21,7 @@
 #include "system.h"
 #include "network.h"
 #include "post.h"
+#include "transport.h"
 #include "interrupt.h"
 
 // Test out message delivery, by doing the following:
@@ -70,3 +71,201 @@ MailTest(int farAddr)
     // Then we're done!
     interrupt->Halt();
 }
+
+// Test out reliable streams, by doing the following:
+//	1. open a stream to the machine with ID "farAddr", from our mail
+//	    box #2 to its mail box #2
+//	2. fork a thread to read the other machine's bytes until end of
+//	    stream, checking that they all arrive, in order
+//	3. meanwhile, send StreamTestSize bytes, many segments' worth, and
+//	    close our direction of the stream
+//
+// Run with a lossy network (e.g. -l 0.7) to exercise retransmission.
+
+#define StreamTestSize	4000
+
+static Stream *testStream;
+static Semaphore *readerDone;
+
+static void
+StreamReader(int farAddr)
+{
+    char buffer[100];
+    int i, n, total = 0;
+
+    while ((n = testStream->Receive(buffer, sizeof(buffer))) > 0) {
+	for (i = 0; i < n; i++)
+	    ASSERT(buffer[i] == 'a' + (total + i) % 26);
+	total += n;
+    }
+    ASSERT(total == StreamTestSize);
+    printf("Got %d bytes from %d\n", total, farAddr);
+    fflush(stdout);
+    readerDone->V();
+}
+
+void
+StreamTest(int farAddr)
+{
+    char buffer[StreamTestSize];
+
+    testStream = new Stream(2, farAddr, 2);
+    readerDone = new Semaphore("stream reader done", 0);
+    (new Thread("stream reader"))->Fork(StreamReader, farAddr);
+
+    for (int i = 0; i < StreamTestSize; i++)
+	buffer[i] = 'a' + i % 26;
+    testStream->Send(buffer, StreamTestSize);
+    testStream->Close();
+    printf("Sent %d bytes to %d\n", StreamTestSize, farAddr);
+    fflush(stdout);
+
+    readerDone->P();
+    testStream->PrintStats();
+    interrupt->Halt();
+}
+
+// Network benchmarks, run on "numNodes" copies of Nachos at once, with
+// machine IDs 0 .. numNodes-1 (network/cluster.py starts them, and
+// collects the results).  All traffic goes over streams, so a
+// benchmark finishes however unreliable the network is:
+//
+//	pingpong -- node 0 sends "size" bytes to node 1, which sends
+//	    them back, "count" times (round trip latency)
+//	stream -- every other node sends "count" lots of "size" bytes to
+//	    node 0 at once (throughput, with numNodes-1 senders)
+//	alltoall -- every node sends "count" lots of "size" bytes to
+//	    every other node at once
+//
+// The stream between nodes i and j uses mailbox BenchFirstBox+j on
+// node i, so the Post Office's 10 mailboxes allow up to 9 nodes.
+//
+// Each node prints one line, "bench key=value ...", for the launcher
+// to parse: "bytes" is what the node received, "ticks" is simulated
+// time from start to finish.
+
+#define BenchFirstBox	1
+#define LingerTime	(10 * RetransmitTime)
+
+static int benchSize;
+static Stream *benchStreams[10];
+static int sendCount[10], recvCount[10];	// lots of benchSize bytes, by peer
+static Semaphore *benchDone;
+
+// Read exactly "numBytes" bytes from "s"
+static void
+ReadFully(Stream *s, char *into, int numBytes)
+{
+    while (numBytes > 0) {
+	int n = s->Receive(into, numBytes);
+
+	ASSERT(n > 0);
+	into += n;
+	numBytes -= n;
+    }
+}
+
+// Forked to drain the stream from node "peer" to its end
+static void
+BenchReader(int peer)
+{
+    char *buffer = new char[benchSize];
+    int total = 0, n;
+
+    while ((n = benchStreams[peer]->Receive(buffer, benchSize)) > 0)
+	total += n;
+    ASSERT(total == benchSize * recvCount[peer]);
+    delete [] buffer;
+    benchDone->V();
+}
+
+// Forked to send node "peer" its share, and close our direction
+static void
+BenchWriter(int peer)
+{
+    char *buffer = new char[benchSize];
+
+    for (int i = 0; i < benchSize; i++)
+	buffer[i] = i;
+    for (int i = 0; i < sendCount[peer]; i++)
+	benchStreams[peer]->Send(buffer, benchSize);
+    benchStreams[peer]->Close();
+    delete [] buffer;
+    benchDone->V();
+}
+
+// Timer interrupt, to end the linger period
+static void
+BenchWakeUp(int arg)
+{
+    ((Semaphore *) arg)->V();
+}
+
+void
+NetBench(char *mode, int numNodes, int size, int count)
+{
+    NetworkAddress me = postOffice->Address();
+    int peer, numDone = 0, bytes = 0, start;
+
+    ASSERT(0 <= me && me < numNodes && numNodes >= 2
+		&& BenchFirstBox + numNodes <= 10 && size > 0 && count > 0);
+    benchSize = size;
+    benchDone = new Semaphore("bench done", 0);
+    for (peer = 0; peer < numNodes; peer++)
+	if (peer != me)
+	    benchStreams[peer] = new Stream(BenchFirstBox + peer, peer,
+						BenchFirstBox + me);
+
+    start = stats->totalTicks;
+    if (!strcmp(mode, "pingpong")) {
+	if (me <= 1) {
+	    Stream *s = benchStreams[1 - me];
+	    char *buffer = new char[size];
+
+	    for (int i = 0; i < count; i++) {
+		if (me == 0) {
+		    s->Send(buffer, size);
+		    ReadFully(s, buffer, size);
+		} else {
+		    ReadFully(s, buffer, size);
+		    s->Send(buffer, size);
+		}
+	    }
+	    s->Close();
+	    ASSERT(s->Receive(buffer, size) == 0);
+	    bytes = size * count;
+	    delete [] buffer;
+	}
+    } else {
+	for (peer = 0; peer < numNodes; peer++) {
+	    if (peer == me)
+		continue;
+	    if (!strcmp(mode, "stream")) {
+		sendCount[peer] = (me == 0) ? 0 : count;
+		recvCount[peer] = (peer == 0) ? 0 : count;
+	    } else {
+		ASSERT(!strcmp(mode, "alltoall"));
+		sendCount[peer] = recvCount[peer] = count;
+	    }
+	    bytes += size * recvCount[peer];
+	    (new Thread("bench reader"))->Fork(BenchReader, peer);
+	    (new Thread("bench writer"))->Fork(BenchWriter, peer);
+	    numDone += 2;
+	}
+    }
+    for (int i = 0; i < numDone; i++)
+	benchDone->P();
+
+    printf("bench mode=%s node=%d nodes=%d size=%d count=%d bytes=%d "
+	   "ticks=%d packets_sent=%d packets_recvd=%d batches=%d\n",
+	   mode, me, numNodes, size, count, bytes, stats->totalTicks - start,
+	   stats->numPacketsSent, stats->numPacketsRecvd,
+	   stats->numPacketBatches);
+    fflush(stdout);
+
+    // stay up a while, to acknowledge the other nodes' end of stream
+    // again if our ACK was lost
+    interrupt->Schedule(BenchWakeUp, (int) benchDone, LingerTime, TimerInt);
+    benchDone->P();
+    interrupt->Halt();
+}
@@ -7,7 +7,8 @@
 //
 //	Note that once we prepend the MailHdr to the outgoing message data,
 //	the combination (MailHdr plus data) looks like "data" to the Network 
-//	device.
+//	device.  Messages are built, delivered and queued in the Network's
+//	packet buffers, so they are only copied to and from the caller.
 //
 // 	The implementation synchronizes incoming messages with threads
 //	waiting for those messages.
@@ -18,28 +19,10 @@
 
 #include "copyright.h"
 #include "post.h"
+#include "system.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
-//----------------------------------------------------------------------
-// Mail::Mail
-//      Initialize a single mail message, by concatenating the headers to
-//	the data.
-//
-//	"pktH" -- source, destination machine ID's
-//	"mailH" -- source, destination mailbox ID's
-//	"data" -- payload data
-//----------------------------------------------------------------------
-
-Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
-{
-    ASSERT(mailH.length <= MaxMailSize);
-
-    pktHdr = pktH;
-    mailHdr = mailH;
-    bcopy(msgData, data, mailHdr.length);
-}
-
 //----------------------------------------------------------------------
 // MailBox::MailBox
 //      Initialize a single mail box within the post office, so that it
@@ -51,7 +34,7 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    messages = new List(); 
 }
 
 //----------------------------------------------------------------------
@@ -85,70 +68,52 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 
 //----------------------------------------------------------------------
 // MailBox::Put
-// 	Add a message to the mailbox.  If anyone is waiting for message
-//	arrival, wake them up!
+// 	Add a message to the end of the mailbox.  The message stays in
+//	the packet buffer it arrived in, which is queued as is.
 //
-//	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	Called with interrupts off; waking up anyone waiting for the
+//	message is up to the PostOffice.
 //
-//	"pktHdr" -- source, destination machine ID's
-//	"mailHdr" -- source, destination mailbox ID's
-//	"data" -- payload message data
+//	"pkt" -- the message, with its headers
 //----------------------------------------------------------------------
 
 void 
-MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
+MailBox::Put(Packet *pkt)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
-
-    messages->Append((void *)mail);	// put on the end of the list of 
-					// arrived messages, and wake up 
-					// any waiters
+    ASSERT(interrupt->getLevel() == IntOff);
+    messages->Append((void *)pkt);
 }
 
 //----------------------------------------------------------------------
 // MailBox::Get
-// 	Get a message from a mailbox, parsing it into the packet header,
-//	mailbox header, and data. 
+// 	Get the oldest message from a mailbox, still in its packet buffer,
+//	which now belongs to the caller.  Return NULL if the mailbox is
+//	empty.
 //
-//	The calling thread waits if there are no messages in the mailbox.
-//
-//	"pktHdr" -- address to put: source, destination machine ID's
-//	"mailHdr" -- address to put: source, destination mailbox ID's
-//	"data" -- address to put: payload message data
+//	Called with interrupts off.
 //----------------------------------------------------------------------
 
-void 
-MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
+Packet *
+MailBox::Get() 
 { 
-    DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
-						// will wait if list is empty
+    ASSERT(interrupt->getLevel() == IntOff);
+    Packet *pkt = (Packet *) messages->Remove();
 
-    *pktHdr = mail->pktHdr;
-    *mailHdr = mail->mailHdr;
-    if (DebugIsEnabled('n')) {
+    if (pkt != NULL && DebugIsEnabled('n')) {
 	printf("Got mail from mailbox: ");
-	PrintHeader(*pktHdr, *mailHdr);
+	PrintHeader(pkt->hdr, *(MailHeader *) pkt->data);
     }
-    bcopy(mail->data, data, mail->mailHdr.length);
-					// copy the message data into
-					// the caller's buffer
-    delete mail;			// we've copied out the stuff we
-					// need, we can now discard the message
+    return pkt;
 }
 
 //----------------------------------------------------------------------
-// PostalHelper, ReadAvail, WriteDone
+// ReadAvail, WriteDone
 // 	Dummy functions because C++ can't indirectly invoke member functions
-//	The first is forked as part of the "postal worker thread; the
-//	later two are called by the network interrupt handler.
+//	They are called by the network interrupt handler.
 //
 //	"arg" -- pointer to the Post Office managing the Network
 //----------------------------------------------------------------------
 
-static void PostalHelper(int arg)
-{ PostOffice* po = (PostOffice *) arg; po->PostalDelivery(); }
 static void ReadAvail(int arg)
 { PostOffice* po = (PostOffice *) arg; po->IncomingPacket(); }
 static void WriteDone(int arg)
@@ -160,10 +125,9 @@ static void WriteDone(int arg)
 //	Also initialize the network device, to allow post offices
 //	on different machines to deliver messages to one another.
 //
-//      We use a separate thread "the postal worker" to wait for messages 
-//	to arrive, and deliver them to the correct mailbox.  Note that
-//	delivering messages to the mailboxes can't be done directly
-//	by the interrupt handlers, because it requires a Lock.
+//      Messages are delivered to the correct mailbox by the network
+//	interrupt handler, as soon as they arrive.  That is why mailboxes
+//	are protected by turning interrupts off, rather than by a Lock.
 //
 //	"addr" is this machine's network ID 
 //	"reliability" is the probability that a network packet will
@@ -176,7 +140,6 @@ static void WriteDone(int arg)
 PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 {
 // First, initialize the synchronization with the interrupt handlers
-    messageAvailable = new Semaphore("message available", 0);
     messageSent = new Semaphore("message sent", 0);
     sendLock = new Lock("message send lock");
 
@@ -184,16 +147,11 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
     netAddr = addr; 
     numBoxes = nBoxes;
     boxes = new MailBox[nBoxes];
+    waiters = new List();
+    stillWaiting = new List();
 
 // Third, initialize the network; tell it which interrupt handlers to call
     network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this);
-
-
-// Finally, create a thread whose sole job is to wait for incoming messages,
-//   and put them in the right mailbox. 
-    Thread *t = new Thread("postal worker");
-
-    t->Fork(PostalHelper, (int) this);
 }
 
 //----------------------------------------------------------------------
@@ -205,44 +163,90 @@ PostOffice::~PostOffice()
 {
     delete network;
     delete [] boxes;
-    delete messageAvailable;
+    delete waiters;
+    delete stillWaiting;
     delete messageSent;
     delete sendLock;
 }
 
 //----------------------------------------------------------------------
-// PostOffice::PostalDelivery
-// 	Wait for incoming messages, and put them in the right mailbox.
+// PostOffice::Deliver
+// 	Put an incoming message in the right mailbox, and wake up anyone
+//	waiting for it.  Called by the network interrupt handler.
 //
-//      Incoming messages have had the PacketHeader stripped off,
-//	but the MailHeader is still tacked on the front of the data.
+//      Incoming messages are packets from the Network: the PacketHeader,
+//	then the MailHeader tacked on the front of the data.  The packet
+//	itself goes into the mailbox.
 //----------------------------------------------------------------------
 
 void
-PostOffice::PostalDelivery()
+PostOffice::Deliver(Packet *pkt)
 {
-    PacketHeader pktHdr;
-    MailHeader mailHdr;
-    char *buffer = new char[MaxPacketSize];
+    MailHeader *mailHdr = (MailHeader *) pkt->data;
 
-    for (;;) {
-        // first, wait for a message
-        messageAvailable->P();	
-        pktHdr = network->Receive(buffer);
-
-        mailHdr = *(MailHeader *)buffer;
-        if (DebugIsEnabled('n')) {
-	    printf("Putting mail into mailbox: ");
-	    PrintHeader(pktHdr, mailHdr);
-        }
-
-	// check that arriving message is legal!
-	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
-	ASSERT(mailHdr.length <= MaxMailSize);
-
-	// put into mailbox
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+    if (DebugIsEnabled('n')) {
+	printf("Putting mail into mailbox: ");
+	PrintHeader(pkt->hdr, *mailHdr);
     }
+
+    // check that arriving message is legal!
+    ASSERT(0 <= mailHdr->to && mailHdr->to < numBoxes);
+    ASSERT(mailHdr->length <= MaxMailSize);
+    ASSERT(pkt->hdr.length == mailHdr->length + sizeof(MailHeader));
+
+    // put into mailbox
+    boxes[mailHdr->to].Put(pkt);
+    WakeUp(mailHdr->to);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::Wait
+// 	Put the current thread to sleep until mail arrives in one of the
+//	"n" mailboxes in "boxList".  Called with interrupts off; the
+//	caller should check the mailboxes again once it wakes up, as
+//	someone else may have got the mail first.
+//----------------------------------------------------------------------
+
+void
+PostOffice::Wait(int n, int *boxList)
+{
+    MailWaiter waiter;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    waiter.thread = currentThread;
+    waiter.boxes = boxList;
+    waiter.numBoxes = n;
+    waiters->Append((void *) &waiter);
+    currentThread->Sleep();		// WakeUp takes us off "waiters"
+}
+
+//----------------------------------------------------------------------
+// PostOffice::WakeUp
+// 	Wake up every thread waiting for mail in "box", and take it off
+//	the list of waiters; leave the others on it.  Called with
+//	interrupts off.
+//----------------------------------------------------------------------
+
+void
+PostOffice::WakeUp(int box)
+{
+    MailWaiter *waiter;
+    List *tmp;
+
+    while ((waiter = (MailWaiter *) waiters->Remove()) != NULL) {
+	bool wanted = FALSE;
+
+	for (int i = 0; i < waiter->numBoxes; i++)
+	    if (waiter->boxes[i] == box)
+		wanted = TRUE;
+	if (wanted)
+	    scheduler->ReadyToRun(waiter->thread);
+	else
+	    stillWaiting->Append((void *) waiter);
+    }
+    tmp = waiters;
+    waiters = stillWaiting;
+    stillWaiting = tmp;
 }
 
 //----------------------------------------------------------------------
@@ -261,8 +265,7 @@ PostOffice::PostalDelivery()
 void
 PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 {
-    char* buffer = new char[MaxPacketSize];	// space to hold concatenated
-						// mailHdr + data
+    Packet *pkt;
 
     if (DebugIsEnabled('n')) {
 	printf("Post send: ");
@@ -271,27 +274,28 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
     ASSERT(mailHdr.length <= MaxMailSize);
     ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
     
-    // fill in pktHdr, for the Network layer
-    pktHdr.from = netAddr;
-    pktHdr.length = mailHdr.length + sizeof(MailHeader);
-
-    // concatenate MailHeader and data
-    bcopy(&mailHdr, buffer, sizeof(MailHeader));
-    bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
+    // fill in a packet buffer: pktHdr, for the Network layer, then
+    // MailHeader and data
+    pkt = network->AllocPacket();
+    pkt->hdr = pktHdr;
+    pkt->hdr.from = netAddr;
+    pkt->hdr.length = mailHdr.length + sizeof(MailHeader);
+    *(MailHeader *) pkt->data = mailHdr;
+    bcopy(data, pkt->data + sizeof(MailHeader), mailHdr.length);
 
     sendLock->Acquire();   		// only one message can be sent
 					// to the network at any one time
-    network->Send(pktHdr, buffer);
+    network->Send(pkt);
     messageSent->P();			// wait for interrupt to tell us
 					// ok to send the next message
     sendLock->Release();
 
-    delete [] buffer;			// we've sent the message, so
-					// we can delete our buffer
+    network->FreePacket(pkt);		// we've sent the message, so
+					// the buffer can be reused
 }
 
 //----------------------------------------------------------------------
-// PostOffice::Send
+// PostOffice::Receive
 // 	Retrieve a message from a specific box if one is available, 
 //	otherwise wait for a message to arrive in the box.
 //
@@ -309,23 +313,90 @@ void
 PostOffice::Receive(int box, PacketHeader *pktHdr, 
 				MailHeader *mailHdr, char* data)
 {
+    Packet *pkt = ReceivePacket(box);
+
+    *pktHdr = pkt->hdr;
+    *mailHdr = *(MailHeader *) pkt->data;
+    bcopy(pkt->data + sizeof(MailHeader), data, mailHdr->length);
+					// copy the message data into
+					// the caller's buffer
+    network->FreePacket(pkt);		// we've copied out the stuff we
+					// need, the buffer can be reused
+}
+
+//----------------------------------------------------------------------
+// PostOffice::ReceivePacket
+// 	Retrieve a message from a specific box, as PostOffice::Receive
+//	does, but return the packet buffer it is in rather than copying
+//	it out.  The caller gives it back with FreePacket.
+//
+//	"box" -- mailbox ID in which to look for message
+//----------------------------------------------------------------------
+
+Packet *
+PostOffice::ReceivePacket(int box)
+{
+    IntStatus oldLevel;
+    Packet *pkt;
+
     ASSERT((box >= 0) && (box < numBoxes));
 
-    boxes[box].Get(pktHdr, mailHdr, data);
-    ASSERT(mailHdr->length <= MaxMailSize);
+    DEBUG('n', "Waiting for mail in mailbox\n");
+    oldLevel = interrupt->SetLevel(IntOff);
+    while ((pkt = boxes[box].Get()) == NULL)
+	Wait(1, &box);
+    (void) interrupt->SetLevel(oldLevel);
+    ASSERT(((MailHeader *) pkt->data)->length <= MaxMailSize);
+    return pkt;
+}
+
+//----------------------------------------------------------------------
+// PostOffice::Select
+// 	Find a mailbox, out of several, that has mail in it, so that one
+//	thread can serve many mailboxes.  The mail is left in the box,
+//	for the caller to Receive; if other threads receive from the
+//	same boxes, it may be gone by then.
+//
+//	"n" -- number of mailboxes to look at
+//	"boxList" -- their IDs
+//	"wait" -- if none has mail, wait until one does (if TRUE) or
+//		return -1 at once (if FALSE)
+//----------------------------------------------------------------------
+
+int
+PostOffice::Select(int n, int *boxList, bool wait)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int ready = -1;
+
+    for (int i = 0; i < n; i++)
+	ASSERT((boxList[i] >= 0) && (boxList[i] < numBoxes));
+    for (;;) {
+	for (int i = 0; i < n && ready < 0; i++)
+	    if (!boxes[boxList[i]].IsEmpty())
+		ready = boxList[i];
+	if (ready >= 0 || !wait)
+	    break;
+	Wait(n, boxList);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return ready;
 }
 
 //----------------------------------------------------------------------
 // PostOffice::IncomingPacket
 // 	Interrupt handler, called when a packet arrives from the network.
 //
-//	Signal the PostalDelivery routine that it is time to get to work!
+//	Deliver whatever has arrived straight to its mailbox.
 //----------------------------------------------------------------------
 
 void
 PostOffice::IncomingPacket()
 { 
-    messageAvailable->V(); 
+    Packet *pkt;
+
+    while ((pkt = network->Receive()) != NULL)
+	Deliver(pkt);
 }
 
 //----------------------------------------------------------------------
@@ -1,6 +1,6 @@
 // post.h 
 //	Data structures for providing the abstraction of unreliable,
-//	ordered, fixed-size message delivery to mailboxes on other 
+//	ordered, bounded-size message delivery to mailboxes on other 
 //	(directly connected) machines.  Messages can be dropped by
 //	the network, but they are never corrupted.
 //
@@ -29,7 +29,8 @@
 #define POST_H
 
 #include "network.h"
-#include "synchlist.h"
+#include "list.h"
+#include "synch.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -53,41 +54,47 @@ class MailHeader {
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
 
-// The following class defines the format of an incoming/outgoing 
-// "Mail" message.  The message format is layered: 
+// An incoming message is kept in the packet buffer it arrived in
+// (cf. Packet in network.h); the format is layered:
 //	network header (PacketHeader) 
 //	post office header (MailHeader) 
 //	data
-
-class Mail {
-  public:
-     Mail(PacketHeader pktH, MailHeader mailH, char *msgData);
-				// Initialize a mail message by
-				// concatenating the headers to the data
-
-     PacketHeader pktHdr;	// Header appended by Network
-     MailHeader mailHdr;	// Header appended by PostOffice
-     char data[MaxMailSize];	// Payload -- message data
-};
+// so the message is handed from the network to the mailbox, and on to
+// whoever receives it, without being copied.
 
 // The following class defines a single mailbox, or temporary storage
 // for messages.   Incoming messages are put by the PostOffice into the 
 // appropriate mailbox, and these messages can then be retrieved by
 // threads on this machine.
+//
+// Messages are put in by the network interrupt handler, so a mailbox
+// is protected by turning interrupts off, not by a lock; waiting for
+// mail is up to the PostOffice (cf. PostOffice::Select).
 
 class MailBox {
   public: 
     MailBox();			// Allocate and initialize mail box
     ~MailBox();			// De-allocate mail box
 
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
-    void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
-   				// Atomically get a message out of the 
-				// mailbox (and wait if there is no message 
-				// to get!)
+    void Put(Packet *pkt);	// Put a message into the mailbox; the
+				// mailbox now owns "pkt"
+    Packet *Get();		// Get a message out of the mailbox, or
+				// NULL if it is empty; the caller now
+				// owns it
+    bool IsEmpty() { return messages->IsEmpty(); }
+
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    List *messages;		// A mailbox is just a list of arrived messages
+};
+
+// The following class records a thread waiting for mail to arrive in
+// any of a set of mailboxes.
+
+class MailWaiter {
+  public:
+    Thread *thread;		// Who is waiting
+    int *boxes;			// For which mailboxes
+    int numBoxes;
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -97,7 +104,10 @@ class MailBox {
 // then remove and return it.
 //
 // Incoming messages are put by the PostOffice into the 
-// appropriate mailbox, waking up any threads waiting on Receive.
+// appropriate mailbox, waking up any threads waiting on Receive, right
+// in the network interrupt handler: there is no thread in between.
+// A thread can also wait for mail in any of several mailboxes at once,
+// with Select.
 
 class PostOffice {
   public:
@@ -116,24 +126,41 @@ class PostOffice {
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
 				// there is no message in the box.
-
-    void PostalDelivery();	// Wait for incoming messages, 
-				// and then put them in the correct mailbox
+    Packet *ReceivePacket(int box);
+				// The same, but hand over the packet the
+				// message arrived in, rather than copying
+				// it; the MailHeader is at the start of
+				// its data.  Give it back with FreePacket.
+    void FreePacket(Packet *pkt) { network->FreePacket(pkt); }
+    int Select(int n, int *boxList, bool wait);
+				// Return one of the "n" mailboxes in
+				// "boxList" that has mail in it.  If none
+				// does, wait until one does, or, if not
+				// "wait", return -1.
+
+    NetworkAddress Address() { return netAddr; }
+				// This machine's network address
+    int NumBoxes() { return numBoxes; }
 
     void PacketSent();		// Interrupt handler, called when outgoing 
 				// packet has been put on network; next 
 				// packet can now be sent
     void IncomingPacket();	// Interrupt handler, called when incoming
    				// packet has arrived and can be pulled
-				// off of network (i.e., time to call 
-				// PostalDelivery)
+				// off of network; delivers it
 
   private:
     Network *network;		// Physical network connection
     NetworkAddress netAddr;	// Network address of this machine
     MailBox *boxes;		// Table of mail boxes to hold incoming mail
     int numBoxes;		// Number of mail boxes
-    Semaphore *messageAvailable;// V'ed when message has arrived from network
+    List *waiters;		// MailWaiters, for threads waiting for mail
+    List *stillWaiting;		// Spare list, used by WakeUp
+
+    void Deliver(Packet *pkt);	// Put an arrived message in its mailbox
+    void Wait(int n, int *boxList);
+				// Sleep until mail arrives in "boxList"
+    void WakeUp(int box);	// Wake up threads waiting on "box"
     Semaphore *messageSent;	// V'ed when next message can be sent to network
     Lock *sendLock;		// Only one outgoing message at a time
 };
@@ -0,0 +1,380 @@
+// transport.cc
+//	Routines for reliable byte streams between Nachos machines.
+//
+//	The sending thread is the only one that calls PostOffice::Send,
+//	which waits for the network; it releases the stream's lock while
+//	it does, so writers and the receiving thread are never held up by
+//	the network.  The receiving thread processes ACKs for our
+//	segments and data from the other end, and wakes up the sending
+//	thread whenever there is something new to send.
+//
+//	The retransmission timer is an interrupt, so it can't take the
+//	lock or send anything itself; it just tells the sending thread.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "transport.h"
+#include "system.h"
+
+// Dummy functions because C++ can't indirectly invoke member functions
+static void StreamReceiveHelper(int arg)
+{ Stream *s = (Stream *) arg; s->ReceiveLoop(); }
+static void StreamSendHelper(int arg)
+{ Stream *s = (Stream *) arg; s->SendLoop(); }
+static void StreamTimerHelper(int arg)
+{ Stream *s = (Stream *) arg; s->RetransmitTimer(); }
+
+//----------------------------------------------------------------------
+// Stream::Stream
+// 	Set up this end of a stream, and fork the threads that send and
+//	receive its segments.  The other end must set up a stream the
+//	other way round.
+//
+//	"ourBox" -- the mailbox on this machine the stream uses; nothing
+//		else may use it
+//	"peerAddr", "peerBox" -- the machine and mailbox at the other end
+//----------------------------------------------------------------------
+
+Stream::Stream(MailBoxAddress ourBox, NetworkAddress peerAddr,
+		MailBoxAddress peerBox)
+{
+    localBox = ourBox;
+    farAddr = peerAddr;
+    farBox = peerBox;
+
+    lock = new Lock("stream lock");
+    sendRoom = new Condition("stream send room");
+    acked = new Condition("stream acked");
+    dataAvail = new Condition("stream data avail");
+    work = new Semaphore("stream work", 0);
+
+    sendQueue = new Segment[SendQueueSize];
+    sendBase = sendNext = sendEnd = 0;
+    peerWindow = StreamWindow;
+    timerPending = timedOut = closed = FALSE;
+    deadline = 0;
+
+    recvQueue = new Segment[StreamWindow];
+    recvValid = new bool[StreamWindow];
+    for (int i = 0; i < StreamWindow; i++)
+	recvValid[i] = FALSE;
+    readSeq = readOffset = recvNext = 0;
+    ackPending = atEnd = FALSE;
+
+    numSent = numResent = numReceived = numDuplicates = 0;
+
+    (new Thread("stream receiver"))->Fork(StreamReceiveHelper, (int) this);
+    (new Thread("stream sender"))->Fork(StreamSendHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// Stream::Send
+// 	Break "numBytes" bytes of "data" into segments and queue them for
+//	the sending thread.  Return once they are all queued (not sent);
+//	wait only while the queue is full.
+//----------------------------------------------------------------------
+
+void
+Stream::Send(char *data, int numBytes)
+{
+    lock->Acquire();
+    ASSERT(!closed);
+    while (numBytes > 0) {
+	Segment *seg;
+	int n = min(numBytes, (int) MaxSegmentSize);
+
+	while (sendEnd - sendBase == SendQueueSize)
+	    sendRoom->Wait(lock);
+	seg = &sendQueue[sendEnd % SendQueueSize];
+	seg->hdr.seq = sendEnd++;
+	seg->hdr.flags = SegData;
+	seg->hdr.length = n;
+	bcopy(data, seg->data, n);
+	data += n;
+	numBytes -= n;
+	work->V();
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Stream::Close
+// 	Queue the end-of-stream marker, and wait until the other end has
+//	acknowledged everything, including the marker.
+//----------------------------------------------------------------------
+
+void
+Stream::Close()
+{
+    Segment *seg;
+
+    lock->Acquire();
+    ASSERT(!closed);
+    while (sendEnd - sendBase == SendQueueSize)
+	sendRoom->Wait(lock);
+    seg = &sendQueue[sendEnd % SendQueueSize];
+    seg->hdr.seq = sendEnd++;
+    seg->hdr.flags = SegFin;
+    seg->hdr.length = 0;
+    closed = TRUE;
+    work->V();
+    while (sendBase < sendEnd)
+	acked->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Stream::Receive
+// 	Wait until data has arrived in order (or the stream has ended),
+//	then copy up to "numBytes" bytes of it into "into".  Return the
+//	number of bytes copied, 0 at end of stream.
+//
+//	Reading frees room in the receive window; tell the other end.
+//----------------------------------------------------------------------
+
+int
+Stream::Receive(char *into, int numBytes)
+{
+    int done = 0;
+    bool freed = FALSE;
+
+    lock->Acquire();
+    while (readSeq == recvNext && !atEnd)
+	dataAvail->Wait(lock);
+    while (done < numBytes && readSeq < recvNext) {
+	int slot = readSeq % StreamWindow;
+	Segment *seg = &recvQueue[slot];
+	int n;
+
+	if (seg->hdr.flags & SegFin) {
+	    recvValid[slot] = FALSE;
+	    readSeq++;
+	    atEnd = TRUE;
+	    freed = TRUE;
+	    break;
+	}
+	n = min(numBytes - done, seg->hdr.length - readOffset);
+	bcopy(&seg->data[readOffset], &into[done], n);
+	readOffset += n;
+	done += n;
+	if (readOffset == seg->hdr.length) {
+	    recvValid[slot] = FALSE;
+	    readSeq++;
+	    readOffset = 0;
+	    freed = TRUE;
+	}
+    }
+    if (freed) {
+	ackPending = TRUE;		// window update
+	work->V();
+    }
+    lock->Release();
+    return done;
+}
+
+//----------------------------------------------------------------------
+// Stream::Window
+// 	Return how many more segments we have room to receive, beyond
+//	the ones that have arrived in order.
+//----------------------------------------------------------------------
+
+int
+Stream::Window()
+{
+    return StreamWindow - (recvNext - readSeq);
+}
+
+//----------------------------------------------------------------------
+// Stream::ArmTimer
+// 	Start timing the oldest unacknowledged segment.  A timer interrupt
+//	may already be scheduled; if so, it will notice the new deadline.
+//----------------------------------------------------------------------
+
+void
+Stream::ArmTimer()
+{
+    deadline = stats->totalTicks + RetransmitTime;
+    if (!timerPending) {
+	timerPending = TRUE;
+	interrupt->Schedule(StreamTimerHelper, (int) this, RetransmitTime,
+				NetworkSendInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Stream::RetransmitTimer
+// 	Timer interrupt.  If the oldest segment has gone unacknowledged
+//	too long, tell the sending thread to go back and resend; if the
+//	deadline has moved, wait for it instead.  If the timer has been
+//	stopped (deadline 0), do nothing.
+//----------------------------------------------------------------------
+
+void
+Stream::RetransmitTimer()
+{
+    timerPending = FALSE;
+    if (deadline == 0)
+	return;
+    if (stats->totalTicks >= deadline) {
+	deadline = 0;
+	timedOut = TRUE;
+	work->V();
+    } else {
+	timerPending = TRUE;
+	interrupt->Schedule(StreamTimerHelper, (int) this,
+				deadline - stats->totalTicks, NetworkSendInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Stream::Transmit
+// 	Hand a segment to the Post Office.  Waits until the network has
+//	taken it; called without the lock held.
+//----------------------------------------------------------------------
+
+void
+Stream::Transmit(Segment *seg)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+
+    pktHdr.to = farAddr;
+    mailHdr.to = farBox;
+    mailHdr.from = localBox;
+    mailHdr.length = sizeof(SegmentHeader) + seg->hdr.length;
+    postOffice->Send(pktHdr, mailHdr, (char *) seg);
+}
+
+//----------------------------------------------------------------------
+// Stream::SendLoop
+// 	The sending thread.  Each time there is something to do, send
+//	every queued segment the window allows; after a timeout, start
+//	again from the oldest unacknowledged one.  If the other end has
+//	no room at all, one segment is sent anyway when the timer goes
+//	off, to find out when it has room again.  Every segment carries
+//	an ACK; if none went out and we owe one, send a bare ACK.
+//----------------------------------------------------------------------
+
+void
+Stream::SendLoop()
+{
+    Segment seg;
+
+    for (;;) {
+	bool probe = FALSE;
+
+	work->P();
+	lock->Acquire();
+	if (timedOut) {
+	    timedOut = FALSE;
+	    numResent += sendNext - sendBase;
+	    sendNext = sendBase;
+	    probe = TRUE;
+	}
+	while (sendNext < sendEnd && (probe ||
+		sendNext - sendBase < min(StreamWindow, peerWindow))) {
+	    seg = sendQueue[sendNext % SendQueueSize];	// slot may be reused
+							// once it is acked
+	    seg.hdr.flags |= SegAck;
+	    seg.hdr.ack = recvNext;
+	    seg.hdr.window = Window();
+	    ackPending = FALSE;
+	    if (sendNext == sendBase)
+		ArmTimer();
+	    sendNext++;
+	    numSent++;
+	    probe = FALSE;
+	    lock->Release();
+	    Transmit(&seg);
+	    lock->Acquire();
+	}
+	if (ackPending) {
+	    seg.hdr.seq = sendNext;
+	    seg.hdr.flags = SegAck;
+	    seg.hdr.length = 0;
+	    seg.hdr.ack = recvNext;
+	    seg.hdr.window = Window();
+	    ackPending = FALSE;
+	    lock->Release();
+	    Transmit(&seg);
+	    lock->Acquire();
+	}
+	if (sendNext == sendBase && sendNext < sendEnd && deadline == 0)
+	    ArmTimer();			// window closed; probe later
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// Stream::ReceiveLoop
+// 	The receiving thread.  Take each message out of our mailbox, in
+//	the packet it arrived in; only data we keep is copied.  An
+//	ACK frees the segments it covers, and restarts the timer for the
+//	next one (or stops it).  Data that is new and fits in the window
+//	is kept, even if it is early; a duplicate is dropped.  Either way,
+//	we owe the other end an ACK.
+//----------------------------------------------------------------------
+
+void
+Stream::ReceiveLoop()
+{
+    Packet *pkt;
+    Segment *seg;
+
+    for (;;) {
+	pkt = postOffice->ReceivePacket(localBox);	// no copy
+	seg = (Segment *) (pkt->data + sizeof(MailHeader));
+	lock->Acquire();
+	if (seg->hdr.flags & SegAck) {
+	    peerWindow = seg->hdr.window;
+	    if (seg->hdr.ack > sendBase && seg->hdr.ack <= sendNext) {
+		sendBase = seg->hdr.ack;
+		sendRoom->Broadcast(lock);
+		if (sendBase == sendEnd)
+		    acked->Broadcast(lock);
+		if (sendBase < sendNext)
+		    ArmTimer();
+		else
+		    deadline = 0;
+	    }
+	    work->V();			// the window may have opened
+	}
+	if (seg->hdr.flags & (SegData | SegFin)) {
+	    int seq = seg->hdr.seq;
+	    int slot = seq % StreamWindow;
+
+	    if (seq >= recvNext && seq < readSeq + StreamWindow
+			&& !recvValid[slot]) {
+		bcopy(seg, &recvQueue[slot],
+			sizeof(SegmentHeader) + seg->hdr.length);
+		recvValid[slot] = TRUE;
+		numReceived++;
+		while (recvNext < readSeq + StreamWindow
+			&& recvValid[recvNext % StreamWindow])
+		    recvNext++;
+		dataAvail->Broadcast(lock);
+	    } else
+		numDuplicates++;
+	    ackPending = TRUE;
+	    work->V();
+	}
+	lock->Release();
+	postOffice->FreePacket(pkt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Stream::PrintStats
+// 	Print how many segments were sent, resent and received.
+//----------------------------------------------------------------------
+
+void
+Stream::PrintStats()
+{
+    printf("Stream %d -> %d.%d: segments sent %d (resent %d), "
+	   "received %d (duplicates %d)\n", localBox, farAddr, farBox,
+	   numSent, numResent, numReceived, numDuplicates);
+}
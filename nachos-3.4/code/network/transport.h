@@ -0,0 +1,134 @@
+// transport.h
+//	Data structures for reliable, ordered, flow-controlled byte
+//	streams between Nachos machines, built on top of the Post Office.
+//
+//	The Post Office delivers small messages, but may lose them.
+//	A stream breaks the bytes it is given into segments that fit in a
+//	message, numbers them, and keeps up to StreamWindow of them in
+//	flight at once (a sliding window).  The receiver acknowledges
+//	the segments it has received in order with a cumulative ACK, and
+//	holds on to any that arrive early.  If the oldest segment isn't
+//	acknowledged within RetransmitTime, it and everything sent after
+//	it are sent again (go-back-N).  Each ACK also says how many more
+//	segments the receiver has room for, so a fast sender can't swamp
+//	a slow reader.
+//
+//	A stream connects one mailbox on this machine to one mailbox on
+//	another.  There is no handshake: both ends create their stream,
+//	each naming the other, and numbering starts at 0.  Closing a
+//	stream sends an end-of-stream marker, after which the other end
+//	reads end of file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "post.h"
+#include "synch.h"
+
+// The following class defines the header of a segment; it is
+// prepended to the data by the stream, before the message is given to
+// the Post Office.
+
+#define SegData		0x1	// carries data
+#define SegAck		0x2	// "ack" and "window" are valid
+#define SegFin		0x4	// end of the stream
+
+class SegmentHeader {
+  public:
+    int seq;			// Number of this segment
+    int ack;			// Next segment expected from the other end
+    unsigned short length;	// Bytes of data
+    unsigned char flags;	// SegData, SegAck, SegFin
+    unsigned char window;	// Segments the other end may send beyond
+				// "ack"
+};
+
+#define MaxSegmentSize	(MaxMailSize - sizeof(SegmentHeader))
+				// data in one segment
+#define StreamWindow	8	// segments in flight (and buffered by the
+				// receiver) at most
+#define SendQueueSize	(2 * StreamWindow)
+				// segments a writer can queue
+#define RetransmitTime	(20 * NetworkTime)
+				// how long to wait for an ACK
+
+// The following class defines a segment, as kept by the stream.
+
+class Segment {
+  public:
+    SegmentHeader hdr;
+    char data[MaxSegmentSize];
+};
+
+// The following class defines one end of a stream.  Two threads are
+// forked for each stream: one takes messages out of the local mailbox
+// and processes them, the other puts segments (and ACKs) onto the
+// network, so that a writer need not wait for the network.
+
+class Stream {
+  public:
+    Stream(MailBoxAddress ourBox, NetworkAddress peerAddr,
+		MailBoxAddress peerBox);
+				// Set up this end of a stream, from
+				// "ourBox" to "peerBox" on "peerAddr".
+				// (Its threads run until Nachos halts,
+				// so a stream is never de-allocated.)
+
+    void Send(char *data, int numBytes);
+				// Queue "numBytes" bytes to go to the
+				// other end; wait only if the queue is full
+    int Receive(char *into, int numBytes);
+				// Wait for data; return up to "numBytes"
+				// bytes of it, or 0 at end of stream
+    void Close();		// Send end of stream, and wait until
+				// everything sent has been acknowledged
+
+    void PrintStats();		// Segments sent, resent and received
+
+    void ReceiveLoop();		// internal routines, run by the stream's
+    void SendLoop();		// threads
+    void RetransmitTimer();	// called by the timer interrupt
+
+  private:
+    void Transmit(Segment *seg);// Hand one segment to the Post Office
+    void ArmTimer();		// Start timing the oldest segment
+    int Window();		// Segments we have room to receive
+
+    MailBoxAddress localBox, farBox;
+    NetworkAddress farAddr;
+
+    Lock *lock;			// protects everything below
+    Condition *sendRoom;	// the send queue has room
+    Condition *acked;		// everything sent has been acknowledged
+    Condition *dataAvail;	// there is data to receive
+    Semaphore *work;		// something for the sending thread to do
+
+    // sending side: segments sendBase .. sendEnd-1 are in the queue;
+    // those before sendNext have been sent at least once
+    Segment *sendQueue;		// SendQueueSize segments, by number
+    int sendBase, sendNext, sendEnd;
+    int peerWindow;		// segments the other end has room for
+    bool timerPending;		// a timer interrupt is scheduled
+    int deadline;		// when the oldest segment times out
+    bool timedOut;		// time to go back and resend
+    bool closed;		// end of stream has been queued
+
+    // receiving side: segments readSeq .. recvNext-1 have arrived in
+    // order and not been read; later ones may have arrived early
+    Segment *recvQueue;		// StreamWindow segments, by number
+    bool *recvValid;		// which slots hold a segment
+    int readSeq, readOffset;	// where the reader is
+    int recvNext;		// next segment expected in order
+    bool ackPending;		// we owe the other end an ACK
+    bool atEnd;			// end of stream reached by the reader
+
+    int numSent, numResent, numReceived, numDuplicates;
+};
+
+#endif // TRANSPORT_H
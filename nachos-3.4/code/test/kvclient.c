@@ -0,0 +1,73 @@
+/* kvclient.c
+ *	Client for the key-value store in kvserver.c, on machine 0.
+ *
+ *	Puts a value under every key, reads each one back and checks it,
+ *	then tells the server to quit.  Each request waits for its reply,
+ *	so the ticks Nachos reports when it halts measure round trips end
+ *	to end.  Replies come back to mailbox 1 here.
+ *
+ *	The network mustn't lose messages (the default, -l 1), since
+ *	there is no retransmission.
+ */
+
+#include "syscall.h"
+
+#define NumKeys		32
+#define Rounds		4
+
+/* Send "request" to the server, and wait for the reply */
+int
+Call(MailAddress *server, char *request, int size, char *reply)
+{
+    Send(server, 1, request, size);
+    return Receive(1, 0, reply, MaxMessage);
+}
+
+void
+PutString(char *s)
+{
+    int n = 0;
+
+    while (s[n] != '\0')
+	n++;
+    Write(s, n, ConsoleOutput);
+}
+
+int
+main()
+{
+    MailAddress server;
+    char request[MaxMessage], reply[MaxMessage];
+    int key, round, n, errors = 0;
+
+    server.machine = 0;
+    server.box = 1;
+
+    for (round = 0; round < Rounds; round++) {
+	for (key = 0; key < NumKeys; key++) {
+	    request[0] = 'P';
+	    request[1] = key;
+	    request[2] = 'a' + key % 26;
+	    request[3] = '0' + round;
+	    n = Call(&server, request, 4, reply);
+	    if (n != 1 || reply[0] != 'O')
+		errors++;
+	}
+	for (key = 0; key < NumKeys; key++) {
+	    request[0] = 'G';
+	    request[1] = key;
+	    n = Call(&server, request, 2, reply);
+	    if (n != 3 || reply[0] != 'V' || reply[1] != 'a' + key % 26
+			|| reply[2] != '0' + round)
+		errors++;
+	}
+    }
+
+    request[0] = 'Q';
+    Call(&server, request, 1, reply);
+    if (errors == 0)
+	PutString("kvclient: all replies correct\n");
+    else
+	PutString("kvclient: wrong replies\n");
+    Halt();
+}
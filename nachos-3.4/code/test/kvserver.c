@@ -0,0 +1,69 @@
+/* kvserver.c
+ *	A key-value store, served over the network to kvclient.c.
+ *
+ *	Requests arrive in mailbox 1 of this machine; each is a one-byte
+ *	operation, a one-byte key (0 .. NumKeys-1) and, for a put, the
+ *	value.  The reply goes to the sender's reply mailbox:
+ *
+ *		'P' key value	-> 'O'
+ *		'G' key		-> 'V' value, or 'N' if the key isn't set
+ *		'Q'		-> 'O', and the server halts
+ *
+ *	Mailbox 2 takes the same requests, so that a second client on
+ *	the same machine as another can use its own mailbox; the server
+ *	Polls both.
+ *
+ *	Run as:	nachos -m 0 -x ../test/kvserver
+ *	   and:	nachos -m 1 -x ../test/kvclient
+ */
+
+#include "syscall.h"
+
+#define NumKeys		32
+#define ValueSize	(MaxMessage - 2)
+
+char values[NumKeys][ValueSize];
+int lengths[NumKeys];		/* -1 if the key isn't set */
+
+int
+main()
+{
+    int boxes[2];
+    char request[MaxMessage], reply[MaxMessage];
+    MailAddress from;
+    int box, n, key, i, replySize;
+
+    boxes[0] = 1;
+    boxes[1] = 2;
+    for (key = 0; key < NumKeys; key++)
+	lengths[key] = -1;
+
+    while (1) {
+	box = Poll(boxes, 2, 1);
+	n = Receive(box, &from, request, MaxMessage);
+	if (n < 1)
+	    continue;
+	key = (n >= 2) ? request[1] : -1;
+	replySize = 1;
+	reply[0] = 'O';
+	if (request[0] == 'P' && key >= 0 && key < NumKeys) {
+	    lengths[key] = n - 2;
+	    for (i = 2; i < n; i++)
+		values[key][i - 2] = request[i];
+	} else if (request[0] == 'G' && key >= 0 && key < NumKeys) {
+	    if (lengths[key] < 0)
+		reply[0] = 'N';
+	    else {
+		reply[0] = 'V';
+		for (i = 0; i < lengths[key]; i++)
+		    reply[i + 1] = values[key][i];
+		replySize += lengths[key];
+	    }
+	} else if (request[0] == 'Q') {
+	    Send(&from, box, reply, replySize);
+	    Halt();
+	} else
+	    reply[0] = 'E';
+	Send(&from, box, reply, replySize);
+    }
+}
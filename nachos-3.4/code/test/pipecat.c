@@ -0,0 +1,51 @@
+/* pipecat.c
+ *	Copy ConsoleInput to ConsoleOutput until end of file, then print
+ *	how many bytes were copied.
+ *
+ *	Started by pipetest.c, whose open files it shares, with a pipe as
+ *	its ConsoleInput.  It first closes every other OpenFileId it was
+ *	given -- including pipetest's write end of the pipe, or it would
+ *	never see end of file.
+ */
+
+#include "syscall.h"
+
+#define MaxOpenFiles	16	/* in userprog/fdtable.h */
+
+void
+PutString(char *s)
+{
+    int n = 0;
+
+    while (s[n] != '\0')
+	n++;
+    Write(s, n, ConsoleOutput);
+}
+
+int
+main()
+{
+    char buf[100], count[12], digits[12];
+    int id, n, len, i, copied = 0;
+
+    for (id = ConsoleOutput + 1; id < MaxOpenFiles; id++)
+	Close(id);
+
+    while ((n = Read(buf, sizeof(buf), ConsoleInput)) > 0) {
+	Write(buf, n, ConsoleOutput);
+	copied += n;
+    }
+
+    len = 0;
+    do {
+	digits[len++] = '0' + copied % 10;
+	copied /= 10;
+    } while (copied > 0);
+    for (i = 0; i < len; i++)
+	count[i] = digits[len - 1 - i];
+    count[len] = '\0';
+    PutString("pipecat: copied ");
+    PutString(count);
+    PutString(" bytes\n");
+    Exit(0);
+}
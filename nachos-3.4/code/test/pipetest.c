@@ -0,0 +1,80 @@
+/* pipetest.c
+ *	Send data from one user program to another through a pipe.
+ *
+ *	Makes a pipe, and puts its read end in place of ConsoleInput (the
+ *	way a shell sets up "pipetest | pipecat"); then Execs pipecat,
+ *	which shares this program's open files, and so reads the pipe.
+ *	Writes Lines numbered lines into the pipe -- several times what
+ *	the pipe holds, so each side has to wait for the other -- and
+ *	closes it.  pipecat prints what it got, and its byte count should
+ *	match the one printed here.
+ *
+ *	Run as:	nachos -x ../test/pipetest
+ */
+
+#include "syscall.h"
+
+#define Lines		64
+
+void
+PutString(char *s)
+{
+    int n = 0;
+
+    while (s[n] != '\0')
+	n++;
+    Write(s, n, ConsoleOutput);
+}
+
+/* Write "n" into "buf" in decimal; return the number of digits */
+int
+PutNumber(char *buf, int n)
+{
+    char digits[12];
+    int len = 0, i;
+
+    do {
+	digits[len++] = '0' + n % 10;
+	n /= 10;
+    } while (n > 0);
+    for (i = 0; i < len; i++)
+	buf[i] = digits[len - 1 - i];
+    return len;
+}
+
+int
+main()
+{
+    OpenFileId fds[2];
+    char line[40], count[12];
+    int i, n, sent = 0;
+    char *text = "the quick brown fox, line ";
+
+    if (Pipe(fds) < 0) {
+	PutString("pipetest: can't make a pipe\n");
+	Exit(1);
+    }
+    Close(ConsoleInput);
+    if (Dup(fds[0]) != ConsoleInput) {	/* the lowest free OpenFileId */
+	PutString("pipetest: can't redirect ConsoleInput\n");
+	Exit(1);
+    }
+    Close(fds[0]);
+    Exec("../test/pipecat");
+
+    for (i = 0; i < Lines; i++) {
+	for (n = 0; text[n] != '\0'; n++)
+	    line[n] = text[n];
+	n += PutNumber(line + n, i);
+	line[n++] = '\n';
+	Write(line, n, fds[1]);		/* waits while the pipe is full */
+	sent += n;
+    }
+    Close(fds[1]);		/* pipecat sees end of file */
+
+    count[PutNumber(count, sent)] = '\0';
+    PutString("pipetest: sent ");
+    PutString(count);
+    PutString(" bytes\n");
+    Exit(0);
+}
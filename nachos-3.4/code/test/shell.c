@@ -6,7 +6,7 @@ main()
     SpaceId newProc;
     OpenFileId input = ConsoleInput;
     OpenFileId output = ConsoleOutput;
-    char prompt[2], ch, buffer[60];
+    char prompt[2], buffer[60];
     int i;
 
     prompt[0] = '>';
@@ -14,13 +14,14 @@ main()
 
     while( 1 ){
 		Write(prompt, 2, output);
-		i = 0;
 
-		do {
-		    Read(&buffer[i], 1, input);
-		} while( buffer[i++] != '\n' );
-
-		buffer[--i] = '\0';
+		/* the console returns a whole line per Read */
+		i = Read(buffer, sizeof(buffer) - 1, input);
+		if( i <= 0 )
+			Exit(0);
+		if( buffer[i-1] == '\n' )
+			i--;
+		buffer[i] = '\0';
 
 		if( buffer[0] =='b' && buffer[1]=='a' && buffer[2] =='s' && buffer[3]=='h' && buffer[4]==' '){
 			newProc = Exec(buffer+5);
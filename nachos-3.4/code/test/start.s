@@ -197,6 +197,46 @@ Print:
 	j $31
 	.end Print
 
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j $31
+	.end Pipe
+
+	.globl Dup
+	.ent	Dup
+Dup:
+	addiu $2,$0,SC_Dup
+	syscall
+	j $31
+	.end Dup
+
+	.globl Send
+	.ent	Send
+Send:
+	addiu $2,$0,SC_Send
+	syscall
+	j $31
+	.end Send
+
+	.globl Receive
+	.ent	Receive
+Receive:
+	addiu $2,$0,SC_Receive
+	syscall
+	j $31
+	.end Receive
+
+	.globl Poll
+	.ent	Poll
+Poll:
+	addiu $2,$0,SC_Poll
+	syscall
+	j $31
+	.end Poll
+
 
 
 
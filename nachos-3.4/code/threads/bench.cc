@@ -0,0 +1,306 @@
+// bench.cc
+//	Microbenchmarks of the Nachos kernel and the machine simulation,
+//	run with "nachos -bench <name> <iterations>".
+//
+//	Each benchmark does "iterations" of one operation, and prints a
+//	line giving the simulated ticks and host time it took:
+//
+//		bench name=switch iterations=10000 ticks=... host_us=...
+//
+//	then halts.  Which benchmarks there are depends on what Nachos was
+//	built with (cf. BenchNames).  bench.py runs the whole suite, over
+//	the different builds, repeatedly, and summarizes the results.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "synch.h"
+#ifdef NETWORK
+#include "post.h"
+#endif
+
+#define BenchLockThreads	4	// threads contending for the lock
+#define BenchInterruptBatch	64	// interrupts pending at once
+#define BenchPages		8	// pages mapped for "translate"
+#define BenchFileSize		4096	// bytes in the file for "seqio"
+#define BenchChunk		128	// ... read or written at a time
+
+static char *BenchNames = "switch semaphore lock interrupt"
+#ifdef USER_PROGRAM
+    " translate"
+#endif
+#ifdef FILESYS_NEEDED
+    " create seqio randio"
+#endif
+#ifdef NETWORK
+    " mailbox"
+#endif
+    ;
+
+static Semaphore *benchDone;		// V'ed by each thread as it finishes
+static Semaphore *ping, *pong;
+static Lock *benchLock;
+static int benchCount;			// operations done, or interrupts fired
+
+//----------------------------------------------------------------------
+// BenchFork
+// 	Fork "n" threads running "func"("arg"), and wait for them all to
+//	finish.
+//----------------------------------------------------------------------
+
+static void
+BenchFork(int n, VoidFunctionPtr func, int arg)
+{
+    for (int i = 0; i < n; i++)
+	(new Thread("bench"))->Fork(func, (void *) arg);
+    for (int i = 0; i < n; i++)
+	benchDone->P();
+}
+
+// "switch": two threads yield to each other
+static void
+YieldLoop(int n)
+{
+    for (int i = 0; i < n; i++)
+	currentThread->Yield();
+    benchDone->V();
+}
+
+// "semaphore": two threads hand a token back and forth
+static void
+Pinger(int n)
+{
+    for (int i = 0; i < n; i++) {
+	ping->V();
+	pong->P();
+    }
+    benchDone->V();
+}
+
+static void
+Ponger(int n)
+{
+    for (int i = 0; i < n; i++) {
+	ping->P();
+	pong->V();
+    }
+    benchDone->V();
+}
+
+// "lock": threads take turns at a lock, yielding while they hold it,
+// so the others have to wait
+static void
+LockLoop(int n)
+{
+    for (int i = 0; i < n; i++) {
+	benchLock->Acquire();
+	benchCount++;
+	currentThread->Yield();
+	benchLock->Release();
+    }
+    benchDone->V();
+}
+
+// "interrupt": a device interrupt that does nothing
+static void
+BenchInterrupt(int dummy)
+{
+    benchCount++;
+}
+
+static void
+ScheduleInterrupts(int n)
+{
+    for (int i = 0; i < n; i += BenchInterruptBatch) {
+	int batch = (n - i < BenchInterruptBatch) ? n - i : BenchInterruptBatch;
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+	for (int j = 0; j < batch; j++)		// spread over the next
+	    interrupt->Schedule(BenchInterrupt, 0,	// few hundred ticks
+				1 + (i + j) * 7919 % 300, TimerInt);
+	(void) interrupt->SetLevel(oldLevel);
+	while (benchCount < i + batch) {	// each tick fires the due ones
+	    (void) interrupt->SetLevel(IntOff);
+	    (void) interrupt->SetLevel(IntOn);
+	}
+    }
+}
+
+#ifdef USER_PROGRAM
+// "translate": look up addresses in BenchPages pages mapped for the
+// running thread
+static void
+TranslateLoop(int n)
+{
+    TranslationEntry *table = (machine->tlb != NULL) ? machine->tlb
+						     : machine->pageTable;
+    int size = (machine->tlb != NULL) ? TLBSize : BenchPages;
+    TranslationEntry *saved = new TranslationEntry[size];
+    int savedPages = machine->virtualPageSize;
+    int physAddr;
+
+    ASSERT(size >= BenchPages);
+    for (int i = 0; i < size; i++) {
+	saved[i] = table[i];
+	table[i].valid = (i < BenchPages);
+	table[i].virtualPage = i;
+	table[i].physicalPage = i;
+	table[i].readOnly = FALSE;
+	table[i].use = table[i].dirty = FALSE;
+	table[i].thread_id = currentThread->get_threadID();
+	table[i].counter = 0;
+    }
+    machine->virtualPageSize = BenchPages;
+
+    for (int i = 0; i < n; i++) {
+	int virtAddr = (i % BenchPages) * PageSize + (i * 4) % PageSize;
+	ExceptionType result = machine->Translate(virtAddr, &physAddr, 4,
+						  i & 1);
+
+	ASSERT(result == NoException);
+    }
+
+    for (int i = 0; i < size; i++)
+	table[i] = saved[i];
+    machine->virtualPageSize = savedPages;
+    delete [] saved;
+}
+#endif
+
+#ifdef FILESYS_NEEDED
+// "create": create and remove small files
+static void
+CreateLoop(int n)
+{
+    char name[16];
+
+    for (int i = 0; i < n; i++) {
+	bool created, removed;
+
+	sprintf(name, "bench%d", i % 8);
+	created = fileSystem->Create(name, 0);
+	removed = fileSystem->Remove(name);
+	ASSERT(created && removed);
+    }
+}
+
+// "seqio" and "randio": write, then read, BenchChunk bytes at a time,
+// in order or all over a BenchFileSize file
+static void
+FileLoop(int n, bool random)
+{
+    char buffer[BenchChunk];
+    int chunks = BenchFileSize / BenchChunk;
+    unsigned int seed = 1;
+    OpenFile *file;
+
+    for (int i = 0; i < BenchChunk; i++)
+	buffer[i] = i;
+    fileSystem->Create("benchfile", BenchFileSize);
+    file = fileSystem->Open("benchfile");
+    ASSERT(file != NULL);
+    for (int i = 0; i < n; i++) {
+	int chunk = i % chunks, done;
+
+	if (random) {
+	    seed = seed * 1103515245 + 12345;
+	    chunk = (seed >> 16) % chunks;
+	}
+	if (i < n / 2)
+	    done = file->WriteAt(buffer, BenchChunk, chunk * BenchChunk);
+	else
+	    done = file->ReadAt(buffer, BenchChunk, chunk * BenchChunk);
+	ASSERT(done == BenchChunk);
+    }
+    delete file;
+    fileSystem->Remove("benchfile");
+}
+#endif
+
+#ifdef NETWORK
+// "mailbox": two threads send a message back and forth, through this
+// machine's own post office
+static void
+MailLoop(int first)
+{
+    PacketHeader outPktHdr, inPktHdr;
+    MailHeader outMailHdr, inMailHdr;
+    char buffer[MaxMailSize];
+
+    outPktHdr.to = postOffice->Address();
+    outMailHdr.to = first ? 2 : 1;
+    outMailHdr.from = first ? 1 : 2;
+    outMailHdr.length = 8;
+    for (int i = 0; i < benchCount; i++) {
+	if (first)
+	    postOffice->Send(outPktHdr, outMailHdr, "message");
+	postOffice->Receive(outMailHdr.from, &inPktHdr, &inMailHdr, buffer);
+	if (!first)
+	    postOffice->Send(outPktHdr, outMailHdr, "message");
+    }
+    benchDone->V();
+}
+#endif
+
+//----------------------------------------------------------------------
+// Bench
+// 	Run the benchmark "name", doing "iterations" operations, print
+//	how long it took, and halt.
+//----------------------------------------------------------------------
+
+void
+Bench(char *name, int iterations)
+{
+    int startTicks = stats->totalTicks;
+    long long startHost = HostTime();
+
+    benchDone = new Semaphore("bench done", 0);
+    benchCount = 0;
+    if (!strcmp(name, "switch"))
+	BenchFork(2, YieldLoop, iterations);
+    else if (!strcmp(name, "semaphore")) {
+	ping = new Semaphore("ping", 0);
+	pong = new Semaphore("pong", 0);
+	(new Thread("ponger"))->Fork(Ponger, (void *) iterations);
+	BenchFork(1, Pinger, iterations);
+	benchDone->P();				// and the ponger
+    } else if (!strcmp(name, "lock")) {
+	benchLock = new Lock("bench");
+	BenchFork(BenchLockThreads, LockLoop, iterations / BenchLockThreads);
+	ASSERT(benchCount == iterations / BenchLockThreads * BenchLockThreads);
+    } else if (!strcmp(name, "interrupt"))
+	ScheduleInterrupts(iterations);
+#ifdef USER_PROGRAM
+    else if (!strcmp(name, "translate"))
+	TranslateLoop(iterations);
+#endif
+#ifdef FILESYS_NEEDED
+    else if (!strcmp(name, "create"))
+	CreateLoop(iterations);
+    else if (!strcmp(name, "seqio"))
+	FileLoop(iterations, FALSE);
+    else if (!strcmp(name, "randio"))
+	FileLoop(iterations, TRUE);
+#endif
+#ifdef NETWORK
+    else if (!strcmp(name, "mailbox")) {
+	benchCount = iterations;
+	(new Thread("mail ponger"))->Fork(MailLoop, (void *) 0);
+	BenchFork(1, MailLoop, 1);
+	benchDone->P();				// and the ponger
+    }
+#endif
+    else {
+	printf("Unknown benchmark \"%s\"; this Nachos has: %s\n", name,
+	       BenchNames);
+	interrupt->Halt();
+    }
+
+    printf("bench name=%s iterations=%d ticks=%d host_us=%lld\n", name,
+	   iterations, stats->totalTicks - startTicks, HostTime() - startHost);
+    fflush(stdout);
+    interrupt->Halt();
+}
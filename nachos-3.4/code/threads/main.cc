@@ -9,21 +9,45 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-trace <file> -metrics <file> [interval]
+//		-bench <name> <iterations> -smp <cpus> [quantum]
+//		-s -x <nachos file> -c <consoleIn> <consoleOut> -cbatch
+//		-prof <file> [interval] -timing [parameters]
+//		-f -cp <unix file> <nachos file> -atime <mode>
+//		-p <nachos file> -r <nachos file> -l -D -t -fsck -ck
+//		-disk <tracks> <sectors per track> -mmap -msync -rw <policy>
 //              -n <network reliability> -m <machine id>
-//              -o <other machine id>
+//              -o <other machine id> -ot <other machine id>
+//              -nb <mode> <nodes> <size> <count>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
+//    -trace records events (context switches, interrupts, faults, disk
+//	 requests, system calls) and writes them to <file> when Nachos
+//	 halts, as a Chrome trace (cf. trace.h)
+//    -metrics writes counters and latency histograms to <file> when
+//	 Nachos halts, when it gets SIGUSR1, and every [interval] ticks:
+//	 JSON lines, or CSV if <file> ends in .csv (cf. metrics.h)
+//    -bench runs one of the microbenchmarks in bench.cc, and halts
+//	 (bench.py runs them all: "make bench")
+//    -smp simulates a multiprocessor with <cpus> CPUs, each with its
+//	 own ready queue, taking turns every [quantum] ticks (cf. smp.h)
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -cbatch makes a batch of console output take as long as one
+//	 character, rather than one character time per byte
+//    -prof samples user programs every [interval] instructions (100 by
+//	 default), prints a flat profile when Nachos halts, and writes the
+//	 call stacks to <file>, folded for flamegraph.pl (cf. profile.h)
+//    -timing charges user instructions for cache misses and pipeline
+//	 stalls, and prints the caches' hit rates when Nachos halts;
+//	 [parameters] change the caches and latencies, e.g.
+//	 "dcache=16k:4:32:wt,mem=40" (cf. timing.h)
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
@@ -33,11 +57,27 @@
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system
 //    -t tests the performance of the Nachos file system
+//    -tdir grows a directory past its first index sector, and checks
+//	 that all of its files can be found and removed
+//    -atime sets when reads update a file's last visit time:
+//	 "strict" (every read), "relatime" (default) or "noatime"
+//    -fsck checks and repairs the file system before mounting it
+//    -ck checks the mounted file system, without repairing it
+//    -disk sets the geometry of a disk being formatted (with -f); the
+//	 sector size is set at compile time (make SECTOR_SIZE=4096)
+//    -mmap maps the disk image into memory instead of reading and
+//	 writing it with system calls; -msync also makes a file system
+//	 sync wait until the image is written out
+//    -rw sets who goes first for a file being both read and written:
+//	 "reader", "writer" (default) or "fair" (cf. RWLock in synch.h)
 //
 //  NETWORK
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
 //    -o runs a simple test of the Nachos network software
+//    -ot tests reliable streams (cf. transport.h) to the other machine
+//    -nb runs a network benchmark on one of a cluster of machines: mode
+//	 "pingpong", "stream" or "alltoall" (cf. nettest.cc, cluster.py)
 //
 //  NOTE -- flags are ignored until the relevant assignment.
 //  Some of the flags are interpreted here; some in system.cc.
@@ -61,9 +101,12 @@ extern int testnum;
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void), PerformanceTest2(void);
+extern void DirGrowTest(void);
 extern void MakeDir(char* name);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
-extern void MailTest(int networkID);
+extern void MailTest(int networkID), StreamTest(int networkID);
+extern void NetBench(char *mode, int numNodes, int size, int count);
+extern void Bench(char *name, int iterations);
 
 //----------------------------------------------------------------------
 // main
@@ -108,6 +151,11 @@ main(int argc, char **argv)
 	argCount = 1;
         if (!strcmp(*argv, "-z"))               // print copyright
             printf (copyright);
+        else if (!strcmp(*argv, "-bench")) {	// run a microbenchmark
+	    ASSERT(argc > 2);
+	    Bench(*(argv + 1), atoi(*(argv + 2)));
+	    argCount = 3;
+	}
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
@@ -150,8 +198,12 @@ main(int argc, char **argv)
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-tdir")) {	// directory growth test
+            DirGrowTest();
 	} else if (!strcmp(*argv, "-mkdir")) {	// make directory
             MakeDir(*(argv+1));
+	} else if (!strcmp(*argv, "-ck")) {	// check the file system
+            fileSystem->Check();
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -162,6 +214,17 @@ main(int argc, char **argv)
 						// start up another nachos
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-ot")) {	// test reliable streams
+	    ASSERT(argc > 1);
+            Delay(2);
+            StreamTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-nb")) {	// network benchmark
+	    ASSERT(argc > 4);
+            Delay(2);				// let the other nodes start
+            NetBench(*(argv + 1), atoi(*(argv + 2)), atoi(*(argv + 3)),
+			atoi(*(argv + 4)));
+            argCount = 5;
         }
 #endif // NETWORK
     }
@@ -0,0 +1,413 @@
+// metrics.cc
+//	Routines to keep counters and latency histograms, and to write
+//	snapshots of them out.
+//
+//	Everything here is called on hot paths, with interrupts in any
+//	state, so recording a value only adds to a few counters; nothing
+//	is formatted until a snapshot is written.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "metrics.h"
+#include "system.h"
+#include <signal.h>
+
+// Names of the counters and histograms, for the snapshots
+static char *counterNames[NumMetricCounters] = {
+    "context_switches", "interrupts", "syscalls", "page_faults",
+    "tlb_misses", "disk_requests"
+};
+static char *histogramNames[NumMetricHistograms] = {
+    "disk_service", "page_fault_service", "syscall", "ready_wait"
+};
+
+// Set by the SIGUSR1 handler; a snapshot is written at the next tick
+static volatile sig_atomic_t snapshotRequested = 0;
+
+static void
+RequestSnapshot()
+{
+    snapshotRequested = 1;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Histogram, Histogram::Reset
+// 	Start out with no values.
+//----------------------------------------------------------------------
+
+Histogram::Histogram()
+{
+    Reset();
+}
+
+void
+Histogram::Reset()
+{
+    count = sum = min = max = 0;
+    for (int i = 0; i < HistogramBuckets; i++)
+	buckets[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// Histogram::BucketOf
+// 	Return the bucket "value" falls in.  Values below
+//	HistogramSubBuckets each have a bucket of their own; above that,
+//	the bucket is given by the position of the value's highest bit,
+//	and the HistogramSubBits bits below it.
+//----------------------------------------------------------------------
+
+int
+Histogram::BucketOf(long long value)
+{
+    int high = 0;
+
+    if (value < HistogramSubBuckets)
+	return (int) value;
+    for (unsigned long long v = value; v > 1; v >>= 1)
+	high++;
+    return (high - HistogramSubBits + 1) * HistogramSubBuckets
+	+ (int) ((value >> (high - HistogramSubBits))
+		 & (HistogramSubBuckets - 1));
+}
+
+//----------------------------------------------------------------------
+// Histogram::HighestIn
+// 	Return the largest value that falls in "bucket"; the inverse of
+//	BucketOf.
+//----------------------------------------------------------------------
+
+long long
+Histogram::HighestIn(int bucket)
+{
+    int shift;
+
+    if (bucket < HistogramSubBuckets)
+	return bucket;
+    shift = bucket / HistogramSubBuckets - 1;
+    return ((long long) (HistogramSubBuckets
+			 + bucket % HistogramSubBuckets) << shift)
+	+ ((1LL << shift) - 1);
+}
+
+//----------------------------------------------------------------------
+// Histogram::Record
+// 	Add "value" to the histogram.  Negative values (which would only
+//	come from a clock going backwards) are counted as zero.
+//----------------------------------------------------------------------
+
+void
+Histogram::Record(long long value)
+{
+    if (value < 0)
+	value = 0;
+    if (count == 0 || value < min)
+	min = value;
+    if (value > max)
+	max = value;
+    count++;
+    sum += value;
+    buckets[BucketOf(value)]++;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Percentile
+// 	Return the value that "p" percent of the recorded values are at
+//	or below: the top of the bucket it falls in, but never more than
+//	the largest value recorded.
+//----------------------------------------------------------------------
+
+long long
+Histogram::Percentile(double p)
+{
+    long long want = (long long) (count * p / 100.0 + 0.5);
+    long long seen = 0;
+
+    if (count == 0)
+	return 0;
+    if (want < 1)
+	want = 1;
+    for (int i = 0; i < HistogramBuckets; i++) {
+	seen += buckets[i];
+	if (seen >= want) {
+	    long long value = HighestIn(i);
+	    return (value < max) ? value : max;
+	}
+    }
+    return max;
+}
+
+//----------------------------------------------------------------------
+// ThreadMetrics::Reset
+// 	Start counting for a new thread called "threadName".
+//----------------------------------------------------------------------
+
+void
+ThreadMetrics::Reset(char *threadName)
+{
+    strncpy(name, (threadName != NULL) ? threadName : "", sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    live = FALSE;
+    readySince = -1;
+    switches = readyWaitTicks = 0;
+    syscalls = pageFaults = tlbMisses = userTicks = 0;
+}
+
+//----------------------------------------------------------------------
+// Metrics::Metrics
+// 	Initialize every counter and histogram to empty, and arrange for
+//	SIGUSR1 to ask for a snapshot.
+//
+//	"snapshotFile" -- where snapshots are written, or NULL for none
+//	"snapshotInterval" -- ticks between snapshots, or 0 for just the
+//		last one
+//----------------------------------------------------------------------
+
+Metrics::Metrics(char *snapshotFile, int snapshotInterval)
+{
+    int len = (snapshotFile != NULL) ? strlen(snapshotFile) : 0;
+
+    for (int i = 0; i < NumMetricCounters; i++)
+	counters[i] = 0;
+    threads = new ThreadMetrics[MAX_THREAD_ID];
+    for (int i = 0; i < MAX_THREAD_ID; i++)
+	threads[i].Reset(NULL);
+    retired.Reset("retired");
+
+    fileName = snapshotFile;
+    csv = (len > 4 && !strcmp(fileName + len - 4, ".csv"));
+    interval = snapshotInterval;
+    nextSnapshot = interval;
+    snapshots = 0;
+    if (fileName != NULL)
+	CallOnUserSignal(RequestSnapshot);
+}
+
+//----------------------------------------------------------------------
+// Metrics::~Metrics
+// 	Write a last snapshot, and de-allocate the per-thread counts.
+//----------------------------------------------------------------------
+
+Metrics::~Metrics()
+{
+    Snapshot();
+    delete [] threads;
+}
+
+//----------------------------------------------------------------------
+// Metrics::ForThread, Metrics::ForCurrentThread
+// 	Return the counts kept for the thread with ID "id", or for the
+//	thread now running.
+//----------------------------------------------------------------------
+
+ThreadMetrics *
+Metrics::ForThread(int id)
+{
+    ASSERT(id >= 0 && id < MAX_THREAD_ID);
+    return &threads[id];
+}
+
+ThreadMetrics *
+Metrics::ForCurrentThread()
+{
+    return ForThread(currentThread->get_threadID());
+}
+
+//----------------------------------------------------------------------
+// Metrics::NewThread
+// 	A thread called "name" has been given ID "id".  Whatever was
+//	counted for the last thread with that ID goes into the retired
+//	totals, and counting starts again.
+//----------------------------------------------------------------------
+
+void
+Metrics::NewThread(int id, char *name)
+{
+    ThreadMetrics *t = ForThread(id);
+
+    retired.switches += t->switches;
+    retired.readyWaitTicks += t->readyWaitTicks;
+    retired.syscalls += t->syscalls;
+    retired.pageFaults += t->pageFaults;
+    retired.tlbMisses += t->tlbMisses;
+    retired.userTicks += t->userTicks;
+    t->Reset(name);
+    t->live = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Metrics::ThreadDone
+// 	The thread with ID "id" has been deleted; its counts are kept
+//	until the ID is reused.
+//----------------------------------------------------------------------
+
+void
+Metrics::ThreadDone(int id)
+{
+    ForThread(id)->live = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Metrics::Poll
+// 	Called once a tick: write a snapshot if SIGUSR1 has arrived, or
+//	if a periodic one is due.
+//----------------------------------------------------------------------
+
+void
+Metrics::Poll()
+{
+    if (snapshotRequested
+	    || (interval > 0 && stats->totalTicks >= nextSnapshot)) {
+	snapshotRequested = 0;
+	nextSnapshot = stats->totalTicks + interval;
+	Snapshot();
+    }
+}
+
+//----------------------------------------------------------------------
+// Metrics::Snapshot
+// 	Append the current value of every metric to the file (the first
+//	snapshot starts the file over).
+//----------------------------------------------------------------------
+
+void
+Metrics::Snapshot()
+{
+    FILE *f;
+
+    if (fileName == NULL)
+	return;
+    f = fopen(fileName, (snapshots == 0) ? "w" : "a");
+    if (f == NULL) {
+	perror(fileName);
+	return;
+    }
+    if (csv)
+	WriteCSV(f);
+    else
+	WriteJSON(f);
+    fclose(f);
+    snapshots++;
+}
+
+//----------------------------------------------------------------------
+// Metrics::WriteJSON
+// 	Write one snapshot as a single line of JSON.
+//----------------------------------------------------------------------
+
+void
+Metrics::WriteJSON(FILE *f)
+{
+    bool first = TRUE;
+
+    fprintf(f, "{\"ticks\": %d, \"stats\": {\"idle_ticks\": %d, "
+	    "\"system_ticks\": %d, \"user_ticks\": %d, \"disk_reads\": %d, "
+	    "\"disk_writes\": %d, \"tlb_hits\": %d, \"tlb_misses\": %d, "
+	    "\"packets_sent\": %d, \"packets_recvd\": %d}, \"counters\": {",
+	    stats->totalTicks, stats->idleTicks, stats->systemTicks,
+	    stats->userTicks, stats->numDiskReads, stats->numDiskWrites,
+	    stats->numTLBHits, stats->numTLBMisses, stats->numPacketsSent,
+	    stats->numPacketsRecvd);
+    for (int i = 0; i < NumMetricCounters; i++)
+	fprintf(f, "%s\"%s\": %lld", (i == 0) ? "" : ", ", counterNames[i],
+		counters[i]);
+    fprintf(f, "}, \"histograms\": {");
+    for (int i = 0; i < NumMetricHistograms; i++) {
+	Histogram *h = &histograms[i];
+
+	fprintf(f, "%s\"%s\": {\"count\": %lld, \"sum\": %lld, "
+		"\"min\": %lld, \"max\": %lld, \"p50\": %lld, \"p90\": %lld, "
+		"\"p99\": %lld, \"p999\": %lld}", (i == 0) ? "" : ", ",
+		histogramNames[i], h->count, h->sum, h->min, h->max,
+		h->Percentile(50), h->Percentile(90), h->Percentile(99),
+		h->Percentile(99.9));
+    }
+    fprintf(f, "}, \"threads\": [");
+    for (int i = -1; i < MAX_THREAD_ID; i++) {
+	ThreadMetrics *t = (i < 0) ? &retired : &threads[i];
+
+	if (i >= 0 && !t->live && t->switches == 0 && t->userTicks == 0)
+	    continue;
+	fprintf(f, "%s{\"id\": %d, \"name\": \"%s\", \"live\": %s, "
+		"\"switches\": %lld, \"ready_wait_ticks\": %lld, "
+		"\"syscalls\": %lld, \"page_faults\": %lld, "
+		"\"tlb_misses\": %lld, \"user_ticks\": %lld}",
+		first ? "" : ", ", i, t->name, t->live ? "true" : "false",
+		t->switches, t->readyWaitTicks, t->syscalls, t->pageFaults,
+		t->tlbMisses, t->userTicks);
+	first = FALSE;
+    }
+    fprintf(f, "]}\n");
+}
+
+//----------------------------------------------------------------------
+// Metrics::WriteCSV
+// 	Write one snapshot as CSV rows of "ticks,scope,id,metric,value";
+//	the first snapshot starts with the header.  Thread -1 holds the
+//	totals for threads whose IDs have been reused.
+//----------------------------------------------------------------------
+
+void
+Metrics::WriteCSV(FILE *f)
+{
+    int now = stats->totalTicks;
+
+    if (snapshots == 0)
+	fprintf(f, "ticks,scope,id,metric,value\n");
+    fprintf(f, "%d,stats,,idle_ticks,%d\n", now, stats->idleTicks);
+    fprintf(f, "%d,stats,,system_ticks,%d\n", now, stats->systemTicks);
+    fprintf(f, "%d,stats,,user_ticks,%d\n", now, stats->userTicks);
+    fprintf(f, "%d,stats,,tlb_hits,%d\n", now, stats->numTLBHits);
+    fprintf(f, "%d,stats,,tlb_misses,%d\n", now, stats->numTLBMisses);
+    for (int i = 0; i < NumMetricCounters; i++)
+	fprintf(f, "%d,counter,,%s,%lld\n", now, counterNames[i], counters[i]);
+    for (int i = 0; i < NumMetricHistograms; i++) {
+	Histogram *h = &histograms[i];
+
+	fprintf(f, "%d,histogram,%s,count,%lld\n", now, histogramNames[i],
+		h->count);
+	fprintf(f, "%d,histogram,%s,sum,%lld\n", now, histogramNames[i],
+		h->sum);
+	fprintf(f, "%d,histogram,%s,max,%lld\n", now, histogramNames[i],
+		h->max);
+	fprintf(f, "%d,histogram,%s,p50,%lld\n", now, histogramNames[i],
+		h->Percentile(50));
+	fprintf(f, "%d,histogram,%s,p99,%lld\n", now, histogramNames[i],
+		h->Percentile(99));
+    }
+    for (int i = -1; i < MAX_THREAD_ID; i++) {
+	ThreadMetrics *t = (i < 0) ? &retired : &threads[i];
+
+	if (i >= 0 && !t->live && t->switches == 0 && t->userTicks == 0)
+	    continue;
+	fprintf(f, "%d,thread,%d,switches,%lld\n", now, i, t->switches);
+	fprintf(f, "%d,thread,%d,ready_wait_ticks,%lld\n", now, i,
+		t->readyWaitTicks);
+	fprintf(f, "%d,thread,%d,syscalls,%lld\n", now, i, t->syscalls);
+	fprintf(f, "%d,thread,%d,page_faults,%lld\n", now, i, t->pageFaults);
+	fprintf(f, "%d,thread,%d,tlb_misses,%lld\n", now, i, t->tlbMisses);
+	fprintf(f, "%d,thread,%d,user_ticks,%lld\n", now, i, t->userTicks);
+    }
+}
+
+//----------------------------------------------------------------------
+// Metrics::Print
+// 	Print a line for each latency that was recorded, when Nachos
+//	halts.
+//----------------------------------------------------------------------
+
+void
+Metrics::Print()
+{
+    for (int i = 0; i < NumMetricHistograms; i++) {
+	Histogram *h = &histograms[i];
+
+	if (h->count == 0)
+	    continue;
+	printf("Latency %s: count %lld, mean %lld, p50 %lld, p99 %lld, "
+	       "max %lld\n", histogramNames[i], h->count, h->sum / h->count,
+	       h->Percentile(50), h->Percentile(99), h->max);
+    }
+}
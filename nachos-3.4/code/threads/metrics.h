@@ -0,0 +1,146 @@
+// metrics.h
+//	Data structures for measuring where the time goes in Nachos:
+//	64-bit event counters, latency histograms, and the same counts
+//	broken down by thread.
+//
+//	Statistics (stats.h) keeps the totals the machine emulation has
+//	always kept; the metrics here add what totals can't show -- how
+//	long a disk request, a page fault, a system call or a wait on the
+//	ready list took, as a distribution, and who was responsible.
+//
+//	The histograms are log-linear, as in HdrHistogram: each power of
+//	two is split into HistogramSubBuckets equal buckets, so a value is
+//	kept to within 1/HistogramSubBuckets of itself, whatever its size,
+//	in a fixed amount of space.
+//
+//	A user program's address space belongs to the one thread running
+//	it, so its page faults, TLB misses, system calls and user ticks are
+//	kept with that thread, by thread ID.  When a thread ID is reused,
+//	the old thread's counts are folded into the totals and forgotten.
+//
+//	Metrics are always collected.  With "-metrics <file> [interval]",
+//	a snapshot is written to the file when Nachos halts, when it gets
+//	SIGUSR1, and every "interval" ticks (if given): one JSON object
+//	per line, or CSV if the file name ends in ".csv".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The events that are counted
+enum MetricCounter {
+    CountContextSwitches,	// threads switched to
+    CountInterrupts,		// interrupt handlers called
+    CountSyscalls,		// system calls made
+    CountPageFaults,		// pages brought into memory
+    CountTLBMisses,		// TLB entries loaded
+    CountDiskRequests,		// disk reads and writes started
+    NumMetricCounters
+};
+
+// The latencies that are recorded, all in simulated ticks
+enum MetricHistogram {
+    LatencyDisk,		// disk request to disk interrupt
+    LatencyPageFault,		// page fault to the page being in memory
+    LatencySyscall,		// system call to its return
+    LatencyReadyWait,		// put on the ready list to running
+    NumMetricHistograms
+};
+
+#define HistogramSubBuckets	8	// buckets per power of two
+#define HistogramSubBits	3	// log2(HistogramSubBuckets)
+#define HistogramBuckets	(64 * HistogramSubBuckets)
+
+// The following class defines a histogram of non-negative values.
+
+class Histogram {
+  public:
+    Histogram();			// An empty histogram
+
+    void Record(long long value);	// Add a value
+    long long Percentile(double p);	// The value that "p" percent of
+					// the recorded values are at or
+					// below (to within a bucket)
+    void Reset();			// Forget every value
+
+    long long count;			// Values recorded
+    long long sum;			// ... their total
+    long long min, max;		// ... the smallest and largest
+
+  private:
+    long long buckets[HistogramBuckets];
+
+    static int BucketOf(long long value);
+    static long long HighestIn(int bucket);	// Largest value that
+						// falls in "bucket"
+};
+
+// The following class defines the counts kept for one thread (and the
+// address space it runs, if any).
+
+class ThreadMetrics {
+  public:
+    char name[32];		// The thread's name, when it was created
+    bool live;			// Is there a thread with this ID?
+    int readySince;		// When it was put on the ready list
+    long long switches;		// Times it was switched to
+    long long readyWaitTicks;	// Time spent on the ready list
+    long long syscalls;		// System calls it made
+    long long pageFaults;	// Page faults in its address space
+    long long tlbMisses;	// TLB misses in its address space
+    long long userTicks;	// User instructions it executed
+
+    void Reset(char *threadName);
+};
+
+// The following class defines the registry of all the metrics, and
+// where (and when) snapshots of them are written.
+
+class Metrics {
+  public:
+    Metrics(char *snapshotFile, int snapshotInterval);
+				// Start collecting; snapshots go to
+				// "snapshotFile" (if not NULL) every
+				// "snapshotInterval" ticks (if positive)
+    ~Metrics();			// Write a last snapshot, and stop
+
+    void Count(MetricCounter which, long long n = 1)
+	{ counters[which] += n; }
+    void RecordLatency(MetricHistogram which, long long ticks)
+	{ histograms[which].Record(ticks); }
+    ThreadMetrics *ForThread(int id);	// The counts for thread "id"
+    ThreadMetrics *ForCurrentThread();	// ... for the running thread
+
+    void NewThread(int id, char *name);	// A thread got ID "id"
+    void ThreadDone(int id);		// Thread "id" was deleted
+
+    void Snapshot();		// Write the metrics to the file
+    void Poll();		// Write a snapshot, if SIGUSR1 arrived
+				// or one is due; called every tick
+    void Print();		// Print the latencies, at halt
+
+  private:
+    long long counters[NumMetricCounters];
+    Histogram histograms[NumMetricHistograms];
+    ThreadMetrics *threads;	// One per thread ID
+    ThreadMetrics retired;	// Threads whose IDs have been reused
+
+    char *fileName;		// Where snapshots go, or NULL
+    bool csv;			// Write CSV rather than JSON lines?
+    int interval;		// Ticks between periodic snapshots
+    int nextSnapshot;		// When the next one is due
+    int snapshots;		// Snapshots written so far
+
+    void WriteJSON(FILE *f);
+    void WriteCSV(FILE *f);
+};
+
+extern Metrics *metrics;	// the registry
+
+#endif // METRICS_H
@@ -0,0 +1,209 @@
+// pipe.cc
+//	Routines to manage pipes.
+//
+// 	Implemented in "monitor"-style, like SynchList: each procedure
+//	holds the pipe's lock, and uses condition variables to wait for
+//	data or for room.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pipe.h"
+
+//----------------------------------------------------------------------
+// PipeBuffer::PipeBuffer
+// 	Initialize an empty pipe, with one read end and one write end.
+//
+//	"capacity" -- how many bytes the pipe can hold
+//----------------------------------------------------------------------
+
+PipeBuffer::PipeBuffer(int capacity)
+{
+    size = capacity;
+    buffer = new char[size];
+    head = count = 0;
+    readers = writers = 1;
+    lock = new Lock("pipe lock");
+    notEmpty = new Condition("pipe not empty");
+    notFull = new Condition("pipe not full");
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::~PipeBuffer
+// 	De-allocate the pipe; nobody may be waiting on it.
+//----------------------------------------------------------------------
+
+PipeBuffer::~PipeBuffer()
+{
+    delete [] buffer;
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Read
+// 	Read up to "numBytes" bytes from the pipe into "into".  Wait until
+//	there is at least one byte, unless no write end is open any more.
+//	Return the number of bytes read; 0 means end of file.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Read(char *into, int numBytes)
+{
+    int done = 0;
+
+    lock->Acquire();
+    while (count == 0 && writers > 0)
+	notEmpty->Wait(lock);
+    while (done < numBytes && count > 0) {
+	into[done++] = buffer[head];
+	head = (head + 1) % size;
+	count--;
+    }
+    if (done > 0)
+	notFull->Broadcast(lock);	// wake up writers waiting for room
+    lock->Release();
+    return done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Write
+// 	Write "numBytes" bytes from "from" into the pipe, waiting for
+//	room as often as need be.  Stop early if every read end is closed.
+//	Return the number of bytes written, or -1 if there was nobody to
+//	read any of them.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Write(char *from, int numBytes)
+{
+    int done = 0;
+
+    lock->Acquire();
+    while (done < numBytes && readers > 0) {
+	if (count == size) {
+	    notFull->Wait(lock);
+	    continue;
+	}
+	while (done < numBytes && count < size) {
+	    buffer[(head + count) % size] = from[done++];
+	    count++;
+	}
+	notEmpty->Broadcast(lock);	// wake up readers waiting for data
+    }
+    lock->Release();
+    return (done == 0 && numBytes > 0) ? -1 : done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Open, PipeBuffer::Close
+// 	Count the ends of the pipe that are open.  When the last end of
+//	one kind is closed, wake up everyone waiting on the other kind,
+//	so they can see end of file (or that nobody will read).
+//
+//	"writeEnd" -- is it a write end rather than a read end?
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::Open(bool writeEnd)
+{
+    lock->Acquire();
+    if (writeEnd)
+	writers++;
+    else
+	readers++;
+    lock->Release();
+}
+
+void
+PipeBuffer::Close(bool writeEnd)
+{
+    lock->Acquire();
+    if (writeEnd) {
+	ASSERT(writers > 0);
+	if (--writers == 0)
+	    notEmpty->Broadcast(lock);
+    } else {
+	ASSERT(readers > 0);
+	if (--readers == 0)
+	    notFull->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// PipeTable::PipeTable
+// 	Initialize an empty table of pipes.
+//----------------------------------------------------------------------
+
+PipeTable::PipeTable()
+{
+    for (int i = 0; i < MaxPipes; i++)
+	pipes[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::~PipeTable
+// 	De-allocate every pipe still in the table.
+//----------------------------------------------------------------------
+
+PipeTable::~PipeTable()
+{
+    for (int i = 0; i < MaxPipes; i++)
+	delete pipes[i];
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Create
+// 	Make a new pipe in the first free slot.  Return its number, or
+//	-1 if every slot is in use.
+//----------------------------------------------------------------------
+
+int
+PipeTable::Create()
+{
+    for (int i = 0; i < MaxPipes; i++)
+	if (pipes[i] == NULL) {
+	    pipes[i] = new PipeBuffer();
+	    return i;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Get
+// 	Return pipe number "id", or NULL if there is no such pipe.
+//----------------------------------------------------------------------
+
+PipeBuffer *
+PipeTable::Get(int id)
+{
+    if (id < 0 || id >= MaxPipes)
+	return NULL;
+    return pipes[id];
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Close
+// 	Close one end of pipe "id", and free the pipe once every end of
+//	it is closed.
+//
+//	"writeEnd" -- is it a write end rather than a read end?
+//----------------------------------------------------------------------
+
+void
+PipeTable::Close(int id, bool writeEnd)
+{
+    PipeBuffer *pipe = Get(id);
+
+    if (pipe == NULL)
+	return;
+    pipe->Close(writeEnd);
+    if (pipe->IsClosed()) {
+	delete pipe;
+	pipes[id] = NULL;
+    }
+}
@@ -0,0 +1,78 @@
+// pipe.h
+//	Data structures for pipes between threads (and user programs).
+//
+//	A pipe is a fixed-size ring buffer kept in kernel memory, so
+//	data sent through it never goes near the disk.  A reader waits
+//	while the pipe is empty, and a writer while it is full.  When
+//	every write end has been closed, a reader gets what is left and
+//	then end of file; when every read end has been closed, a write
+//	fails.
+//
+//	User programs name pipes by OpenFileIds (see syscall.h); the
+//	pipes themselves are kept in a table, by number.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define PipeBufferSize	512	// bytes a pipe holds before writers wait
+#define MaxPipes	16	// pipes that can be open at once
+
+// The following class defines a pipe.  It starts out with one read
+// end and one write end open; Open adds another (say, a duplicated
+// OpenFileId), Close takes one away.  (It isn't called "Pipe", since
+// that is the name of the system call, in syscall.h.)
+
+class PipeBuffer {
+  public:
+    PipeBuffer(int capacity = PipeBufferSize);
+					// initialize an empty pipe
+    ~PipeBuffer();			// de-allocate the pipe
+
+    int Read(char *into, int numBytes);	// read up to "numBytes", waiting
+					// until there is at least one;
+					// return 0 at end of file
+    int Write(char *from, int numBytes);// write all "numBytes", waiting
+					// for room; return how many were
+					// written, or -1 if nobody can
+					// ever read them
+
+    void Open(bool writeEnd);		// another end is open
+    void Close(bool writeEnd);		// an end was closed
+    bool IsClosed() { return readers == 0 && writers == 0; }
+
+  private:
+    char *buffer;			// the ring buffer
+    int size;				// its size
+    int head;				// where the oldest byte is
+    int count;				// how many bytes are in it
+    int readers, writers;		// ends still open
+    Lock *lock;				// only one thread in at a time
+    Condition *notEmpty;		// readers wait here
+    Condition *notFull;			// writers wait here
+};
+
+// The following class defines the table of pipes in use.
+
+class PipeTable {
+  public:
+    PipeTable();			// initialize an empty table
+    ~PipeTable();			// de-allocate every pipe
+
+    int Create();			// make a new pipe; return its
+					// number, or -1 if the table is full
+    PipeBuffer *Get(int id);			// the pipe numbered "id", or NULL
+    void Close(int id, bool writeEnd);	// an end of pipe "id" was closed;
+					// free the pipe once both are
+
+  private:
+    PipeBuffer *pipes[MaxPipes];		// the pipes, NULL if unused
+};
+
+#endif // PIPE_H
@@ -4,7 +4,8 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor).  On a multiprocessor, each CPU
+//	has a ready list of its own, guarded by a spinlock (cf. smp.cc).
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would
@@ -46,6 +47,8 @@ Scheduler::~Scheduler()
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
+//	On a multiprocessor, it goes on the ready list of one of the
+//	CPUs, which may not be this one.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -56,8 +59,12 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
+    metrics->ForThread(thread->get_threadID())->readySince = stats->totalTicks;
     // insert the ready thread into the readyList according to its static priority
-    readyList->SortedInsert((void*)thread, thread->get_StaticPro());
+    if (smp == NULL)
+	readyList->SortedInsert((void*)thread, thread->get_StaticPro());
+    else if (smp->Ready(thread) != smp->Current())
+	return;				// it doesn't compete with this CPU's
     if (thread->get_StaticPro() < currentThread->get_StaticPro()){
         //printf("grab\n");
         currentThread->Yield();
@@ -75,6 +82,8 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
+    if (smp != NULL)
+	return smp->NextToRun();
     return (Thread *)readyList->Remove();
 }
 
@@ -96,6 +105,7 @@ void
 Scheduler::Run (Thread *nextThread)
 {
     Thread *oldThread = currentThread;
+    ThreadMetrics *next = metrics->ForThread(nextThread->get_threadID());
 
 #ifdef USER_PROGRAM			// ignore until running user programs
     if (currentThread->space != NULL) {	// if this thread is a user program,
@@ -109,12 +119,28 @@ Scheduler::Run (Thread *nextThread)
 
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+    if (smp != NULL)
+	smp->Dispatched(nextThread);	    // ... on this CPU
     currentThread->set_OnCpuTime();
 
     //printf("get on cpu time::::%d\n",currentThread->get_OnCpuTime());
 
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
+    TRACE_EVENT(TraceSwitch, oldThread->get_threadID(),
+		nextThread->get_threadID());
+    metrics->Count(CountContextSwitches);
+    next->switches++;
+    if (next->readySince >= 0) {		// time on the ready list
+	int waited = stats->totalTicks - next->readySince;
+
+	if (waited < 0)				// readied by a CPU whose
+	    waited = 0;				// clock was ahead of this one
+
+	next->readyWaitTicks += waited;
+	metrics->RecordLatency(LatencyReadyWait, waited);
+	next->readySince = -1;
+    }
     // printf("Switching from thread %d to thread %d \n",
     //  oldThread->get_threadID(), nextThread->get_threadID());
 
@@ -153,6 +179,10 @@ Scheduler::Run (Thread *nextThread)
 void
 Scheduler::Print()
 {
+    if (smp != NULL) {
+	smp->Print();
+	return;
+    }
     printf("Ready list contents:\n");
     readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
 }
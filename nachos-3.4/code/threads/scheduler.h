@@ -30,7 +30,8 @@ class Scheduler {
     
   private:
     List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+				// but not running (on a multiprocessor,
+				// each CPU has its own instead)
 };
 
 #endif // SCHEDULER_H
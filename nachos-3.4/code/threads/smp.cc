@@ -0,0 +1,420 @@
+// smp.cc
+//	Routines to simulate a symmetric multiprocessor: to place threads
+//	on the CPUs' ready queues, to take turns running the CPUs, and to
+//	keep their clocks.
+//
+//	Switching CPUs is much like a context switch, except that the
+//	thread being left stays running (on its CPU): it is just not the
+//	one the host is running any more.  It resumes when some other CPU
+//	switches back to its CPU.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// IdleLoop
+// 	What a CPU runs when it has nothing else to do: run the next
+//	thread, if there is one for this CPU; otherwise let the other
+//	CPUs run, or wait for an interrupt.
+//
+//	The idle thread is never on a ready queue; Thread::Sleep switches
+//	to it, and it switches away again as soon as it finds a thread.
+//
+//	"which" is the CPU it runs on.
+//----------------------------------------------------------------------
+
+static void
+IdleLoop(int which)
+{
+    for (;;) {
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	Thread *nextThread = scheduler->FindNextToRun();
+
+	if (nextThread != NULL) {
+	    currentThread->setStatus(BLOCKED);
+	    scheduler->Run(nextThread);	// returns when this CPU is idle
+	} else
+	    smp->Idle();
+	(void) interrupt->SetLevel(oldLevel);
+    }
+}
+
+//----------------------------------------------------------------------
+// CPU::CPU
+// 	Initialize a CPU, with nothing to run.
+//
+//	"cpuId" -- its number, from 0
+//----------------------------------------------------------------------
+
+CPU::CPU(int cpuId)
+{
+    id = cpuId;
+    current = idleThread = NULL;
+    readyList = new List;
+    queueLock = new SpinLock("ready queue");
+    locksHeld = 0;
+    clock = sliceStart = stats->totalTicks;
+    status = SystemMode;
+#ifdef USER_PROGRAM
+    for (int i = 0; i < NumTotalRegs; i++)
+	registers[i] = 0;
+    tlb = NULL;
+    tlbTop = 0;
+#endif
+    idleTicks = switches = migrations = steals = 0;
+}
+
+//----------------------------------------------------------------------
+// CPU::~CPU
+// 	De-allocate a CPU.  Its threads are left alone; Nachos is halting.
+//----------------------------------------------------------------------
+
+CPU::~CPU()
+{
+    delete readyList;
+    delete queueLock;
+#ifdef USER_PROGRAM
+    if (machine == NULL || tlb != machine->tlb)
+	delete [] tlb;
+#endif
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Multiprocessor
+// 	Start up the CPUs.  The current thread is running on the first;
+//	the others start out idle.
+//
+//	"howMany" -- how many CPUs there are
+//	"slice" -- how long (in ticks) each runs, before another may
+//----------------------------------------------------------------------
+
+Multiprocessor::Multiprocessor(int howMany, int slice)
+{
+    ASSERT(howMany > 1 && howMany <= MaxCPUs && slice > 0);
+    numCPUs = howMany;
+    quantum = slice;
+    current = 0;
+    for (int i = 0; i < MAX_THREAD_ID; i++)
+	lastCPU[i] = -1;
+
+    for (int i = 0; i < numCPUs; i++) {
+	char *name = new char[16];
+
+	sprintf(name, "idle %d", i);
+	cpus[i] = new CPU(i);
+	cpus[i]->idleThread = new Thread(name, MAX_PRIORITY);
+	cpus[i]->idleThread->Prepare(IdleLoop, (void *) i);
+	cpus[i]->idleThread->setStatus(RUNNING);
+	cpus[i]->current = cpus[i]->idleThread;
+    }
+    cpus[0]->idleThread->setStatus(BLOCKED);
+    cpus[0]->current = currentThread;
+    lastCPU[currentThread->get_threadID()] = 0;
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::~Multiprocessor
+// 	De-allocate the CPUs.
+//----------------------------------------------------------------------
+
+Multiprocessor::~Multiprocessor()
+{
+    for (int i = 0; i < numCPUs; i++)
+	delete cpus[i];
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::CatchUp
+// 	"cpu" is about to be given a thread.  If it had nothing to run,
+//	its clock stopped when it went idle; start it again from now.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::CatchUp(CPU *cpu)
+{
+    if (cpu != cpus[current] && !HasWork(cpu)
+				&& cpu->clock < stats->totalTicks) {
+	cpu->idleTicks += stats->totalTicks - cpu->clock;
+	cpu->clock = stats->totalTicks;
+    }
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Ready
+// 	Put "thread" on the ready queue of the CPU it should run on: an
+//	idle CPU if there is one (where it last ran, if that is idle),
+//	else the CPU it last ran on, else (a new thread) the CPU with the
+//	fewest threads waiting.  Return that CPU.
+//
+//	Called with interrupts off.
+//----------------------------------------------------------------------
+
+CPU *
+Multiprocessor::Ready(Thread *thread)
+{
+    int last = lastCPU[thread->get_threadID()];
+    CPU *cpu = NULL;
+
+    if (last >= 0 && !HasWork(cpus[last]))
+	cpu = cpus[last];
+    else if (!HasWork(cpus[current]))
+	cpu = cpus[current];
+    for (int i = 0; i < numCPUs && cpu == NULL; i++)
+	if (!HasWork(cpus[i]))
+	    cpu = cpus[i];
+    if (cpu == NULL && last >= 0)
+	cpu = cpus[last];
+    if (cpu == NULL) {
+	cpu = cpus[current];
+	for (int i = 0; i < numCPUs; i++)
+	    if (cpus[i]->readyList->NumInList() < cpu->readyList->NumInList())
+		cpu = cpus[i];
+    }
+
+    CatchUp(cpu);
+    cpu->queueLock->Acquire();
+    cpu->readyList->SortedInsert((void *) thread, thread->get_StaticPro());
+    cpu->queueLock->Release();
+    return cpu;
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::NextToRun
+// 	Take the next thread off this CPU's ready queue.  If there is
+//	none, take one from the longest queue of a busy CPU (an idle CPU
+//	will run its own threads).  Return NULL if there is nothing to
+//	take.
+//
+//	Called with interrupts off.
+//----------------------------------------------------------------------
+
+Thread *
+Multiprocessor::NextToRun()
+{
+    CPU *cpu = cpus[current], *victim = NULL;
+    Thread *thread;
+
+    cpu->queueLock->Acquire();
+    thread = (Thread *) cpu->readyList->Remove();
+    cpu->queueLock->Release();
+    if (thread != NULL)
+	return thread;
+
+    for (int i = 0; i < numCPUs; i++) {
+	CPU *other = cpus[i];
+
+	if (other == cpu || other->current == other->idleThread
+			|| other->readyList->IsEmpty())
+	    continue;
+	if (victim == NULL || other->readyList->NumInList()
+				> victim->readyList->NumInList())
+	    victim = other;
+    }
+    if (victim == NULL)
+	return NULL;
+    victim->queueLock->Acquire();
+    thread = (Thread *) victim->readyList->Remove();
+    victim->queueLock->Release();
+    cpu->steals++;
+    DEBUG('t', "CPU %d takes thread \"%s\" from CPU %d\n", cpu->id,
+	  thread->getName(), victim->id);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Dispatched
+// 	Note that "thread" is now running on this CPU (called by
+//	Scheduler::Run).
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Dispatched(Thread *thread)
+{
+    CPU *cpu = cpus[current];
+    int id = thread->get_threadID();
+
+    ASSERT(cpu->locksHeld == 0);	// no sleeping with a spinlock
+    cpu->current = thread;
+    if (thread == cpu->idleThread)
+	return;
+    cpu->switches++;
+    if (lastCPU[id] >= 0 && lastCPU[id] != cpu->id)
+	cpu->migrations++;
+    lastCPU[id] = cpu->id;
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Behind
+// 	Return the CPU with something to run whose clock is furthest
+//	behind, or NULL if none has anything.  The running CPU is looked
+//	at last, so CPUs that are level take turns.
+//
+//	"others" -- if TRUE, leave out the running CPU
+//----------------------------------------------------------------------
+
+CPU *
+Multiprocessor::Behind(bool others)
+{
+    CPU *behind = NULL;
+
+    cpus[current]->clock = stats->totalTicks;
+    for (int i = 1; i <= numCPUs; i++) {
+	CPU *cpu = cpus[(current + i) % numCPUs];
+
+	if (!HasWork(cpu) || (others && cpu == cpus[current]))
+	    continue;
+	if (behind == NULL || cpu->clock < behind->clock)
+	    behind = cpu;
+    }
+    return behind;
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Tick
+// 	Called by Interrupt::OneTick, with interrupts off.  Once the
+//	running CPU has had its quantum, run the CPU that is furthest
+//	behind, which may be this one again.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Tick()
+{
+    CPU *cpu = cpus[current], *next;
+
+    if (stats->totalTicks - cpu->sliceStart < quantum)
+	return;
+    next = Behind(FALSE);
+    if (next == NULL || next == cpu)
+	cpu->sliceStart = stats->totalTicks;
+    else
+	SwitchTo(next);
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Idle
+// 	Called by the idle thread, with interrupts off, when there is
+//	nothing for this CPU to run.  Let the other CPUs run, if they
+//	have something to; otherwise, nothing will happen until the next
+//	interrupt, so wait for it (Interrupt::Idle halts if there are
+//	none).
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Idle()
+{
+    CPU *cpu = cpus[current];
+    CPU *next = Behind(TRUE);
+    int start = stats->totalTicks;
+
+    if (next != NULL) {
+	SwitchTo(next);
+	return;
+    }
+    interrupt->Idle();
+    cpu->idleTicks += stats->totalTicks - start;
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::SwitchTo
+// 	Stop running this CPU, and run "next" instead: save this CPU's
+//	registers, TLB, mode and clock, load the next CPU's, and switch to
+//	the thread running on it.  Returns when some CPU switches back to
+//	this one.
+//
+//	Called with interrupts off, and no spinlocks held; this CPU's
+//	thread resumes the same way.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::SwitchTo(CPU *next)
+{
+    CPU *cpu = cpus[current];
+    Thread *oldThread = currentThread;
+
+    ASSERT(interrupt->getLevel() == IntOff && cpu->locksHeld == 0);
+    cpu->clock = stats->totalTicks;
+    cpu->status = interrupt->getStatus();
+#ifdef USER_PROGRAM
+    if (machine != NULL) {
+	for (int i = 0; i < NumTotalRegs; i++) {
+	    cpu->registers[i] = machine->registers[i];
+	    machine->registers[i] = next->registers[i];
+	}
+	cpu->tlb = machine->tlb;
+	cpu->tlbTop = machine->tlb_top;
+	if (cpu->tlb != NULL && next->tlb == NULL) {	// first time it runs
+	    next->tlb = new TranslationEntry[TLBSize];
+	    for (int i = 0; i < TLBSize; i++) {
+		next->tlb[i].valid = FALSE;
+		next->tlb[i].counter = 0;
+	    }
+	}
+	machine->tlb = next->tlb;
+	machine->tlb_top = next->tlbTop;
+    }
+#endif
+
+    current = next->id;
+    stats->totalTicks = next->sliceStart = next->clock;
+    interrupt->setStatus(next->status);
+    currentThread = next->current;
+#ifdef USER_PROGRAM
+    if (currentThread->space != NULL)
+	currentThread->space->RestoreState();
+#endif
+
+    DEBUG('t', "Switching from CPU %d to CPU %d, at time %d\n", cpu->id,
+	  next->id, stats->totalTicks);
+    SWITCH(oldThread, currentThread);
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Stop
+// 	Nachos is halting.  Stop every CPU's clock at the latest time any
+//	of them reached, which becomes the total time, and print how each
+//	CPU spent it.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Stop()
+{
+    int now = stats->totalTicks;
+
+    cpus[current]->clock = now;
+    for (int i = 0; i < numCPUs; i++)
+	if (cpus[i]->clock > now)
+	    now = cpus[i]->clock;
+    stats->totalTicks = now;
+
+    for (int i = 0; i < numCPUs; i++) {
+	CPU *cpu = cpus[i];
+	int busy;
+
+	cpu->idleTicks += now - cpu->clock;
+	cpu->clock = now;
+	busy = now - cpu->idleTicks;
+	printf("CPU %d: busy %d ticks (%d%%), idle %d, context switches %d, "
+	       "migrations %d, steals %d\n", i, busy,
+	       now ? (int) (100LL * busy / now) : 0, cpu->idleTicks,
+	       cpu->switches, cpu->migrations, cpu->steals);
+    }
+}
+
+//----------------------------------------------------------------------
+// Multiprocessor::Print
+// 	Print each CPU's running thread and ready queue.  For debugging.
+//----------------------------------------------------------------------
+
+void
+Multiprocessor::Print()
+{
+    for (int i = 0; i < numCPUs; i++) {
+	printf("CPU %d, running \"%s\", ready list contents:\n", i,
+	       cpus[i]->current->getName());
+	cpus[i]->readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    }
+}
@@ -0,0 +1,118 @@
+// smp.h
+//	Data structures for simulating a symmetric multiprocessor: several
+//	CPUs, each with its own registers, TLB, running thread, clock and
+//	queue of threads ready to run on it.
+//
+//	There is only one host thread, so the CPUs take turns: each runs
+//	for a quantum of simulated time, and then the CPU whose clock is
+//	furthest behind goes next.  Each CPU's clock only advances while it
+//	runs, so the CPUs run side by side in simulated time (to within a
+//	quantum), and a program with N threads can finish N times sooner.
+//	"stats->totalTicks" is the clock of the CPU that is running.
+//
+//	CPUs are only switched at a tick, with interrupts off on the CPU
+//	being left.  Kernel code between two ticks therefore runs without
+//	any other CPU running; what the CPUs share is protected by
+//	spinlocks (cf. SpinLock in synch.h), held with interrupts off.
+//
+//	A CPU with nothing to run runs its idle thread, which looks for a
+//	thread to take from the other CPUs' queues, lets the other CPUs
+//	run, or, if none of them has anything to do either, waits for the
+//	next interrupt.
+//
+//	Turned on with "-smp <cpus> [quantum]".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SMP_H
+#define SMP_H
+
+#include "copyright.h"
+#include "list.h"
+#include "thread.h"
+#include "synch.h"
+#include "interrupt.h"
+#ifdef USER_PROGRAM
+#include "machine.h"
+#endif
+
+#define MaxCPUs		16
+#define DefaultQuantum	20	// ticks a CPU runs before another may
+
+// The following class defines one simulated CPU.
+
+class CPU {
+  public:
+    CPU(int cpuId);
+    ~CPU();
+
+    int id;
+    Thread *current;		// The thread running on it
+    Thread *idleThread;		// ... when it has nothing else to do
+    List *readyList;		// Threads waiting to run on it
+    SpinLock *queueLock;	// Protects "readyList"
+    int locksHeld;		// Spinlocks it holds now
+
+    int clock;			// Its simulated time
+    int sliceStart;		// When it last started running
+    MachineStatus status;	// Kernel or user mode, while not running
+#ifdef USER_PROGRAM
+    int registers[NumTotalRegs];	// User registers, while not running
+    TranslationEntry *tlb;	// Its TLB (NULL if there are no TLBs)
+    int tlbTop;
+#endif
+
+    int idleTicks;		// Time it had nothing to run
+    int switches;		// Context switches on it
+    int migrations;		// ... to a thread that last ran elsewhere
+    int steals;			// Threads taken from other CPUs' queues
+};
+
+// The following class defines the multiprocessor.
+
+class Multiprocessor {
+  public:
+    Multiprocessor(int howMany, int slice);
+				// Start "howMany" CPUs, each running for
+				// "slice" ticks at a time, with the
+				// current thread running on the first
+    ~Multiprocessor();
+
+    CPU *Current() { return cpus[current]; }	// The CPU running now
+
+    CPU *Ready(Thread *thread);		// Put "thread" on the ready queue
+					// of a CPU; return the CPU
+    Thread *NextToRun();	// Take the next thread off this CPU's
+				// queue, or else a busy CPU's; NULL if
+				// there are none
+    void Dispatched(Thread *thread);	// "thread" is now running here
+    bool IsIdleThread(Thread *thread)
+	{ return thread == cpus[current]->idleThread; }
+
+    void Tick();		// Called each tick, with interrupts off:
+				// let another CPU run, if it is time to
+    void Idle();		// This CPU has nothing to run
+    void Stop();		// Nachos is halting: bring the clocks up
+				// to date, and print how the CPUs did
+    void Print();		// Print the ready queues
+
+  private:
+    CPU *cpus[MaxCPUs];
+    int numCPUs;
+    int current;		// Index of the CPU running now
+    int quantum;
+    int lastCPU[MAX_THREAD_ID];	// Where each thread last ran, or -1
+
+    bool HasWork(CPU *cpu)	// Does "cpu" have something to run?
+	{ return cpu->current != cpu->idleThread
+		 || !cpu->readyList->IsEmpty(); }
+    CPU *Behind(bool others);	// The CPU with work furthest behind
+    void CatchUp(CPU *cpu);	// Bring an idle CPU's clock up to now
+    void SwitchTo(CPU *next);	// Run "next" instead of this CPU
+};
+
+extern Multiprocessor *smp;	// NULL unless there is more than one CPU
+
+#endif // SMP_H
@@ -1,15 +1,15 @@
 // synch.cc
-//	Routines for synchronizing threads.  Three kinds of
-//	synchronization routines are defined here: semaphores, locks
-//   	and condition variables (the implementation of the last two
-//	are left to the reader).
+//	Routines for synchronizing threads.  Five kinds of
+//	synchronization routines are defined here: spinlocks, semaphores,
+//	locks, condition variables, and readers-writer locks (built out of
+//	a lock and two condition variables).
 //
 // Any implementation of a synchronization routine needs some
-// primitive atomic operation.  We assume Nachos is running on
-// a uniprocessor, and thus atomicity can be provided by
-// turning off interrupts.  While interrupts are disabled, no
+// primitive atomic operation.  On a uniprocessor, atomicity can be
+// provided by turning off interrupts.  While interrupts are disabled, no
 // context switch can occur, and thus the current thread is guaranteed
-// to hold the CPU throughout, until interrupts are reenabled.
+// to hold the CPU throughout, until interrupts are reenabled.  On a
+// multiprocessor, the other CPUs are kept out with a spinlock as well.
 //
 // Because some of these routines might be called with interrupts
 // already disabled (Semaphore::V for one), instead of turning
@@ -25,6 +25,67 @@
 #include "synch.h"
 #include "system.h"
 
+//----------------------------------------------------------------------
+// SpinLock::SpinLock
+// 	Initialize a spinlock, so that no CPU holds it.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+SpinLock::SpinLock(char* debugName)
+{
+    name = debugName;
+    holder = -1;
+}
+
+SpinLock::~SpinLock()
+{
+    ASSERT(holder == -1);
+}
+
+//----------------------------------------------------------------------
+// SpinLock::Acquire
+// 	Hold the lock, keeping the other CPUs away from what it protects.
+//	Interrupts must already be off, so this CPU can't be switched
+//	away from while it holds the lock.
+//
+//	A real CPU would spin while another held the lock.  Here, another
+//	CPU could only be holding it if it had gone to sleep, or let a
+//	tick go by, with it held -- which would be a bug.
+//----------------------------------------------------------------------
+
+void
+SpinLock::Acquire()
+{
+    CPU *cpu = (smp != NULL) ? smp->Current() : NULL;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    ASSERT(holder == -1);
+    holder = (cpu != NULL) ? cpu->id : 0;
+    if (cpu != NULL)
+	cpu->locksHeld++;
+}
+
+//----------------------------------------------------------------------
+// SpinLock::Release
+// 	Let go of the lock.  Only the CPU holding it may.
+//----------------------------------------------------------------------
+
+void
+SpinLock::Release()
+{
+    ASSERT(isHeldByCurrentCPU());
+    holder = -1;
+    if (smp != NULL)
+	smp->Current()->locksHeld--;
+}
+
+bool
+SpinLock::isHeldByCurrentCPU()
+{
+    return holder == ((smp != NULL) ? smp->Current()->id : 0);
+}
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
@@ -38,6 +99,7 @@ Semaphore::Semaphore(char* debugName, int initialValue)
     name = debugName;
     value = initialValue;
     queue = new List;
+    guard = new SpinLock(debugName);
 }
 
 //----------------------------------------------------------------------
@@ -49,6 +111,7 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 Semaphore::~Semaphore()
 {
     delete queue;
+    delete guard;
 }
 
 //----------------------------------------------------------------------
@@ -66,12 +129,14 @@ Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
 
+    guard->Acquire();				// and keep other CPUs out
     while (value == 0) { 			// semaphore not available
 	queue->Append((void *)currentThread);	// so go to sleep
-	currentThread->Sleep();
+	currentThread->Sleep(guard);
     }
     value--; 					// semaphore available,
 						// consume its value
+    guard->Release();
 
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -90,10 +155,12 @@ Semaphore::V()
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
+    guard->Acquire();
     thread = (Thread *)queue->Remove();
-    if (thread != NULL)	   // make thread ready, consuming the V immediately
-	scheduler->ReadyToRun(thread);
     value++;
+    guard->Release();
+    if (thread != NULL)	   // make thread ready, to consume the V in P()
+	scheduler->ReadyToRun(thread);
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -129,16 +196,19 @@ bool Lock::isHeldByCurrentThread(){
 Condition::Condition(char* debugName) {
 	name = debugName;
 	cQueue = new(List);
+	guard = new SpinLock(debugName);
 }
-Condition::~Condition() { delete cQueue; }
+Condition::~Condition() { delete cQueue; delete guard; }
 void Condition::Wait(Lock* conditionLock) {
 
 	IntStatus prevStatus = interrupt->SetLevel(IntOff);
 	ASSERT(conditionLock->isHeldByCurrentThread());
 
 	conditionLock->Release();
+	guard->Acquire();
 	cQueue->Append(currentThread);
-	currentThread->Sleep();
+	currentThread->Sleep(guard);
+	guard->Release();
 	// After being waken up, the lock is re-acquired.
 	conditionLock->Acquire();
 	(void)interrupt->SetLevel(prevStatus);
@@ -149,8 +219,10 @@ void Condition::Signal(Lock* conditionLock) {
 	IntStatus prevStatus = interrupt->SetLevel(IntOff);
 	ASSERT(conditionLock->isHeldByCurrentThread());
 
-	if(!cQueue->IsEmpty()){
-		Thread* next = (Thread*)cQueue->Remove();
+	guard->Acquire();
+	Thread* next = (Thread*)cQueue->Remove();
+	guard->Release();
+	if(next != NULL){
 		scheduler->ReadyToRun(next);
 	}
 	(void)interrupt->SetLevel(prevStatus);
@@ -167,3 +239,189 @@ void Condition::Broadcast(Lock* conditionLock) {
 	(void)interrupt->SetLevel(prevStatus);
 
 }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers-writer lock, so that nobody holds it.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"fairness" says who goes first when readers and writers both wait.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName, RWPolicy fairness)
+{
+    name = debugName;
+    policy = fairness;
+    lock = new Lock(debugName);
+    readOK = new Condition(debugName);
+    writeOK = new Condition(debugName);
+    readers = 0;
+    writer = NULL;
+    waitingReaders = waitingWriters = 0;
+    readerBatch = 0;
+    numReads = numWrites = 0;
+    readWaits = writeWaits = 0;
+    readWaitTicks = writeWaitTicks = 0;
+    maxWriteWait = 0;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate the lock.  Nobody may be holding it or waiting for it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT(readers == 0 && writer == NULL);
+    delete lock;
+    delete readOK;
+    delete writeOK;
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReaderMustWait, RWLock::WriterMustWait
+// 	Return TRUE if a reader (writer) can't go ahead yet.
+//
+//	"waited" -- the reader has already been waiting, so it may be
+//		one of the batch let in after a writer (RWFair)
+//----------------------------------------------------------------------
+
+bool
+RWLock::ReaderMustWait(bool waited)
+{
+    if (writer != NULL)
+	return TRUE;
+    if (policy == RWReaderPref || waitingWriters == 0)
+	return FALSE;
+    return !(policy == RWFair && waited && readerBatch > 0);
+}
+
+bool
+RWLock::WriterMustWait()
+{
+    if (writer != NULL || readers > 0)
+	return TRUE;
+    if (policy == RWReaderPref)
+	return waitingReaders > 0;
+    if (policy == RWFair)
+	return readerBatch > 0;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadAcquire
+// 	Wait until no writer holds the lock (or, depending on the policy,
+//	is waiting for it), then hold it for reading.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReadAcquire()
+{
+    lock->Acquire();
+    numReads++;
+    if (ReaderMustWait(FALSE)) {
+	int start = stats->totalTicks;
+
+	readWaits++;
+	waitingReaders++;
+	do
+	    readOK->Wait(lock);
+	while (ReaderMustWait(TRUE));
+	waitingReaders--;
+	if (policy == RWFair && readerBatch > 0)
+	    readerBatch--;
+	readWaitTicks += stats->totalTicks - start;
+	stats->numLockWaits++;
+	stats->lockWaitTicks += stats->totalTicks - start;
+    }
+    readers++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadRelease
+// 	Stop reading.  The last reader out lets a writer in.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReadRelease()
+{
+    lock->Acquire();
+    ASSERT(readers > 0);
+    if (--readers == 0)
+	writeOK->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteAcquire
+// 	Wait until nobody holds the lock, then hold it for writing.
+//----------------------------------------------------------------------
+
+void
+RWLock::WriteAcquire()
+{
+    lock->Acquire();
+    ASSERT(writer != currentThread);		// not recursive
+    numWrites++;
+    if (WriterMustWait()) {
+	int start = stats->totalTicks;
+	int waited;
+
+	writeWaits++;
+	waitingWriters++;
+	do
+	    writeOK->Wait(lock);
+	while (WriterMustWait());
+	waitingWriters--;
+	waited = stats->totalTicks - start;
+	writeWaitTicks += waited;
+	if (waited > maxWriteWait)
+	    maxWriteWait = waited;
+	stats->numLockWaits++;
+	stats->lockWaitTicks += waited;
+	if (waited > stats->maxLockWait)
+	    stats->maxLockWait = waited;
+    }
+    writer = currentThread;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteRelease
+// 	Stop writing, and let in whoever goes next: under RWFair, the
+//	readers that were waiting; otherwise a waiting writer, if the
+//	policy favors writers; otherwise every waiting reader.
+//----------------------------------------------------------------------
+
+void
+RWLock::WriteRelease()
+{
+    lock->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    if (policy == RWFair && waitingReaders > 0) {
+	readerBatch = waitingReaders;
+	readOK->Broadcast(lock);
+    } else if (policy != RWReaderPref && waitingWriters > 0)
+	writeOK->Signal(lock);
+    else {
+	readOK->Broadcast(lock);
+	writeOK->Signal(lock);		// in case there are no readers
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::PrintStats
+// 	Print how often, and how long, threads waited for the lock.
+//----------------------------------------------------------------------
+
+void
+RWLock::PrintStats()
+{
+    printf("RWLock %s: reads %d (waited %d, %d ticks), "
+	   "writes %d (waited %d, %d ticks, longest %d)\n", name,
+	   numReads, readWaits, readWaitTicks,
+	   numWrites, writeWaits, writeWaitTicks, maxWriteWait);
+}
@@ -1,8 +1,8 @@
 // synch.h
 //	Data structures for synchronizing threads.
 //
-//	Three kinds of synchronization are defined here: semaphores,
-//	locks, and condition variables.  The implementation for
+//	Five kinds of synchronization are defined here: spinlocks, semaphores,
+//	locks, condition variables, and readers-writer locks.  The implementation for
 //	semaphores is given; for the latter two, only the procedure
 //	interface is given -- they are to be implemented as part of
 //	the first assignment.
@@ -22,6 +22,35 @@
 #include "list.h"
 //#include "system.h"
 
+// The following class defines a "spinlock", which keeps the other CPUs of
+// a multiprocessor (cf. smp.h) away from data they share.  Turning off
+// interrupts only keeps other threads on the same CPU away.  A spinlock
+// is held only with interrupts off, never across a context switch (but
+// cf. Thread::Sleep), and not by the same CPU twice:
+//
+//	Acquire -- wait until no other CPU holds the lock, then hold it
+//
+//	Release -- let go of the lock
+//
+// In the simulation, kernel code takes no time and CPUs only take turns
+// at a tick, so another CPU can never be holding the lock: Acquire checks
+// that, rather than spinning.
+
+class SpinLock {
+  public:
+    SpinLock(char* debugName);		// initialize the lock to be free
+    ~SpinLock();
+    char* getName() { return name; }
+
+    void Acquire();
+    void Release();
+    bool isHeldByCurrentCPU();
+
+  private:
+    char* name;
+    int holder;				// CPU holding it, or -1
+};
+
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
 //
@@ -50,6 +79,7 @@ class Semaphore {
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
     List *queue;       // threads waiting in P() for the value to be > 0
+    SpinLock *guard;   // protects "value" and "queue" from other CPUs
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -136,6 +166,66 @@ class Condition {
     char* name;
     // This is a waiting list.
     List* cQueue;
+    SpinLock* guard;	// protects "cQueue" from other CPUs
     // plus some other stuff you'll need to define
 };
+
+// The following class defines a "readers-writer lock".  Any number of
+// threads may hold it for reading at once, or one thread for writing:
+//
+//	ReadAcquire -- wait until nobody is writing, then start reading
+//	ReadRelease -- done reading
+//	WriteAcquire -- wait until nobody is reading or writing, then
+//		start writing
+//	WriteRelease -- done writing
+//
+// Who goes first, when readers and writers are both waiting, depends
+// on the policy the lock was made with:
+//
+//	RWReaderPref -- readers never wait for a waiting writer; with
+//		enough readers, a writer may wait forever
+//	RWWriterPref -- a new reader waits while any writer is waiting,
+//		so a writer waits for at most the readers already in
+//	RWFair -- like RWWriterPref, but when a writer is done, all the
+//		readers that were waiting for it go before the next
+//		writer, so neither side can starve the other
+//
+// The lock counts how often, and how long (in ticks), threads had to
+// wait for it; the totals over all locks are kept in "stats".
+
+enum RWPolicy { RWReaderPref, RWWriterPref, RWFair };
+
+class RWLock {
+  public:
+    RWLock(char* debugName, RWPolicy fairness = RWWriterPref);
+    					// initialize the lock to be FREE
+    ~RWLock();				// deallocate the lock
+    char* getName() { return name; }
+
+    void ReadAcquire();			// these are the operations on
+    void ReadRelease();			// a readers-writer lock
+    void WriteAcquire();
+    void WriteRelease();
+
+    void PrintStats();			// print how much it was contended
+
+    int numReads, numWrites;		// times acquired
+    int readWaits, writeWaits;		// ... of which had to wait
+    int readWaitTicks, writeWaitTicks;	// total time spent waiting
+    int maxWriteWait;			// longest time a writer waited
+
+  private:
+    bool ReaderMustWait(bool waited);	// may a reader go ahead now?
+    bool WriterMustWait();		// may a writer go ahead now?
+
+    char* name;				// for debugging
+    RWPolicy policy;			// who goes first
+    Lock *lock;				// protects the fields below
+    Condition *readOK, *writeOK;	// where readers/writers wait
+    int readers;			// threads reading now
+    Thread *writer;			// thread writing now, or NULL
+    int waitingReaders, waitingWriters;
+    int readerBatch;			// readers let in ahead of waiting
+					// writers (RWFair)
+};
 #endif // SYNCH_H
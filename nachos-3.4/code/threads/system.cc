@@ -8,6 +8,10 @@
 #include "copyright.h"
 #include "system.h"
 #include <string.h>
+#include <ctype.h>
+#ifdef FILESYS
+#include "fsck.h"
+#endif
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
 
@@ -18,6 +22,9 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+Trace *trace;				// event trace, if tracing is on
+Metrics *metrics;			// counters and latency histograms
+Multiprocessor *smp;			// the CPUs, if there is more than one
 
 int USED_THREAD_ID[MAX_THREAD_ID];
 
@@ -27,10 +34,19 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+InodeTable  *inodeTable;
+DentryCache *dentryCache;
+DirectoryCache *dirCache;
+Journal     *journal;
+AtimeMode   atimeMode = AtimeRelative;
+RWPolicy    rwPolicy = RWWriterPref;
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+PipeTable *pipeTable;	// pipes between user programs
+SynchConsole *synchConsole;	// the console, for user programs
+Profiler *profiler;	// samples user programs, if profiling is on
 #endif
 
 #ifdef NETWORK
@@ -89,13 +105,25 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    char *traceFile = NULL;
+    char *metricsFile = NULL;
+    int metricsInterval = 0;
+    int numCPUs = 1;
+    int smpQuantum = DefaultQuantum;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    char *profileFile = NULL;	// where the profile goes, if any
+    int profileInterval = 100;	// instructions between samples
+    bool timed = FALSE;		// model caches and pipeline stalls?
+    char *timingSpec = NULL;	// ... with these parameters
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    bool check = FALSE;		// check the disk before mounting it
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
@@ -117,15 +145,92 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-trace")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-metrics")) {
+	    ASSERT(argc > 1);
+	    metricsFile = *(argv + 1);
+	    argCount = 2;
+	    if (argc > 2 && isdigit(**(argv + 2))) {	// snapshot interval
+		metricsInterval = atoi(*(argv + 2));
+		argCount = 3;
+	    }
+	} else if (!strcmp(*argv, "-smp")) {
+	    ASSERT(argc > 1);
+	    numCPUs = atoi(*(argv + 1));
+	    ASSERT(numCPUs >= 1 && numCPUs <= MaxCPUs);
+	    argCount = 2;
+	    if (argc > 2 && isdigit(**(argv + 2))) {	// quantum
+		smpQuantum = atoi(*(argv + 2));
+		ASSERT(smpQuantum > 0);
+		argCount = 3;
+	    }
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-cbatch"))
+	    consoleBatchTiming = TRUE;
+	else if (!strcmp(*argv, "-prof")) {
+	    ASSERT(argc > 1);
+	    profileFile = *(argv + 1);
+	    argCount = 2;
+	    if (argc > 2 && isdigit(**(argv + 2))) {	// sampling interval
+		profileInterval = atoi(*(argv + 2));
+		argCount = 3;
+	    }
+	} else if (!strcmp(*argv, "-timing")) {
+	    timed = TRUE;
+	    if (argc > 1 && **(argv + 1) != '-') {	// parameters
+		timingSpec = *(argv + 1);
+		argCount = 2;
+	    }
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-atime")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "strict"))
+		atimeMode = AtimeStrict;
+	    else if (!strcmp(*(argv + 1), "relatime"))
+		atimeMode = AtimeRelative;
+	    else if (!strcmp(*(argv + 1), "noatime"))
+		atimeMode = AtimeNone;
+	    else
+		ASSERT(FALSE);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-rw")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "reader"))
+		rwPolicy = RWReaderPref;
+	    else if (!strcmp(*(argv + 1), "writer"))
+		rwPolicy = RWWriterPref;
+	    else if (!strcmp(*(argv + 1), "fair"))
+		rwPolicy = RWFair;
+	    else
+		ASSERT(FALSE);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-fsck"))
+	    check = TRUE;
+	else if (!strcmp(*argv, "-mmap"))
+	    diskMapped = TRUE;
+	else if (!strcmp(*argv, "-msync"))
+	    diskMapped = diskSync = TRUE;
+	else if (!strcmp(*argv, "-disk")) {	// geometry, when formatting
+	    ASSERT(argc > 2);
+	    NumTracks = atoi(*(argv + 1));
+	    SectorsPerTrack = atoi(*(argv + 2));
+	    ASSERT(NumTracks > 0 && SectorsPerTrack > 0);
+	    ASSERT(NumSectors > 2 * JournalSectors);
+	    argCount = 3;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -141,6 +246,10 @@ Initialize(int argc, char **argv)
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    metrics = new Metrics(metricsFile, metricsInterval);
+    trace = NULL;
+    if (traceFile != NULL)			// start tracing (if needed)
+	trace = new Trace(traceFile);
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
     if (randomYield)				// start the timer (if needed)
@@ -153,16 +262,36 @@ Initialize(int argc, char **argv)
     // object to save its state.
     currentThread = new Thread("main");
     currentThread->setStatus(RUNNING);
+    smp = NULL;
+    if (numCPUs > 1)				// it runs on the first CPU
+	smp = new Multiprocessor(numCPUs, smpQuantum);
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
 
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    if (timed)
+	machine->timing = new TimingModel(timingSpec);
+    pipeTable = new PipeTable();
+    synchConsole = new SynchConsole(NULL, NULL);	// stdin, stdout
+    profiler = NULL;
+    if (profileFile != NULL)
+	profiler = new Profiler(profileFile, profileInterval);
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", format);	// sets the geometry
+    inodeTable = new InodeTable();
+    dentryCache = new DentryCache();
+    dirCache = new DirectoryCache();
+    journal = new Journal(format);	// replays the log, if need be
+    if (check && !format) {
+	Fsck *fsck = new Fsck(TRUE);
+
+	fsck->Run();
+	delete fsck;
+    }
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -182,11 +311,20 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    delete trace;			// writes out the events
+    trace = NULL;
+    delete metrics;			// writes out the last snapshot
+    delete smp;				// before the machine, whose TLB
+    smp = NULL;				// one of the CPUs has
 #ifdef NETWORK
     delete postOffice;
 #endif
 
 #ifdef USER_PROGRAM
+    delete profiler;			// prints the profile
+    profiler = NULL;
+    delete synchConsole;
+    delete pipeTable;
     delete machine;
 #endif
 
@@ -195,6 +333,11 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete dirCache;
+    delete dentryCache;
+    delete inodeTable;			// writes back modified headers
+    delete journal;			// ... through the journal
+    journal = NULL;
     delete synchDisk;
 #endif
 
@@ -15,8 +15,11 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "trace.h"
+#include "metrics.h"
 #define MAX_THREAD_ID 128
 extern int USED_THREAD_ID[MAX_THREAD_ID];
+#include "smp.h"
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
 						// called before anything else
@@ -32,7 +35,12 @@ extern Timer *timer;				// the hardware alarm clock
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "pipe.h"
+#include "console.h"
+#include "profile.h"
 extern Machine* machine;	// user program memory and registers
+extern PipeTable *pipeTable;	// pipes between user programs
+extern SynchConsole *synchConsole;	// the console, for user programs
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB
@@ -42,7 +50,16 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "inode.h"
+#include "dcache.h"
+#include "journal.h"
 extern SynchDisk   *synchDisk;
+extern InodeTable  *inodeTable;		// in-core file headers
+extern DentryCache *dentryCache;	// recent directory lookups
+extern DirectoryCache *dirCache;	// recently used directories
+extern Journal     *journal;		// metadata log
+extern AtimeMode   atimeMode;		// when reads update last visit times
+extern RWPolicy    rwPolicy;		// fairness of the per-file locks
 #endif
 
 #ifdef NETWORK
@@ -48,6 +48,11 @@ Thread::Thread(char* threadName, int pro = 5)
         StaticPro = MAX_PRIORITY;
 #ifdef USER_PROGRAM
     space = NULL;
+#endif
+#ifdef FILESYS
+    cwd = (currentThread != NULL) ? currentThread->cwd : NULL;
+    if (cwd != NULL)
+        cwd = inodeTable->Acquire(cwd->sector);	// one more user
 #endif
     userID = getuid();
     threadID = -1;
@@ -65,7 +70,8 @@ Thread::Thread(char* threadName, int pro = 5)
         printf("----------------------------------\n");
         ASSERT(0);
     }
-
+    if (metrics != NULL)		// NULL while Nachos is starting up
+        metrics->NewThread(threadID, name);
 }
 
 //----------------------------------------------------------------------
@@ -84,7 +90,12 @@ Thread::~Thread()
 {
     DEBUG('t', "Deleting thread \"%s\"\n", name);
     USED_THREAD_ID[threadID] = 0;
+    metrics->ThreadDone(threadID);
     ASSERT(this != currentThread);
+#ifdef FILESYS
+    if (cwd != NULL)
+        inodeTable->Release(cwd);
+#endif
     if (stack != NULL)
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
 }
@@ -123,6 +134,20 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Thread::Prepare
+// 	Set up the thread to run (*func)(arg) when it is first switched
+//	to, like Fork, but without putting it on the ready list.  Used for
+//	the CPUs' idle threads (cf. smp.cc), which are switched to
+//	directly.
+//----------------------------------------------------------------------
+
+void
+Thread::Prepare(VoidFunctionPtr func, void *arg)
+{
+    StackAllocate(func, arg);
+}
+
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 // 	Check a thread's stack to see if it has overrun the space
@@ -206,8 +231,9 @@ Thread::Yield ()
 
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
 
-    nextThread = scheduler->FindNextToRun();
-    if (nextThread != NULL) {
+    if (smp != NULL && smp->IsIdleThread(this))
+	;				// the idle loop looks for a thread
+    else if ((nextThread = scheduler->FindNextToRun()) != NULL) {
 	scheduler->ReadyToRun(this);
 	scheduler->Run(nextThread);
     }
@@ -232,9 +258,15 @@ Thread::Yield ()
 //	disable interrupts for atomicity.   We need interrupts off
 //	so that there can't be a time slice between pulling the first thread
 //	off the ready list, and switching to it.
+//
+//	On a multiprocessor, the caller may also hold a spinlock keeping
+//	other CPUs away from the queue it is waiting on.  "held" is let go
+//	once the thread is marked blocked, and held again when it wakes
+//	up.  If this CPU has nothing else to run, it runs its idle thread
+//	rather than waiting here.
 //----------------------------------------------------------------------
 void
-Thread::Sleep ()
+Thread::Sleep (SpinLock *held)
 {
     Thread *nextThread;
 
@@ -244,10 +276,19 @@ Thread::Sleep ()
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
-	interrupt->Idle();	// no one to run, wait for an interrupt
+    if (held != NULL)
+	held->Release();
+    if (smp != NULL) {
+	if ((nextThread = scheduler->FindNextToRun()) == NULL)
+	    nextThread = smp->Current()->idleThread;
+    } else {
+	while ((nextThread = scheduler->FindNextToRun()) == NULL)
+	    interrupt->Idle();	// no one to run, wait for an interrupt
+    }
 
     scheduler->Run(nextThread); // returns when we've been signalled
+    if (held != NULL)
+	held->Acquire();
 }
 
 //----------------------------------------------------------------------
@@ -65,6 +65,9 @@ enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 extern void ThreadPrint(int arg);	 
 extern Statistics *stats;           // performance metrics
 
+class SpinLock;
+class Inode;
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -93,10 +96,13 @@ class Thread {
     // basic thread operations
 
     void Fork(VoidFunctionPtr func, void *arg); 	// Make thread run (*func)(arg)
+    void Prepare(VoidFunctionPtr func, void *arg);	// ... once switched to,
+						// without making it ready
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
-    void Sleep();  				// Put the thread to sleep and 
-						// relinquish the processor
+    void Sleep(SpinLock *held = NULL);		// Put the thread to sleep and 
+						// relinquish the processor,
+						// letting go of "held" meanwhile
     void Finish();  				// The thread is done executing
     
     void CheckOverflow();   			// Check if thread has 
@@ -148,6 +154,15 @@ class Thread {
 
     AddrSpace *space;			// User code this thread is running.
 #endif
+
+#ifdef FILESYS
+  public:
+    Inode *cwd;				// Header of the current directory,
+					// or NULL for the root; inherited
+					// from the creating thread, and
+					// held in core so that the directory
+					// can't be removed
+#endif
 };
 
 // Magical machine-dependent routines, defined in switch.s
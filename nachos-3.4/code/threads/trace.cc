@@ -0,0 +1,122 @@
+// trace.cc
+//	Routines to record events in a ring buffer, and to write them out
+//	as a Chrome trace.
+//
+//	Recording an event just fills in the next record in the ring; the
+//	ring is written out, oldest event first, when Nachos halts.  The
+//	trace's timestamps are simulated ticks, shown as microseconds.
+//	The host time and the simulated time the trace covers are written
+//	once, with the events, so a rate can be worked out from them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+// Names of the events, and of their arguments, for the JSON
+static char *traceNames[NumTraceTypes] = {
+    "switch", "interrupt", "page fault", "TLB miss", "disk request",
+    "disk done", "cache hit", "cache miss", "syscall", "syscall return"
+};
+static char *argNames[NumTraceTypes][2] = {
+    {"from", "to"}, {"type", NULL}, {"page", NULL}, {"page", NULL},
+    {"sector", "write"}, {"sector", NULL}, {"sector", NULL},
+    {"sector", NULL}, {"call", NULL}, {"call", "result"}
+};
+
+//----------------------------------------------------------------------
+// Trace::Trace
+// 	Allocate the ring buffer, and note the host and simulated time.
+//
+//	"traceFile" -- where the events are written when Nachos halts
+//----------------------------------------------------------------------
+
+Trace::Trace(char *traceFile)
+{
+    ASSERT((TraceBufferSize & (TraceBufferSize - 1)) == 0);
+    ring = new TraceRecord[TraceBufferSize];
+    next = 0;
+    start = HostTime();
+    startTicks = stats->totalTicks;
+    fileName = traceFile;
+}
+
+//----------------------------------------------------------------------
+// Trace::~Trace
+// 	Write out the events, and de-allocate the ring buffer.
+//----------------------------------------------------------------------
+
+Trace::~Trace()
+{
+    Export(fileName);
+    delete [] ring;
+}
+
+//----------------------------------------------------------------------
+// Trace::Record
+// 	Add an event to the ring buffer.  This is called on hot paths
+//	(including interrupt handlers), so it does no more than fill in
+//	a record.
+//----------------------------------------------------------------------
+
+void
+Trace::Record(TraceType type, int arg0, int arg1)
+{
+    TraceRecord *r = &ring[next++ & (TraceBufferSize - 1)];
+
+    r->ticks = stats->totalTicks;
+    r->type = type;
+    r->thread = (currentThread != NULL) ? currentThread->get_threadID() : -1;
+    r->arg0 = arg0;
+    r->arg1 = arg1;
+}
+
+//----------------------------------------------------------------------
+// Trace::Export
+// 	Write the events in the ring buffer, oldest first, to "outFile"
+//	in the Chrome trace event format: instant events, one "thread"
+//	per Nachos thread.  A system call and its return become the
+//	beginning and end of a slice.
+//----------------------------------------------------------------------
+
+void
+Trace::Export(char *outFile)
+{
+    FILE *f = fopen(outFile, "w");
+    unsigned int first = (next > TraceBufferSize) ? next - TraceBufferSize : 0;
+
+    if (f == NULL) {
+	perror(outFile);
+	return;
+    }
+    fprintf(f, "{\"traceEvents\": [\n");
+    for (unsigned int i = first; i < next; i++) {
+	TraceRecord *r = &ring[i & (TraceBufferSize - 1)];
+	char *phase = "i";
+
+	if (r->type == TraceSyscall)
+	    phase = "B";
+	else if (r->type == TraceSyscallReturn)
+	    phase = "E";
+	fprintf(f, "%s{\"name\": \"%s\", \"ph\": \"%s\", \"ts\": %d, "
+		"\"pid\": 0, \"tid\": %d, %s\"args\": {",
+		(i == first) ? "" : ",\n", traceNames[r->type], phase,
+		r->ticks, r->thread, (*phase == 'i') ? "\"s\": \"t\", " : "");
+	if (argNames[r->type][0] != NULL)
+	    fprintf(f, "\"%s\": %d", argNames[r->type][0], r->arg0);
+	if (argNames[r->type][1] != NULL)
+	    fprintf(f, ", \"%s\": %d", argNames[r->type][1], r->arg1);
+	fprintf(f, "}}");
+    }
+    fprintf(f, "\n],\n\"otherData\": {\"events\": %u, \"dropped\": %u, "
+	    "\"ticks\": %d, \"host_us\": %lld}}\n", next - first, first,
+	    stats->totalTicks - startTicks, HostTime() - start);
+    fclose(f);
+    printf("Trace: %u events written to %s", next - first, outFile);
+    if (first > 0)
+	printf(" (%u older ones dropped)", first);
+    printf("\n");
+}
@@ -0,0 +1,95 @@
+// trace.h
+//	Data structures for recording what the kernel and the simulated
+//	machine do, cheaply enough to leave on while measuring them.
+//
+//	Each event is a small fixed-size binary record -- its type, two
+//	arguments, the thread running, and when it happened in simulated
+//	ticks -- put in a ring buffer in memory.  Host time is only read
+//	when tracing starts and when the events are written out, so that
+//	recording an event doesn't make a system call.  Nothing
+//	is formatted or printed until Nachos halts, when the ring (the most
+//	recent TraceBufferSize events) is written out as a Chrome trace
+//	(JSON), which chrome://tracing and Perfetto can display.
+//
+//	Tracing is turned on with "-trace <file>".  When it is off, an
+//	event costs one test; built with "make TRACE=0", the TRACE_EVENT
+//	calls are compiled out altogether.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#ifndef TRACE
+#define TRACE 1
+#endif
+
+// The kinds of event, and what their arguments are
+enum TraceType {
+    TraceSwitch,		// context switch: old thread, new thread
+    TraceInterrupt,		// interrupt handler called: IntType
+    TracePageFault,		// page fault: virtual page
+    TraceTLBMiss,		// TLB miss: virtual page
+    TraceDiskRequest,		// disk request started: sector, 1 if write
+    TraceDiskDone,		// disk request finished: sector
+    TraceCacheHit,		// disk cache hit: sector
+    TraceCacheMiss,		// disk cache miss: sector
+    TraceSyscall,		// system call made: call number
+    TraceSyscallReturn,		// system call returns: call number, result
+    NumTraceTypes
+};
+
+// The following class defines one event in the ring buffer.
+
+class TraceRecord {
+  public:
+    int ticks;			// Simulated time
+    short type;			// TraceType
+    short thread;		// ID of the running thread
+    int arg0, arg1;
+};
+
+#define TraceBufferSize	65536	// events kept; a power of two
+
+// The following class defines the trace: the ring buffer, and where it
+// goes when Nachos halts.
+
+class Trace {
+  public:
+    Trace(char *traceFile);	// Start tracing; the events will be
+				// written to "traceFile"
+    ~Trace();			// Write out the events, and stop
+
+    void Record(TraceType type, int arg0, int arg1);
+				// Add an event to the ring, overwriting
+				// the oldest if it is full
+    void Export(char *outFile);	// Write the events in the ring to
+				// "outFile", as a Chrome trace
+
+  private:
+    TraceRecord *ring;		// TraceBufferSize events
+    unsigned int next;		// Events recorded so far; the next one
+				// goes in ring[next % TraceBufferSize]
+    long long start;		// Host time tracing started
+    int startTicks;		// Simulated time tracing started
+    char *fileName;
+};
+
+extern Trace *trace;		// NULL unless tracing is on
+
+#if TRACE
+#define TRACE_EVENT(type, arg0, arg1)					\
+    do {								\
+	if (trace != NULL)						\
+	    trace->Record(type, arg0, arg1);				\
+    } while (0)
+#else
+#define TRACE_EVENT(type, arg0, arg1)	do { } while (0)
+#endif
+
+#endif // TRACE_H
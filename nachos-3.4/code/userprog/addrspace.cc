@@ -58,13 +58,23 @@ SwapHeader (NoffHeader *noffH)
 //	only uniprogramming, and we have a single unsegmented page table
 //
 //	"executable" is the file containing the object code to load into memory
+//	"programName" is its name (for the profiler), if known
+//	"openFiles" is the table of files it starts with, shared with the
+//	program that started it; if NULL, it starts with just the console
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executable, char *programName,
+		     FileTable *openFiles)
 {
     NoffHeader noffH;
     unsigned int i, size;
 
+    program = NULL;
+    if (programName != NULL) {
+	program = new char[strlen(programName) + 1];
+	strcpy(program, programName);
+    }
+
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) &&
 		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
@@ -132,16 +142,21 @@ AddrSpace::AddrSpace(OpenFile *executable)
         }
     }
 
+    files = openFiles;
+    if (files == NULL)
+	files = new FileTable();	// just the console, to start with
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space, closing any files still open.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+   delete files;
    delete pageTable;
+   delete [] program;
 }
 
 //----------------------------------------------------------------------
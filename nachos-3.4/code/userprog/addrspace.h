@@ -2,7 +2,8 @@
 //	Data structures to keep track of executing user programs
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
+//	Besides the page table, an address space keeps the table of
+//	files its program has open (see fdtable.h).
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
@@ -15,14 +16,19 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "fdtable.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
+    AddrSpace(OpenFile *executable, char *programName = NULL,
+	      FileTable *openFiles = NULL);
+					// Create an address space,
 					// initializing it with the program
 					// stored in the file "executable"
+					// (named "programName"), with the open
+					// files "openFiles" (or the console)
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -36,6 +42,8 @@ class AddrSpace {
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual
 					// address space
+    FileTable *files;			// Open files, by OpenFileId
+    char *program;			// The executable's name, or NULL
 };
 
 #endif // ADDRSPACE_H
@@ -22,8 +22,9 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++)
-        Clear(i);
+    for (int i = 0; i < numWords; i++)
+        map[i] = 0;
+    numClear = numBits;
 }
 
 //----------------------------------------------------------------------
@@ -33,7 +34,7 @@ BitMap::BitMap(int nitems)
 
 BitMap::~BitMap()
 {
-    delete map;
+    delete [] map;
 }
 
 //----------------------------------------------------------------------
@@ -48,7 +49,10 @@ BitMap::Mark(int which)
 {
     ASSERT(which >= 0 && which < numBits);
     //printf("allocate page %d\n",which);
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    if (!Test(which)) {
+        map[which / BitsInWord] |= 1 << (which % BitsInWord);
+        numClear--;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -63,7 +67,10 @@ BitMap::Clear(int which)
 {
     ASSERT(which >= 0 && which < numBits);
     //printf("deallocate page %d\n",which);
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (Test(which)) {
+        map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+        numClear++;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -96,28 +103,63 @@ BitMap::Test(int which)
 int
 BitMap::Find()
 {
-    for (int i = 0; i < numBits; i++)
-    	if (!Test(i)) {
-    	    Mark(i);
-    	    return i;
-    	}
-    return -1;
+    int which;
+
+    if (numClear == 0)
+        return -1;
+    which = FindInRange(0, numBits);
+    if (which != -1)
+        Mark(which);
+    return which;
 }
 
 //----------------------------------------------------------------------
-// BitMap::NumClear
-// 	Return the number of clear bits in the bitmap.
-//	(In other words, how many bits are unallocated?)
+// BitMap::FindInRange
+// 	Return the number of the first clear bit in [lo, hi), or -1 if
+//	they are all set.  The bit is not set.
+//
+//	Whole words of set bits are skipped at once; within a word, the
+//	first clear bit is found with a count-trailing-zeros instruction.
+//
+//	"lo", "hi" -- the range of bits to search
 //----------------------------------------------------------------------
 
 int
-BitMap::NumClear()
+BitMap::FindInRange(int lo, int hi)
 {
-    int count = 0;
+    ASSERT(lo >= 0 && hi <= numBits);
+    for (int w = lo / BitsInWord; w * BitsInWord < hi; w++) {
+        unsigned int clear = ~map[w];
+
+        if (w == lo / BitsInWord)
+            clear &= ~0u << (lo % BitsInWord);  // ignore bits below lo
+        if (clear != 0) {
+            int which = w * BitsInWord + __builtin_ctz(clear);
+            return (which < hi) ? which : -1;
+        }
+    }
+    return -1;
+}
 
-    for (int i = 0; i < numBits; i++)
-	   if (!Test(i)) count++;
-    return count;
+//----------------------------------------------------------------------
+// BitMap::Recount
+// 	Recompute the number of clear bits, after the whole map has been
+//	changed at once.  Bits past "numBits" in the last word don't count.
+//----------------------------------------------------------------------
+
+void
+BitMap::Recount()
+{
+    int set = 0;
+
+    for (int w = 0; w < numWords; w++) {
+        unsigned int bits = map[w];
+
+        if ((w + 1) * BitsInWord > numBits)
+            bits &= (1u << (numBits % BitsInWord)) - 1;
+        set += __builtin_popcount(bits);
+    }
+    numClear = numBits - set;
 }
 
 //----------------------------------------------------------------------
@@ -151,6 +193,7 @@ void
 BitMap::FetchFrom(OpenFile *file)
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    Recount();
 }
 
 //----------------------------------------------------------------------
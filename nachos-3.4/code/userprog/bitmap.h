@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	look at a whole word at a time, and the number of clear bits is
+//	kept up to date as bits are set and cleared.
 //
 //	The bitmap can be parameterized with with the number of bits being
 //	managed.
@@ -43,7 +45,11 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit.
 				// If no bits are clear, return -1.
-    int NumClear();		// Return the number of clear bits
+    int FindInRange(int lo, int hi);
+				// Return the # of the first clear bit in
+				// [lo, hi), without setting it, or -1
+    int NumClear() { return numClear; }
+				// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
 
@@ -52,13 +58,16 @@ class BitMap {
     void FetchFrom(OpenFile *file); 	// fetch contents from disk
     void WriteBack(OpenFile *file); 	// write contents to disk
 
-  private:
+  protected:
+    void Recount();			// Recompute numClear from the map
+
     int numBits;			// number of bits in the bitmap
     int numWords;			// number of words of bitmap storage
 					// (rounded up if numBits is not a
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    int numClear;			// number of clear bits
 };
 
 #endif // BITMAP_H
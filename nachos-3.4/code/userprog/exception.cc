@@ -36,6 +36,9 @@
 #define RA_TLB 1
 #define RA_PT  1
 
+// OpenFileIds index the open file table of the current address space
+#define Files()     (currentThread->space->files)
+
 
 
 void InvertPageTable(){
@@ -103,6 +106,35 @@ char* getname(int name_addr){
     return name;
 }
 
+// Copy "n" bytes between "buf" and user memory at "addr", a page at a
+// time, bringing in each page first if need be.  Return false if part
+// of the range isn't in the address space.
+static bool UserCopy(int addr, char *buf, int n, bool toUser){
+    while (n > 0) {
+        int chunk = min(n, PageSize - addr % PageSize);
+        int phys, tries = 0;
+        ExceptionType e;
+
+        while ((e = machine->Translate(addr, &phys, 1, toUser)) != NoException) {
+            if (e != PageFaultException || ++tries > 2)
+                return false;
+            machine->RaiseException(e, addr);   // load the page
+            interrupt->setStatus(SystemMode);
+        }
+        if (toUser)
+            bcopy(buf, &machine->mainMemory[phys], chunk);
+        else
+            bcopy(&machine->mainMemory[phys], buf, chunk);
+        addr += chunk;
+        buf += chunk;
+        n -= chunk;
+    }
+    return true;
+}
+
+#define CopyFromUser(addr, buf, n)  UserCopy(addr, buf, n, false)
+#define CopyToUser(addr, buf, n)    UserCopy(addr, buf, n, true)
+
 // void Create(char *name);
 void syscall_create(){
     int name_addr = machine->ReadRegister(4);
@@ -119,39 +151,57 @@ void syscall_open(){
     char*str = getname(name_addr);
     printf("Starting opening file %s\n",str);
     OpenFile* openfile = fileSystem->Open(str);
-    machine->WriteRegister(2,int(openfile));
+    int fd = -1;
+
+    if (openfile != NULL) {
+        OpenFileDesc *desc = new OpenFileDesc(DiskFile, openfile);
+        if ((fd = Files()->Add(desc)) == -1)
+            delete desc;        // too many open files
+    }
+    machine->WriteRegister(2, fd);
     machine->updatePC();
 }
 
 // void Close(OpenFileId id);
 void syscall_close(){
     int fd = machine->ReadRegister(4);
-    OpenFile *openfile = (OpenFile*)fd;
-    delete openfile;
+
+    Files()->Close(fd);
     machine->updatePC();
 }
 
+// Read and Write go through a buffer on the kernel stack, this many
+// bytes at a time, whatever size the user program asks for.
+#define MaxTransfer 512
+
 // int Read(char *buffer, int size, OpenFileId id);
+// A disk file is read until "size" bytes are read or it ends; the
+// console or a pipe returns what it has after the first buffer full,
+// since reading any more could wait.
 void syscall_read(){
     int addr = machine->ReadRegister(4);
     int length = machine->ReadRegister(5);
     int fd = machine->ReadRegister(6);
-    char data[length];
-
-    if(fd == 0){
-        for(int i=0; i<length; ++i)
-            data[i] = getchar();
-    }
-    else{
-        OpenFile* openfile = (OpenFile*)fd;
-        int len = openfile->Read(data,length);
-    }
-
-    for(int i=0;i<length;++i){
-        machine->WriteMem(addr+i,1,int(data[i]));
+    OpenFileDesc *desc = Files()->Get(fd);
+    char data[MaxTransfer];
+    int done = 0;
+
+    if (desc == NULL || length < 0)
+        done = -1;
+    while (done >= 0 && done < length) {
+        int chunk = min(length - done, MaxTransfer);
+        int n = desc->Read(data, chunk);
+
+        if (n < 0 || (n > 0 && !CopyToUser(addr + done, data, n))) {
+            done = -1;
+            break;
+        }
+        done += n;
+        if (n < chunk || !desc->IsDiskFile())
+            break;
     }
 
-    machine->WriteRegister(2, length);
+    machine->WriteRegister(2, done);
     machine->updatePC();
 }
 
@@ -160,37 +210,72 @@ void syscall_write(){
     int addr = machine->ReadRegister(4);
     int length = machine->ReadRegister(5);
     int fd = machine->ReadRegister(6);
-    char data[length];
-    int tmp;
-
-    for(int i = 0; i < length; ++i){
-        machine->ReadMem(addr+i,1,&tmp);
-        data[i] = char(tmp);
-    }
-    if (fd == 1){
-        for(int i=0; i<length; ++i)
-            putchar(data[i]);
-    }
-    else{
-        OpenFile* openfile = (OpenFile*)fd;
-        openfile->Write(data, length);
+    OpenFileDesc *desc = Files()->Get(fd);
+    char data[MaxTransfer];
+    int done = 0;
+
+    if (desc == NULL || length < 0)
+        done = -1;
+    while (done >= 0 && done < length) {
+        int chunk = min(length - done, MaxTransfer);
+        int n;
+
+        if (!CopyFromUser(addr + done, data, chunk)) {
+            done = -1;
+            break;
+        }
+        n = desc->Write(data, chunk);
+        if (n < 0) {                    // nothing more can be written
+            if (done == 0)
+                done = -1;
+            break;
+        }
+        done += n;
+        if (n < chunk)
+            break;
     }
 
+    machine->WriteRegister(2, done);
     machine->updatePC();
 }
 
+// What the thread running a new user program starts from: the
+// program, where to start it (0 for its entry point), and the open
+// files it shares with the program that started it.  The files are
+// shared when Exec or Fork is called, since the caller may exit
+// before the new thread gets to run.
+struct StartArgs {
+    char *name;
+    int pc;
+    FileTable *files;
+};
+
+static StartArgs *
+NewStartArgs(char *name, int pc)
+{
+    StartArgs *args = new StartArgs;
+
+    args->name = name;
+    args->pc = pc;
+    args->files = new FileTable(Files());
+    return args;
+}
+
 // SpaceId Exec(char *name);
 void
-StartP(char *filename){
-    // printf("thread %d executing file %s\n",currentThread->get_threadID(),filename);
-    OpenFile *executable = fileSystem->Open(filename);
+StartP(int arg){
+    StartArgs *args = (StartArgs *) arg;
+    // printf("thread %d executing file %s\n",currentThread->get_threadID(),args->name);
+    OpenFile *executable = fileSystem->Open(args->name);
     AddrSpace *space;
 
     if (executable == NULL) {
-    printf("Unable to open file %s\n", filename);
+    printf("Unable to open file %s\n", args->name);
+    delete args->files;
+    delete args;
     return;
     }
-    space = new AddrSpace(executable);
+    space = new AddrSpace(executable, args->name, args->files);
     currentThread->space = space;
 
     delete executable;          // close file
@@ -198,6 +283,12 @@ StartP(char *filename){
     space->InitRegisters();     // set the initial register values
     space->RestoreState();      // load page table register
 
+    if (args->pc != 0) {        // Fork: start at the function
+        machine->WriteRegister(PCReg, args->pc);
+        machine->WriteRegister(NextPCReg, args->pc + 4);
+    }
+    delete args;
+
     machine->Run();         // jump to the user progam
     ASSERT(FALSE);          // machine->Run never returns;
                     // the address space exits
@@ -207,41 +298,15 @@ void syscall_exec(){
     int addr = machine->ReadRegister(4);
     char*str = getname(addr);
     Thread* t = new Thread("exec");
-    t->Fork(StartP, str);
+    t->Fork(StartP, (void *) NewStartArgs(str, 0));
     machine->updatePC();
 }
 
 // // void Fork(void (*func)());
-void
-myfork(int func_addr){
-    //printf("thread %d executing file %s\n",currentThread->get_threadID(),filename);
-    OpenFile *executable = fileSystem->Open(currentThread->getName());
-    AddrSpace *space;
-
-    if (executable == NULL) {
-    printf("Unable to open file %s\n", currentThread->getName());
-    return;
-    }
-    space = new AddrSpace(executable);
-    currentThread->space = space;
-
-    delete executable;          // close file
-
-    space->InitRegisters();     // set the initial register values
-    space->RestoreState();      // load page table register
-
-    machine->WriteRegister(PCReg, func_addr);
-    machine->WriteRegister(NextPCReg, func_addr+4);
-
-    machine->Run();         // jump to the user progam
-    ASSERT(FALSE);          // machine->Run never returns;
-                    // the address space exits
-                    // by doing the syscall "exit"
-}
 void syscall_fork(){
     int addr = machine->ReadRegister(4);
     Thread* t = new Thread(currentThread->getName());
-    t->Fork(myfork, addr);
+    t->Fork(StartP, (void *) NewStartArgs(currentThread->getName(), addr));
     machine->updatePC();
 }
 
@@ -312,7 +377,12 @@ void syscall_ls(){
 void syscall_cd(){
     int dir_addr = machine->ReadRegister(4);
     char*str = getname(dir_addr);
+#ifdef FILESYS
+    if (!fileSystem->ChangeDir(str))
+        printf("cd: %s: no such directory\n", str);
+#else
     chdir(str);
+#endif
 
     machine->updatePC();
 }
@@ -347,6 +417,130 @@ void syscall_rm(){
     machine->updatePC();
 }
 
+// int Pipe(OpenFileId *fds);
+void syscall_pipe(){
+    int fds_addr = machine->ReadRegister(4);
+    int id = pipeTable->Create();
+    OpenFileDesc *in, *out;
+    int rd = -1, wr = -1;
+
+    if (id != -1) {
+        in = new OpenFileDesc(PipeReadFile, NULL, id);
+        out = new OpenFileDesc(PipeWriteFile, NULL, id);
+        if ((rd = Files()->Add(in)) == -1)
+            delete in;
+        if ((wr = Files()->Add(out)) == -1)
+            delete out;
+        if (rd == -1 || wr == -1) {     // too many open files
+            Files()->Close(rd);
+            Files()->Close(wr);
+            rd = wr = -1;
+        }
+    }
+    if (rd != -1) {
+        int fds[2];
+
+        fds[0] = WordToMachine(rd);
+        fds[1] = WordToMachine(wr);
+        if (!CopyToUser(fds_addr, (char *) fds, sizeof(fds))) {
+            Files()->Close(rd);         // bad address: nobody gets them
+            Files()->Close(wr);
+            rd = -1;
+        }
+    }
+    machine->WriteRegister(2, (rd == -1) ? -1 : 0);
+    machine->updatePC();
+}
+
+// OpenFileId Dup(OpenFileId id);
+void syscall_dup(){
+    int fd = machine->ReadRegister(4);
+
+    machine->WriteRegister(2, Files()->Dup(fd));
+    machine->updatePC();
+}
+
+// int Send(MailAddress *to, int fromBox, char *buffer, int size);
+void syscall_send(){
+    int result = -1;
+#ifdef NETWORK
+    int to_addr = machine->ReadRegister(4);
+    int from_box = machine->ReadRegister(5);
+    int addr = machine->ReadRegister(6);
+    int size = machine->ReadRegister(7);
+    MailAddress to;
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    char data[MaxMailSize];
+
+    if (0 <= size && size <= (int) MaxMailSize
+        && 0 <= from_box && from_box < postOffice->NumBoxes()
+        && CopyFromUser(to_addr, (char *) &to, sizeof(to))
+        && 0 <= (to.box = WordToHost(to.box))
+        && to.box < postOffice->NumBoxes()
+        && CopyFromUser(addr, data, size)) {
+        pktHdr.to = WordToHost(to.machine);
+        mailHdr.to = to.box;
+        mailHdr.from = from_box;
+        mailHdr.length = size;
+        postOffice->Send(pktHdr, mailHdr, data);
+        result = size;
+    }
+#endif
+    machine->WriteRegister(2, result);
+    machine->updatePC();
+}
+
+// int Receive(int box, MailAddress *from, char *buffer, int size);
+void syscall_receive(){
+    int result = -1;
+#ifdef NETWORK
+    int box = machine->ReadRegister(4);
+    int from_addr = machine->ReadRegister(5);
+    int addr = machine->ReadRegister(6);
+    int size = machine->ReadRegister(7);
+
+    if (0 <= box && box < postOffice->NumBoxes() && size >= 0) {
+        Packet *pkt = postOffice->ReceivePacket(box);   // no copy
+        MailHeader *mailHdr = (MailHeader *) pkt->data;
+        MailAddress from;
+
+        from.machine = WordToMachine(pkt->hdr.from);
+        from.box = WordToMachine(mailHdr->from);
+        result = min(size, (int) mailHdr->length);
+        if (!CopyToUser(addr, pkt->data + sizeof(MailHeader), result)
+            || (from_addr != 0
+                && !CopyToUser(from_addr, (char *) &from, sizeof(from))))
+            result = -1;
+        postOffice->FreePacket(pkt);
+    }
+#endif
+    machine->WriteRegister(2, result);
+    machine->updatePC();
+}
+
+// int Poll(int *boxes, int n, int wait);
+void syscall_poll(){
+    int result = -1;
+#ifdef NETWORK
+    int addr = machine->ReadRegister(4);
+    int n = machine->ReadRegister(5);
+    int wait = machine->ReadRegister(6);
+    int boxes[NumMailBoxes];
+    bool ok = (0 < n && n <= NumMailBoxes
+               && CopyFromUser(addr, (char *) boxes, n * sizeof(int)));
+
+    for (int i = 0; ok && i < n; i++) {
+        boxes[i] = WordToHost(boxes[i]);
+        ok = (0 <= boxes[i] && boxes[i] < postOffice->NumBoxes());
+    }
+    if (ok)
+        result = postOffice->Select(n, boxes, wait != 0);
+#endif
+    machine->WriteRegister(2, result);
+    machine->updatePC();
+}
+
 // void Print();
 void syscall_print(){
     int str_addr = machine->ReadRegister(4);
@@ -383,9 +577,14 @@ void
 ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
+    int start = stats->totalTicks;
 
     if ( which == SyscallException ) {
+        TRACE_EVENT(TraceSyscall, type, 0);
+        metrics->Count(CountSyscalls);
+        metrics->ForCurrentThread()->syscalls++;
         if(type == SC_Halt){
+            Files()->CloseAll();        // flushes console output
             printf("In halting...\n");
             DEBUG('a', "Shutdown, initiated by user program.\n");
             for(int i=0;i<machine->pageTableSize;++i){
@@ -398,8 +597,6 @@ ExceptionHandler(ExceptionType which)
 
         // void Exit(int status);
         else if(type == SC_Exit){
-            /* printf("miss time %d, hit time %d ,miss rate %.8f\n",machine->tlb_miss_time,machine->tlb_hit_time,
-            float(machine->tlb_miss_time)/float(machine->tlb_hit_time));*/
             int status = machine->ReadRegister(4);
             currentThread->Yield();
 
@@ -408,6 +605,7 @@ ExceptionHandler(ExceptionType which)
                 if (machine->pageTable[i].valid==1 && machine->pageTable[i].thread_id == currentThread->get_threadID())
                     machine->bitmap->Clear(ppn);
             }
+            Files()->CloseAll();
             printf("thread %d exits with status %d\n",currentThread->get_threadID(),status);
             currentThread->Finish();
 
@@ -467,7 +665,23 @@ ExceptionHandler(ExceptionType which)
         else if(type == SC_Print){
             syscall_print();
         }
-
+        else if(type == SC_Pipe){
+            syscall_pipe();
+        }
+        else if(type == SC_Dup){
+            syscall_dup();
+        }
+        else if(type == SC_Send){
+            syscall_send();
+        }
+        else if(type == SC_Receive){
+            syscall_receive();
+        }
+        else if(type == SC_Poll){
+            syscall_poll();
+        }
+        metrics->RecordLatency(LatencySyscall, stats->totalTicks - start);
+        TRACE_EVENT(TraceSyscallReturn, type, machine->ReadRegister(2));
     }
 
 
@@ -477,8 +691,10 @@ ExceptionHandler(ExceptionType which)
         // printf("%d\n",machine->cnttt++);
         // when tlb is used
         if(machine->tlb!=NULL){
-            printf("tlb fault\n");
             unsigned int vpn = (unsigned) machine->registers[BadVAddrReg] / PageSize;
+            TRACE_EVENT(TraceTLBMiss, vpn, 0);
+            metrics->Count(CountTLBMisses);
+            metrics->ForCurrentThread()->tlbMisses++;
             int i = 0;
             bool have_empty = 0;
             for(;i<TLBSize;++i){
@@ -525,8 +741,13 @@ ExceptionHandler(ExceptionType which)
 
         // when pageTable is used
         else{
-            // printf("page fault\n");
+            TRACE_EVENT(TracePageFault,
+                (unsigned) machine->registers[BadVAddrReg] / PageSize, 0);
+            stats->numPageFaults++;
+            metrics->Count(CountPageFaults);
+            metrics->ForCurrentThread()->pageFaults++;
             InvertPageTable();
+            metrics->RecordLatency(LatencyPageFault, stats->totalTicks - start);
             return;
             int vpn = (unsigned) machine->registers[BadVAddrReg] / PageSize;
 
@@ -0,0 +1,244 @@
+// fdtable.cc
+//	Routines to manage the open files of a user program.
+//
+//	The console itself is the SynchConsole (see console.h), shared by
+//	every address space; it does its own buffering.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "fdtable.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// FlushConsole
+// 	Wait until all console output has gone out to the host.
+//----------------------------------------------------------------------
+
+void
+FlushConsole()
+{
+    synchConsole->Flush();
+}
+
+//----------------------------------------------------------------------
+// ConsoleWrite
+// 	Queue "numBytes" bytes of console output.  Anything the kernel
+//	printed with stdio goes out first, so the two come out in the
+//	order they were written.
+//----------------------------------------------------------------------
+
+static int
+ConsoleWrite(char *from, int numBytes)
+{
+    fflush(stdout);
+    synchConsole->Write(from, numBytes);
+    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// ConsoleRead
+// 	Return a line of console input, up to "numBytes" bytes of it (see
+//	SynchConsole::Read).  Output is flushed first, so that a prompt is
+//	seen before we wait.  Return 0 at end of file.
+//----------------------------------------------------------------------
+
+static int
+ConsoleRead(char *into, int numBytes)
+{
+    FlushConsole();
+    return synchConsole->Read(into, numBytes);
+}
+
+//----------------------------------------------------------------------
+// OpenFileDesc::OpenFileDesc
+// 	Describe an open file.
+//
+//	"fileKind" -- console, disk file or pipe end
+//	"diskFile" -- the disk file (DiskFile only); closed with the
+//		description
+//	"pipeId" -- the pipe's number in pipeTable (pipe ends only)
+//----------------------------------------------------------------------
+
+OpenFileDesc::OpenFileDesc(FileKind fileKind, OpenFile *diskFile, int pipeId)
+{
+    kind = fileKind;
+    file = diskFile;
+    pipe = pipeId;
+    refCount = 0;
+}
+
+//----------------------------------------------------------------------
+// OpenFileDesc::~OpenFileDesc
+// 	Close whatever the description refers to.
+//----------------------------------------------------------------------
+
+OpenFileDesc::~OpenFileDesc()
+{
+    switch (kind) {
+      case ConsoleOutFile:
+	FlushConsole();
+	break;
+      case DiskFile:
+	delete file;
+	break;
+      case PipeReadFile:
+      case PipeWriteFile:
+	pipeTable->Close(pipe, kind == PipeWriteFile);
+	break;
+      default:
+	break;
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFileDesc::Read, OpenFileDesc::Write
+// 	Transfer "numBytes" bytes, at the file's current position (which
+//	is shared by every OpenFileId that refers to this description).
+//	Return the number of bytes transferred, or -1 if the file can't
+//	be read (written).
+//----------------------------------------------------------------------
+
+int
+OpenFileDesc::Read(char *into, int numBytes)
+{
+    switch (kind) {
+      case ConsoleInFile:
+	return ConsoleRead(into, numBytes);
+      case DiskFile:
+	return file->Read(into, numBytes);
+      case PipeReadFile:
+	return pipeTable->Get(pipe)->Read(into, numBytes);
+      default:
+	return -1;
+    }
+}
+
+int
+OpenFileDesc::Write(char *from, int numBytes)
+{
+    switch (kind) {
+      case ConsoleOutFile:
+	return ConsoleWrite(from, numBytes);
+      case DiskFile:
+	return file->Write(from, numBytes);
+      case PipeWriteFile:
+	return pipeTable->Get(pipe)->Write(from, numBytes);
+      default:
+	return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileTable::FileTable
+// 	Initialize the open files of a new address space: just the
+//	console, as ConsoleInput and ConsoleOutput, or else every file
+//	"parent" has open, under the same OpenFileIds.  The descriptions
+//	are shared, not copied: the two programs share the position in
+//	a disk file, and each end of a pipe stays open until both have
+//	closed it.
+//
+//	"parent" -- the open files of the program starting this one
+//----------------------------------------------------------------------
+
+FileTable::FileTable(FileTable *parent)
+{
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	slots[i] = (parent == NULL) ? NULL : parent->slots[i];
+	if (slots[i] != NULL)
+	    slots[i]->refCount++;
+    }
+    if (parent == NULL) {
+	Add(new OpenFileDesc(ConsoleInFile));	// ConsoleInput
+	Add(new OpenFileDesc(ConsoleOutFile));	// ConsoleOutput
+    }
+}
+
+//----------------------------------------------------------------------
+// FileTable::~FileTable
+// 	Close every file still open.
+//----------------------------------------------------------------------
+
+FileTable::~FileTable()
+{
+    CloseAll();
+}
+
+//----------------------------------------------------------------------
+// FileTable::Add
+// 	Put "desc" in the lowest free slot, and return the slot number
+//	(the OpenFileId), or -1 if every slot is in use.
+//----------------------------------------------------------------------
+
+int
+FileTable::Add(OpenFileDesc *desc)
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	if (slots[i] == NULL) {
+	    slots[i] = desc;
+	    desc->refCount++;
+	    return i;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FileTable::Get
+// 	Return the description behind OpenFileId "id", or NULL if "id"
+//	isn't open.
+//----------------------------------------------------------------------
+
+OpenFileDesc *
+FileTable::Get(int id)
+{
+    if (id < 0 || id >= MaxOpenFiles)
+	return NULL;
+    return slots[id];
+}
+
+//----------------------------------------------------------------------
+// FileTable::Dup
+// 	Make another OpenFileId for the same open file as "id".  Return
+//	it, or -1 if "id" isn't open or the table is full.
+//----------------------------------------------------------------------
+
+int
+FileTable::Dup(int id)
+{
+    OpenFileDesc *desc = Get(id);
+
+    return (desc == NULL) ? -1 : Add(desc);
+}
+
+//----------------------------------------------------------------------
+// FileTable::Close
+// 	Free OpenFileId "id", closing the file if no other OpenFileId
+//	refers to it.  Return FALSE if "id" wasn't open.
+//----------------------------------------------------------------------
+
+bool
+FileTable::Close(int id)
+{
+    OpenFileDesc *desc = Get(id);
+
+    if (desc == NULL)
+	return FALSE;
+    slots[id] = NULL;
+    if (--desc->refCount == 0)
+	delete desc;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileTable::CloseAll
+// 	Close every open file; the user program is done.
+//----------------------------------------------------------------------
+
+void
+FileTable::CloseAll()
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	Close(i);
+}
@@ -0,0 +1,84 @@
+// fdtable.h
+//	Data structures for the open files of a user program.
+//
+//	A user program names its open files by small integers
+//	(OpenFileIds, see syscall.h), which index a table kept in its
+//	address space.  Each slot points to an open file description:
+//	the OpenFile, pipe end or console behind the OpenFileId.  Dup
+//	makes another slot point to the same description, so the two
+//	share one position in the file; the description is closed when
+//	the last slot pointing to it is.
+//
+//	The console is buffered by the SynchConsole (see console.h):
+//	output goes to the device in batches, and a Read returns a whole
+//	line of input at once, rather than one character per call.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+#define MaxOpenFiles		16	// OpenFileIds per address space
+
+enum FileKind { ConsoleInFile, ConsoleOutFile, DiskFile,
+		PipeReadFile, PipeWriteFile };
+
+// The following class defines an open file description.
+
+class OpenFileDesc {
+  public:
+    OpenFileDesc(FileKind fileKind, OpenFile *diskFile = NULL,
+		 int pipeId = -1);	// Describe an open console, disk
+					// file ("diskFile") or pipe end
+					// ("pipeId")
+    ~OpenFileDesc();			// Close whatever is behind it
+
+    int Read(char *into, int numBytes);	// Return the number of bytes
+    int Write(char *from, int numBytes);// transferred, or -1 if this
+					// kind of file can't do that
+
+    bool IsDiskFile() { return kind == DiskFile; }
+					// Else a Read may wait for data
+
+    int refCount;			// Slots that point to it
+
+  private:
+    FileKind kind;
+    OpenFile *file;			// The disk file, if it is one
+    int pipe;				// The pipe (in pipeTable), if it
+					// is one
+};
+
+// The following class defines the table of open files of one address
+// space.  OpenFileIds 0 and 1 start out as the console (ConsoleInput
+// and ConsoleOutput).  A program started by Exec or Fork starts out
+// with the same open files as the program that started it, sharing
+// each description (and so each pipe end) with it.
+
+class FileTable {
+  public:
+    FileTable(FileTable *parent = NULL);// Open the console, or share
+					// every file "parent" has open
+    ~FileTable();			// Close everything
+
+    int Add(OpenFileDesc *desc);	// Put "desc" in the lowest free
+					// slot; return it, or -1 if full
+    OpenFileDesc *Get(int id);		// The description behind "id",
+					// or NULL
+    int Dup(int id);			// Another slot for the same
+					// description, or -1
+    bool Close(int id);			// Free slot "id"; FALSE if unused
+    void CloseAll();			// Close every open file
+
+  private:
+    OpenFileDesc *slots[MaxOpenFiles];
+};
+
+extern void FlushConsole();		// Wait for console output to go out
+
+#endif // FDTABLE_H
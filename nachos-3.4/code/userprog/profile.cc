@@ -0,0 +1,492 @@
+// profile.cc
+//	Routines to sample where user programs spend their instructions,
+//	and to report it by procedure.
+//
+//	The symbols come from the MIPS ECOFF symbol table: the file header
+//	points to a "symbolic header", which gives where the file
+//	descriptors, local symbols and local strings are.  Each procedure
+//	(global or static) is a local symbol of type stProc or
+//	stStaticProc, whose value is its address.  Everything in the file
+//	is little-endian, like the simulated machine.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "profile.h"
+#include "system.h"
+#include "addrspace.h"
+
+// Where things are in an ECOFF file (cf. bin/coff.h)
+#define CoffMagic		0x0162	// file header: MIPS, little-endian
+#define CoffSymPtr		8	// ... file offset of symbolic header
+#define CoffOptHeaderSize	16	// ... size of the a.out header
+#define CoffTextSize		24	// a.out header: size of code
+#define CoffTextStart		40	// ... and its address
+#define SymHeaderMagic		0x7009
+#define SymHeaderSize		96
+#define SymHeaderSymCount	32	// symbolic header: local symbols
+#define SymHeaderSymOffset	36
+#define SymHeaderStrings	60	// ... local strings
+#define SymHeaderFileCount	72	// ... file descriptors
+#define SymHeaderFileOffset	76
+#define FileDescSize		72
+#define FileDescStrings		8	// file descriptor: its strings
+#define FileDescSymBase		16	// ... and its symbols
+#define FileDescSymCount	20
+#define SymbolSize		12	// symbol: string, value, type bits
+#define stProc			6
+#define stStaticProc		14
+
+static int
+LittleWord(char *p)
+{
+    unsigned char *b = (unsigned char *) p;
+
+    return b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24);
+}
+
+static int
+LittleShort(char *p)
+{
+    unsigned char *b = (unsigned char *) p;
+
+    return b[0] | (b[1] << 8);
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::ProfiledProgram
+// 	Start counting samples for the program in "programFile", and read
+//	the procedure names from "programFile".coff.
+//----------------------------------------------------------------------
+
+ProfiledProgram::ProfiledProgram(char *programFile)
+{
+    char *coffName = new char[strlen(programFile) + 6];
+
+    fileName = new char[strlen(programFile) + 1];
+    strcpy(fileName, programFile);
+    samples = 0;
+    symbols = NULL;
+    numSymbols = textEnd = 0;
+    for (int i = 0; i < ProfileHashSize; i++)
+	stacks[i] = NULL;
+
+    sprintf(coffName, "%s.coff", programFile);
+    if (!ReadSymbols(coffName))
+	printf("Profile: no symbols in %s; addresses will be shown\n",
+	       coffName);
+    delete [] coffName;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::~ProfiledProgram
+// 	De-allocate the symbols and the samples.
+//----------------------------------------------------------------------
+
+ProfiledProgram::~ProfiledProgram()
+{
+    for (int i = 0; i < ProfileHashSize; i++)
+	while (stacks[i] != NULL) {
+	    ProfileStack *s = stacks[i];
+
+	    stacks[i] = s->next;
+	    delete s;
+	}
+    for (int i = 0; i < numSymbols; i++)
+	delete [] symbols[i].name;
+    delete [] symbols;
+    delete [] fileName;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::ReadSymbols
+// 	Read the procedures in the ECOFF file "coffName" into "symbols",
+//	sorted by address.  Return FALSE if the file can't be read, or
+//	has no symbol table.
+//----------------------------------------------------------------------
+
+bool
+ProfiledProgram::ReadSymbols(char *coffName)
+{
+    FILE *f = fopen(coffName, "r");
+    char *buf, *sym, *fd;
+    int size, symHeader, numFiles, strings, symOffset, numSyms;
+
+    if (f == NULL)
+	return FALSE;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = new char[size + 1];
+    if (size < 20 || (int) fread(buf, 1, size, f) != size
+	    || LittleShort(buf) != CoffMagic) {
+	fclose(f);
+	delete [] buf;
+	return FALSE;
+    }
+    fclose(f);
+    buf[size] = '\0';				// so every name ends
+
+    if (LittleShort(buf + CoffOptHeaderSize) >= CoffTextStart - 16)
+	textEnd = LittleWord(buf + CoffTextStart)
+	    + LittleWord(buf + CoffTextSize);
+    symHeader = LittleWord(buf + CoffSymPtr);
+    if (symHeader <= 0 || symHeader + SymHeaderSize > size
+	    || LittleShort(buf + symHeader) != SymHeaderMagic) {
+	delete [] buf;
+	return FALSE;
+    }
+    numFiles = LittleWord(buf + symHeader + SymHeaderFileCount);
+    fd = buf + LittleWord(buf + symHeader + SymHeaderFileOffset);
+    strings = LittleWord(buf + symHeader + SymHeaderStrings);
+    symOffset = LittleWord(buf + symHeader + SymHeaderSymOffset);
+    numSyms = LittleWord(buf + symHeader + SymHeaderSymCount);
+    if (symOffset + numSyms * SymbolSize > size
+	    || (fd - buf) + numFiles * FileDescSize > size) {
+	delete [] buf;
+	return FALSE;
+    }
+
+    symbols = new ProfileSymbol[numSyms];
+    for (int i = 0; i < numFiles; i++, fd += FileDescSize) {
+	int issBase = LittleWord(fd + FileDescStrings);
+	int first = LittleWord(fd + FileDescSymBase);
+	int count = LittleWord(fd + FileDescSymCount);
+
+	for (int j = first; j < first + count && j < numSyms; j++) {
+	    int type, at, name;
+
+	    sym = buf + symOffset + j * SymbolSize;
+	    type = LittleWord(sym + 8) & 0x3f;
+	    name = strings + issBase + LittleWord(sym);
+	    if ((type != stProc && type != stStaticProc)
+		    || name < 0 || name >= size)
+		continue;
+
+	    // insertion sort, by address; there are few procedures
+	    at = numSymbols++;
+	    while (at > 0 && symbols[at - 1].address > LittleWord(sym + 4)) {
+		symbols[at] = symbols[at - 1];
+		at--;
+	    }
+	    symbols[at].address = LittleWord(sym + 4);
+	    symbols[at].name = new char[strlen(buf + name) + 1];
+	    strcpy(symbols[at].name, buf + name);
+	}
+    }
+    delete [] buf;
+    if (textEnd == 0 && numSymbols > 0)
+	textEnd = symbols[numSymbols - 1].address + PageSize;
+    return numSymbols > 0;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::Procedure
+// 	Return the address of the procedure "pc" is in, or "pc" itself
+//	if it isn't in any we know of.
+//----------------------------------------------------------------------
+
+int
+ProfiledProgram::Procedure(int pc)
+{
+    int low = 0, high = numSymbols - 1;
+
+    if (numSymbols == 0 || pc < symbols[0].address || pc >= textEnd)
+	return pc;
+    while (low < high) {		// last symbol at or before "pc"
+	int mid = (low + high + 1) / 2;
+
+	if (symbols[mid].address <= pc)
+	    low = mid;
+	else
+	    high = mid - 1;
+    }
+    return symbols[low].address;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::IndexOf, ProfiledProgram::NameOf
+// 	Return the index in "symbols" of the procedure at "address" (or
+//	numSymbols, if there is none), or its name (or NULL).
+//----------------------------------------------------------------------
+
+int
+ProfiledProgram::IndexOf(int address)
+{
+    int low = 0, high = numSymbols - 1;
+
+    while (low <= high) {
+	int mid = (low + high) / 2;
+
+	if (symbols[mid].address == address)
+	    return mid;
+	else if (symbols[mid].address < address)
+	    low = mid + 1;
+	else
+	    high = mid - 1;
+    }
+    return numSymbols;
+}
+
+char *
+ProfiledProgram::NameOf(int address)
+{
+    int i = IndexOf(address);
+
+    return (i < numSymbols) ? symbols[i].name : NULL;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::Add
+// 	Count one sample in the call stack "frames" (outermost first).
+//----------------------------------------------------------------------
+
+void
+ProfiledProgram::Add(int *frames, int depth)
+{
+    unsigned int hash = depth;
+    ProfileStack *s;
+
+    for (int i = 0; i < depth; i++)
+	hash = hash * 31 + (unsigned) frames[i];
+    hash %= ProfileHashSize;
+
+    samples++;
+    for (s = stacks[hash]; s != NULL; s = s->next)
+	if (s->depth == depth
+		&& !memcmp(s->frames, frames, depth * sizeof(int))) {
+	    s->count++;
+	    return;
+	}
+    s = new ProfileStack;
+    s->depth = depth;
+    memcpy(s->frames, frames, depth * sizeof(int));
+    s->count = 1;
+    s->next = stacks[hash];
+    stacks[hash] = s;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::Print
+// 	Print the flat profile: for each procedure, the samples taken in
+//	it ("self"), and in it or anything it called ("total"), most
+//	"self" first.  Addresses outside any procedure are lumped
+//	together.
+//----------------------------------------------------------------------
+
+void
+ProfiledProgram::Print(int interval)
+{
+    int n = numSymbols + 1;		// the last is "unknown"
+    int *self = new int[n], *total = new int[n], *order = new int[n];
+    int *seen = new int[MaxProfileDepth + 1];
+
+    for (int i = 0; i < n; i++) {
+	self[i] = total[i] = 0;
+	order[i] = i;
+    }
+    for (int b = 0; b < ProfileHashSize; b++)
+	for (ProfileStack *s = stacks[b]; s != NULL; s = s->next)
+	    for (int i = 0; i < s->depth; i++) {
+		int which = IndexOf(s->frames[i]);
+		bool counted = FALSE;
+
+		seen[i] = which;
+		for (int j = 0; j < i; j++)	// recursion counts once
+		    if (seen[j] == which)
+			counted = TRUE;
+		if (!counted)
+		    total[which] += s->count;
+		if (i == s->depth - 1)
+		    self[which] += s->count;
+	    }
+
+    for (int i = 1; i < n; i++) {		// most samples first
+	int o = order[i], j = i;
+
+	while (j > 0 && self[order[j - 1]] < self[o]) {
+	    order[j] = order[j - 1];
+	    j--;
+	}
+	order[j] = o;
+    }
+
+    printf("Profile of %s: %d samples, one every %d instructions\n",
+	   fileName, samples, interval);
+    printf("   self           total\n");
+    for (int i = 0; i < n; i++) {
+	int w = order[i];
+
+	if (total[w] == 0)
+	    continue;
+	printf("%7d %5.1f%%  %7d %5.1f%%  %s\n", self[w],
+	       100.0 * self[w] / samples, total[w], 100.0 * total[w] / samples,
+	       (w < numSymbols) ? symbols[w].name : "[unknown]");
+    }
+    delete [] self;
+    delete [] total;
+    delete [] order;
+    delete [] seen;
+}
+
+//----------------------------------------------------------------------
+// ProfiledProgram::WriteFolded
+// 	Write each distinct call stack as a line of "folded" stack
+//	("program;outermost;...;innermost count"), for flamegraph.pl.
+//----------------------------------------------------------------------
+
+void
+ProfiledProgram::WriteFolded(FILE *f)
+{
+    char *base = strrchr(fileName, '/');
+
+    base = (base != NULL) ? base + 1 : fileName;
+    for (int b = 0; b < ProfileHashSize; b++)
+	for (ProfileStack *s = stacks[b]; s != NULL; s = s->next) {
+	    fprintf(f, "%s", base);
+	    for (int i = 0; i < s->depth; i++) {
+		char *name = NameOf(s->frames[i]);
+
+		if (name != NULL)
+		    fprintf(f, ";%s", name);
+		else
+		    fprintf(f, ";0x%x", s->frames[i]);
+	    }
+	    fprintf(f, " %d\n", s->count);
+	}
+}
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Start profiling, with no threads or programs seen yet.
+//
+//	"stackFile" -- where the folded stacks are written
+//	"sampleInterval" -- user instructions between samples
+//----------------------------------------------------------------------
+
+Profiler::Profiler(char *stackFile, int sampleInterval)
+{
+    ASSERT(sampleInterval > 0);
+    fileName = stackFile;
+    interval = countdown = sampleInterval;
+    threads = new ShadowStack[MAX_THREAD_ID];
+    for (int i = 0; i < MAX_THREAD_ID; i++) {
+	threads[i].space = NULL;
+	threads[i].program = NULL;
+	threads[i].depth = 0;
+    }
+    numPrograms = 0;
+}
+
+//----------------------------------------------------------------------
+// Profiler::~Profiler
+// 	Print the flat profile of each program sampled, and write all of
+//	their stacks to the file.
+//----------------------------------------------------------------------
+
+Profiler::~Profiler()
+{
+    FILE *f = fopen(fileName, "w");
+
+    if (f == NULL)
+	perror(fileName);
+    for (int i = 0; i < numPrograms; i++) {
+	programs[i]->Print(interval);
+	if (f != NULL)
+	    programs[i]->WriteFolded(f);
+	delete programs[i];
+    }
+    if (f != NULL) {
+	fclose(f);
+	printf("Profile: stacks written to %s\n", fileName);
+    }
+    delete [] threads;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Current
+// 	Return the shadow stack of the running thread.  If the thread has
+//	started running a different address space, the stack starts over,
+//	and its samples go to the program the space was loaded from.
+//----------------------------------------------------------------------
+
+ShadowStack *
+Profiler::Current()
+{
+    ShadowStack *s = &threads[currentThread->get_threadID()];
+    AddrSpace *space = currentThread->space;
+
+    if (s->space != space) {
+	static char unknown[] = "unknown";
+	char *name = (space->program != NULL) ? space->program : unknown;
+
+	s->space = space;
+	s->depth = 0;
+	s->program = NULL;
+	for (int i = 0; i < numPrograms && s->program == NULL; i++)
+	    if (!strcmp(programs[i]->fileName, name))
+		s->program = programs[i];
+	if (s->program == NULL && numPrograms < MaxProfilePrograms)
+	    s->program = programs[numPrograms++] = new ProfiledProgram(name);
+    }
+    return s;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Call, Profiler::Return
+// 	The running thread has called a procedure that will return to
+//	"returnAddress", or has returned to "returnAddress".  A return
+//	pops back to the call it matches, so that calls which never
+//	return normally don't pile up.
+//----------------------------------------------------------------------
+
+void
+Profiler::Call(int returnAddress)
+{
+    ShadowStack *s = Current();
+
+    if (s->depth < MaxProfileDepth)
+	s->returnTo[s->depth] = returnAddress;
+    s->depth++;
+}
+
+void
+Profiler::Return(int returnAddress)
+{
+    ShadowStack *s = Current();
+
+    if (s->depth > MaxProfileDepth) {	// too deep to check
+	s->depth--;
+	return;
+    }
+    for (int i = s->depth - 1; i >= 0; i--)
+	if (s->returnTo[i] == returnAddress) {
+	    s->depth = i;
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// Profiler::Sample
+// 	Record where the running thread is: the procedure holding each
+//	call on its shadow stack (the jal is 8 bytes before the return
+//	address), and the one holding the PC.
+//----------------------------------------------------------------------
+
+void
+Profiler::Sample()
+{
+    ShadowStack *s = Current();
+    int frames[MaxProfileDepth + 1];
+    int depth = (s->depth < MaxProfileDepth) ? s->depth : MaxProfileDepth;
+
+    countdown = interval;
+    if (s->program == NULL)		// too many programs
+	return;
+    for (int i = 0; i < depth; i++)
+	frames[i] = s->program->Procedure(s->returnTo[i] - 8);
+    frames[depth] = s->program->Procedure(machine->ReadRegister(PCReg));
+    s->program->Add(frames, depth + 1);
+}
@@ -0,0 +1,131 @@
+// profile.h
+//	Data structures for a sampling profiler of user programs.
+//
+//	Every "interval" user instructions, the profiler records where the
+//	running program is: the PC, and the chain of calls that led there.
+//	The calls are kept by watching the simulated machine -- each "jal"
+//	or "jalr" pushes its return address on a shadow stack kept for the
+//	thread, and each "jr $ra" pops back to the frame it returns to --
+//	so, unlike walking the frames on the user stack, it doesn't depend
+//	on how the program was compiled.
+//
+//	When Nachos halts, the samples are resolved to procedure names
+//	using the symbol table of the program's COFF file (the ".coff"
+//	file next to the NOFF executable, that coff2noff was run on), a
+//	flat profile is printed, and the call stacks are written out in
+//	"folded" form -- one line per distinct stack, "prog;main;Sort 42"
+//	-- as taken by flamegraph.pl.  Addresses with no symbol are shown
+//	in hex.
+//
+//	Profiling is turned on with "-prof <file> [interval]".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define MaxProfileDepth		32	// calls kept on a shadow stack
+#define MaxProfilePrograms	16	// executables told apart
+#define ProfileHashSize		1024	// buckets for distinct stacks
+
+class AddrSpace;
+
+// The following class defines a procedure in a program's symbol table.
+
+class ProfileSymbol {
+  public:
+    int address;		// Where the procedure starts
+    char *name;
+};
+
+// The following class defines one distinct call stack, and how many
+// samples were taken in it.  Frames are procedure addresses (or PCs, if
+// they aren't in any procedure), outermost first.
+
+class ProfileStack {
+  public:
+    int depth;
+    int frames[MaxProfileDepth + 1];
+    int count;
+    ProfileStack *next;		// In the same hash bucket
+};
+
+// The following class defines the samples taken in one executable.
+
+class ProfiledProgram {
+  public:
+    ProfiledProgram(char *programFile);	// Read the symbols of
+					// "programFile".coff, if it exists
+    ~ProfiledProgram();
+
+    int Procedure(int pc);		// Start of the procedure holding
+					// "pc", or "pc" if there is none
+    int IndexOf(int address);		// Where the procedure starting at
+					// "address" is in "symbols"
+    char *NameOf(int address);		// ... and its name, or NULL
+    void Add(int *frames, int depth);	// Count a sample in this stack
+
+    void Print(int interval);		// Print the flat profile
+    void WriteFolded(FILE *f);		// Write the stacks, folded
+
+    char *fileName;
+    int samples;
+
+  private:
+    ProfileSymbol *symbols;		// Procedures, by address
+    int numSymbols;
+    int textEnd;			// End of the code segment
+    ProfileStack *stacks[ProfileHashSize];
+
+    bool ReadSymbols(char *coffName);
+};
+
+// The following class defines the calls a user thread has made, and
+// not yet returned from.
+
+class ShadowStack {
+  public:
+    AddrSpace *space;		// The address space they were made in
+    ProfiledProgram *program;	// ... and its samples
+    int depth;			// Calls made and not returned from;
+				// only the first MaxProfileDepth are kept
+    int returnTo[MaxProfileDepth];
+};
+
+// The following class defines the profiler.
+
+class Profiler {
+  public:
+    Profiler(char *stackFile, int sampleInterval);
+				// Start sampling every "sampleInterval"
+				// instructions; the stacks will be
+				// written to "stackFile"
+    ~Profiler();		// Print the profile, and write out
+				// the stacks
+
+    void Instruction()		// Called for each user instruction
+	{ if (--countdown <= 0) Sample(); }
+    void Call(int returnAddress);	// The running thread called a
+					// procedure
+    void Return(int returnAddress);	// ... returned from one
+
+  private:
+    char *fileName;
+    int interval;
+    int countdown;		// Instructions until the next sample
+    ShadowStack *threads;	// One per thread ID
+    ProfiledProgram *programs[MaxProfilePrograms];
+    int numPrograms;
+
+    ShadowStack *Current();	// The running thread's stack
+    void Sample();
+};
+
+extern Profiler *profiler;	// NULL unless profiling is on
+
+#endif // PROFILE_H
@@ -31,7 +31,7 @@ StartProcess(char *filename)
 	printf("Unable to open file %s\n", filename);
 	return;
     }
-    space = new AddrSpace(executable);
+    space = new AddrSpace(executable, filename);
     currentThread->space = space;
 
     delete executable;			// close file
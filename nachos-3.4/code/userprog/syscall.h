@@ -37,6 +37,11 @@
 #define SC_Mkdir	16
 #define SC_Rm		17
 #define SC_Print	18
+#define SC_Pipe		19
+#define SC_Dup		20
+#define SC_Send		21
+#define SC_Receive	22
+#define SC_Poll		23
 
 #ifndef IN_ASM
 
@@ -63,7 +68,9 @@ void Exit(int status);
 typedef int SpaceId;
 
 /* Run the executable, stored in the Nachos file "name", and return the
- * address space identifier
+ * address space identifier.  The new program starts with the caller's
+ * open files, under the same OpenFileIds, and shares them with it: a
+ * pipe stays open until both programs have closed their end.
  */
 SpaceId Exec(char *name);
 
@@ -98,11 +105,17 @@ typedef int OpenFileId;
 void Create(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can
- * be used to read and write to the file.
+ * be used to read and write to the file; -1 if the file doesn't exist
+ * or too many files are open.
+ *
+ * OpenFileIds are small integers, private to each address space
+ * (like UNIX file descriptors).
  */
 OpenFileId Open(char *name);
 
-/* Write "size" bytes from "buffer" to the open file. */
+/* Write "size" bytes from "buffer" to the open file.  (The number of
+ * bytes written, or -1 if "id" can't be written, is left in r2.)
+ */
 void Write(char *buffer, int size, OpenFileId id);
 
 /* Read "size" bytes from the open file into "buffer".
@@ -163,6 +176,57 @@ void Rm(char*name);
 /* Print string */
 void Print(char*out);
 
+/* Make a pipe.  "fds[0]" is set to an OpenFileId to Read from it, and
+ * "fds[1]" to one to Write to it.  Data written to the pipe is kept in
+ * kernel memory until it is read; Read waits while the pipe is empty
+ * (and returns 0 once every write end is closed), Write waits while it
+ * is full.  Return 0, or -1 if too many pipes are open or "fds" is not
+ * a valid address.
+ */
+int Pipe(OpenFileId *fds);
+
+/* Return another OpenFileId for the same open file as "id"; the two
+ * share one position in the file, and the file stays open until both
+ * are closed.  Return -1 if "id" isn't open or too many files are.
+ */
+OpenFileId Dup(OpenFileId id);
+
+/* Network operations: Send, Receive and Poll.
+ *
+ * Messages go to and from the Post Office mailboxes of Nachos machines
+ * (cf. network/post.h); each machine has mailboxes 0 .. NumMailBoxes-1.
+ * A message holds at most MaxMessage bytes.  Delivery is in order
+ * between two mailboxes, but a message may be lost if the network is
+ * unreliable (nachos -l).  Without a network, they all return -1.
+ */
+
+#define MaxMessage	40	/* MaxMailSize, in network/post.h */
+#define NumMailBoxes	10
+
+/* The address of a mailbox */
+typedef struct {
+    int machine;		/* machine ID (nachos -m) */
+    int box;			/* mailbox on that machine */
+} MailAddress;
+
+/* Send "size" bytes of "buffer" to mailbox "to"; "fromBox" is where
+ * replies should go on this machine.  Return "size", or -1 if the
+ * message is too big or a mailbox doesn't exist.
+ */
+int Send(MailAddress *to, int fromBox, char *buffer, int size);
+
+/* Wait for a message in mailbox "box", and copy up to "size" bytes of
+ * it into "buffer".  If "from" isn't 0, it is set to the sender's
+ * reply address.  Return the number of bytes copied, or -1 if the
+ * mailbox doesn't exist.
+ */
+int Receive(int box, MailAddress *from, char *buffer, int size);
+
+/* Return one of the "n" mailboxes in "boxes" that has a message waiting.
+ * If none has, wait for one if "wait" is non-zero, else return -1.
+ */
+int Poll(int *boxes, int n, int wait);
+
 
 #endif /* IN_ASM */
 